@@ -7,6 +7,20 @@ cbuffer GrassCollisionPerFrame : register(b5)
 	float RadiusMultiplier;
 	float DisplacementMultiplier;
 	float maxDistance;
+	uint frameInterval;
+	float gatherTimeBudget;
+	float nearDistance;
+	uint farFrameInterval;
+	uint middleHighFrameInterval;
+	uint colliderBudget;
+	bool EnableExtrapolation;
+	bool EnableAdaptiveInterval;
+	float adaptiveDistance;
+	float2 pad01;
+	float4 gridOrigin[2];
+	float gridCellSize;
+	uint gridSize;
+	uint collisionCount;
 }
 
 struct StructuredCollision
@@ -15,7 +29,15 @@ struct StructuredCollision
 	float radius;
 };
 
+struct CollisionGridCell
+{
+	uint offset;
+	uint count;
+};
+
 StructuredBuffer<StructuredCollision> collisions : register(t0);
+StructuredBuffer<CollisionGridCell> collisionGridCells : register(t1);
+StructuredBuffer<uint> collisionGridIndices : register(t2);
 
 float3 GetDisplacedPosition(float3 position, float alpha, uint eyeIndex = 0)
 {
@@ -30,12 +52,20 @@ float3 GetDisplacedPosition(float3 position, float alpha, uint eyeIndex = 0)
 		}
 	}
 
-	if (EnableGrassCollision) {
-		uint counter = 0;
-		uint collision_count, dummy;
-		collisions.GetDimensions(collision_count, dummy);
-		for (uint collision_index = 0; collision_index < collision_count; collision_index++) {
-			StructuredCollision collision = collisions[collision_index];
+	if (EnableGrassCollision && collisionCount && gridCellSize > 0) {
+		// Only the colliders binned into this vertex's grid cell can reach it
+		int2 cellCoord = floor((worldPosition.xy - gridOrigin[eyeIndex].xy) / gridCellSize);
+		if (any(cellCoord < 0) || any(cellCoord >= (int)gridSize)) {
+			return 0;
+		}
+
+		CollisionGridCell cell = collisionGridCells[cellCoord.y * gridSize + cellCoord.x];
+		for (uint i = 0; i < cell.count; i++) {
+			// the views cover the whole buffer capacity, past collisionCount is stale
+			uint collisionIndex = collisionGridIndices[cell.offset + i];
+			if (collisionIndex >= collisionCount)
+				continue;
+			StructuredCollision collision = collisions[collisionIndex];
 
 			float dist = distance(collision.centre[eyeIndex], worldPosition);
 			float power = smoothstep(collision.radius, 0.0, dist);
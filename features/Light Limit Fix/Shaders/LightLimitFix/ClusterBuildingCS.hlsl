@@ -28,10 +28,10 @@ float3 IntersectionZPlane(float3 B, float z_dist)
 								uint groupIndex
 								: SV_GroupIndex) {
 	uint clusterIndex = groupId.x +
-	                    groupId.y * CLUSTER_BUILDING_DISPATCH_SIZE_X +
-	                    groupId.z * (CLUSTER_BUILDING_DISPATCH_SIZE_X * CLUSTER_BUILDING_DISPATCH_SIZE_Y);
+	                    groupId.y * ClusterSizeX +
+	                    groupId.z * (ClusterSizeX * ClusterSizeY);
 
-	float2 clusterSize = rcp(float2(CLUSTER_BUILDING_DISPATCH_SIZE_X, CLUSTER_BUILDING_DISPATCH_SIZE_Y));
+	float2 clusterSize = rcp(float2(ClusterSizeX, ClusterSizeY));
 
 	float2 texcoordMax = (groupId.xy + 1) * clusterSize;
 	float2 texcoordMin = groupId.xy * clusterSize;
@@ -43,8 +43,8 @@ float3 IntersectionZPlane(float3 B, float z_dist)
 	float3 minPointVS = min(GetPositionVS(texcoordMin, 1.0f, 0), GetPositionVS(texcoordMin, 1.0f, 1));
 #endif  // !VR
 
-	float clusterNear = LightsNear * pow(LightsFar / LightsNear, groupId.z / float(CLUSTER_BUILDING_DISPATCH_SIZE_Z));
-	float clusterFar = LightsNear * pow(LightsFar / LightsNear, (groupId.z + 1) / float(CLUSTER_BUILDING_DISPATCH_SIZE_Z));
+	float clusterNear = LightsNear * pow(LightsFar / LightsNear, groupId.z / float(ClusterSizeZ));
+	float clusterFar = LightsNear * pow(LightsFar / LightsNear, (groupId.z + 1) / float(ClusterSizeZ));
 
 	float3 minPointNear = IntersectionZPlane(minPointVS, clusterNear);
 	float3 minPointFar = IntersectionZPlane(minPointVS, clusterFar);
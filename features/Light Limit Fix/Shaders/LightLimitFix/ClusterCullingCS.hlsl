@@ -3,17 +3,28 @@
 //references
 //https://github.com/pezcode/Cluster
 
+// Runs twice: first counting the lights per cluster, then with CLUSTER_FILL writing them at the offsets from ClusterPrefixSumCS
+
 StructuredBuffer<ClusterAABB> clusters : register(t0);
 StructuredBuffer<StructuredLight> lights : register(t1);
 
-RWStructuredBuffer<uint> lightIndexCounter : register(u0);  //1
-RWStructuredBuffer<uint> lightIndexList : register(u1);     //MAX_CLUSTER_LIGHTS * 16^3
-RWStructuredBuffer<LightGrid> lightGrid : register(u2);     //16^3
+#if defined(CLUSTER_FILL)
+StructuredBuffer<LightGrid> lightGrid : register(t2);
+RWStructuredBuffer<uint> lightIndexList : register(u0);  //LightListCapacity
+#else
+RWStructuredBuffer<LightGrid> lightGrid : register(u0);  //ClusterCount
+#endif
+
+#define GROUP_SIZE 64
 
 groupshared StructuredLight sharedLights[GROUP_SIZE];
 
 bool LightIntersectsCluster(StructuredLight light, ClusterAABB cluster, int eyeIndex = 0)
 {
+	// Released light slots are zeroed
+	if (light.radius <= 0)
+		return false;
+
 	// For now, only use left eye position
 	float3 closest = max(cluster.minPoint, min(light.positionVS[eyeIndex].xyz, cluster.maxPoint)).xyz;
 
@@ -21,69 +32,59 @@ bool LightIntersectsCluster(StructuredLight light, ClusterAABB cluster, int eyeI
 	return dot(dist, dist) <= (light.radius * light.radius);
 }
 
-[numthreads(16, 8, 8)] void main(uint3 groupId
-								 : SV_GroupID,
-								 uint3 dispatchThreadId
-								 : SV_DispatchThreadID,
-								 uint3 groupThreadId
-								 : SV_GroupThreadID,
-								 uint groupIndex
-								 : SV_GroupIndex) {
-	if (all(dispatchThreadId == 0)) {
-		lightIndexCounter[0] = 0;
-	}
+[numthreads(GROUP_SIZE, 1, 1)] void main(uint3 dispatchThreadId
+										 : SV_DispatchThreadID,
+										 uint groupIndex
+										 : SV_GroupIndex) {
+	uint clusterIndex = dispatchThreadId.x;
+	// Threads past the last cluster still load lights for the rest of the group
+	bool validCluster = clusterIndex < ClusterCount;
 
-	uint visibleLightCount = 0;
-	uint visibleLightIndices[MAX_CLUSTER_LIGHTS];
-
-	uint clusterIndex = groupIndex + GROUP_SIZE * groupId.z;
+	ClusterAABB cluster = clusters[min(clusterIndex, ClusterCount - 1)];
 
-	ClusterAABB cluster = clusters[clusterIndex];
+#if defined(CLUSTER_FILL)
+	uint listOffset = lightGrid[min(clusterIndex, ClusterCount - 1)].offset;
+	uint listCount = lightGrid[min(clusterIndex, ClusterCount - 1)].lightCount;
+#endif
 
-	uint lightOffset = 0;
-	uint lightCount, dummy;
-	lights.GetDimensions(lightCount, dummy);
+	uint visibleLightCount = 0;
 
-	while (lightOffset < lightCount) {
-		uint batchSize = min(GROUP_SIZE, lightCount - lightOffset);
+	for (uint lightOffset = 0; lightOffset < LightCount; lightOffset += GROUP_SIZE) {
+		uint batchSize = min(GROUP_SIZE, LightCount - lightOffset);
 
 		if (groupIndex < batchSize) {
-			uint lightIndex = lightOffset + groupIndex;
-
-			StructuredLight light = lights[lightIndex];
-
-			sharedLights[groupIndex] = light;
+			sharedLights[groupIndex] = lights[lightOffset + groupIndex];
 		}
 
 		GroupMemoryBarrierWithGroupSync();
 
-		for (uint i = 0; i < batchSize; i++) {
-			StructuredLight light = lights[i];
+		if (validCluster) {
+			for (uint i = 0; i < batchSize; i++) {
+				StructuredLight light = sharedLights[i];
 
-			if (visibleLightCount < MAX_CLUSTER_LIGHTS && (LightIntersectsCluster(light, cluster)
+				if (LightIntersectsCluster(light, cluster)
 #ifdef VR
-															  || LightIntersectsCluster(light, cluster, 1)
+					|| LightIntersectsCluster(light, cluster, 1)
 #endif  // VR
-																  )) {
-				visibleLightIndices[visibleLightCount] = lightOffset + i;
-				visibleLightCount++;
+				) {
+#if defined(CLUSTER_FILL)
+					if (visibleLightCount < listCount)
+						lightIndexList[listOffset + visibleLightCount] = lightOffset + i;
+#endif
+					visibleLightCount++;
+				}
 			}
 		}
 
-		lightOffset += batchSize;
+		GroupMemoryBarrierWithGroupSync();
 	}
 
-	GroupMemoryBarrierWithGroupSync();
-
-	uint offset = 0;
-	InterlockedAdd(lightIndexCounter[0], visibleLightCount, offset);
-
-	for (uint i = 0; i < visibleLightCount; i++) {
-		lightIndexList[offset + i] = visibleLightIndices[i];
+#if !defined(CLUSTER_FILL)
+	if (validCluster) {
+		lightGrid[clusterIndex].offset = 0;
+		lightGrid[clusterIndex].lightCount = visibleLightCount;
 	}
-
-	lightGrid[clusterIndex].offset = offset;
-	lightGrid[clusterIndex].lightCount = visibleLightCount;
+#endif
 }
 
 //https://www.3dgep.com/forward-plus/#Grid_Frustums_Compute_Shader
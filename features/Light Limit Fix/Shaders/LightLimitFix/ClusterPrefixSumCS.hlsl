@@ -0,0 +1,48 @@
+#include "Common.hlsli"
+
+// Turns the per-cluster light counts into offsets of a tightly packed light list
+
+RWStructuredBuffer<LightGrid> lightGrid : register(u0);          //ClusterCount
+RWStructuredBuffer<uint> lightIndexCounter : register(u1);  //1
+
+#define GROUP_SIZE 1024
+
+groupshared uint sharedSums[GROUP_SIZE];
+
+[numthreads(GROUP_SIZE, 1, 1)] void main(uint groupIndex
+										 : SV_GroupIndex) {
+	// Each thread sums a contiguous run of clusters, then the run totals are scanned across the group
+	uint runLength = (ClusterCount + GROUP_SIZE - 1) / GROUP_SIZE;
+	uint runStart = min(groupIndex * runLength, ClusterCount);
+	uint runEnd = min(runStart + runLength, ClusterCount);
+
+	uint runTotal = 0;
+	for (uint clusterIndex = runStart; clusterIndex < runEnd; clusterIndex++) {
+		runTotal += lightGrid[clusterIndex].lightCount;
+	}
+
+	sharedSums[groupIndex] = runTotal;
+	GroupMemoryBarrierWithGroupSync();
+
+	// Hillis-Steele inclusive scan
+	[unroll] for (uint stride = 1; stride < GROUP_SIZE; stride <<= 1)
+	{
+		uint value = groupIndex >= stride ? sharedSums[groupIndex - stride] : 0;
+		GroupMemoryBarrierWithGroupSync();
+		sharedSums[groupIndex] += value;
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	uint offset = sharedSums[groupIndex] - runTotal;
+	for (uint runIndex = runStart; runIndex < runEnd; runIndex++) {
+		uint count = lightGrid[runIndex].lightCount;
+		lightGrid[runIndex].offset = offset;
+		// Clusters past the end of the list are truncated until the list has grown
+		lightGrid[runIndex].lightCount = min(count, LightListCapacity - min(offset, LightListCapacity));
+		offset += count;
+	}
+
+	if (groupIndex == GROUP_SIZE - 1) {
+		lightIndexCounter[0] = sharedSums[GROUP_SIZE - 1];
+	}
+}
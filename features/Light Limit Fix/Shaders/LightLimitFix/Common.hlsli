@@ -1,11 +1,4 @@
 
-#define GROUP_SIZE (16 * 16 * 4)
-#define MAX_CLUSTER_LIGHTS 128
-
-#define CLUSTER_BUILDING_DISPATCH_SIZE_X 16
-#define CLUSTER_BUILDING_DISPATCH_SIZE_Y 16
-#define CLUSTER_BUILDING_DISPATCH_SIZE_Z 16
-
 struct ClusterAABB
 {
 	float4 minPoint;
@@ -32,6 +25,19 @@ cbuffer PerFrame : register(b0)
 	row_major float4x4 InvProjMatrix[2];
 	float LightsNear;
 	float LightsFar;
+	uint ClusterSizeX;
+	uint ClusterSizeY;
+	uint ClusterSizeZ;
+	uint ClusterCount;
+	uint LightListCapacity;
+}
+
+// Set by the light transform pass, the lights buffer covers its whole capacity so this is the live light count
+cbuffer PerFrameLightTransform : register(b1)
+{
+	row_major float4x4 ViewMatrix[2];
+	float4 EyePosition[2];
+	uint LightCount;
 }
 
 float3 GetPositionVS(float2 texcoord, float depth, int eyeIndex = 0)
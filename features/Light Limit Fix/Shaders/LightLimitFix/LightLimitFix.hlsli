@@ -26,11 +26,14 @@ struct PerPassLLF
 	float4 CameraData;
 	float2 BufferDim;
 	uint FrameCount;
+	uint ClusterSizeX;
+	uint ClusterSizeY;
+	uint ClusterSizeZ;
 };
 
 StructuredBuffer<StructuredLight> lights : register(t17);
-StructuredBuffer<uint> lightList : register(t18);       //MAX_CLUSTER_LIGHTS * 16^3
-StructuredBuffer<LightGrid> lightGrid : register(t19);  //16^3
+StructuredBuffer<uint> lightList : register(t18);       //sized to the total of all clusters
+StructuredBuffer<LightGrid> lightGrid : register(t19);  //ClusterSizeX * ClusterSizeY * ClusterSizeZ
 
 #if !defined(SCREEN_SPACE_SHADOWS)
 Texture2D<float4> TexDepthSampler : register(t20);
@@ -53,12 +56,14 @@ bool GetClusterIndex(in float2 uv, in float z, out uint clusterIndex)
 	if (z < perPassLLF[0].LightsNear || z > perPassLLF[0].LightsFar)
 		return false;
 
+	uint3 clusterSize = uint3(perPassLLF[0].ClusterSizeX, perPassLLF[0].ClusterSizeY, perPassLLF[0].ClusterSizeZ);
+
 	float clampedZ = clamp(z, perPassLLF[0].LightsNear, perPassLLF[0].LightsFar);
-	uint clusterZ = uint(max((log2(z) - log2(perPassLLF[0].LightsNear)) * 16.0 / log2(perPassLLF[0].LightsFar / perPassLLF[0].LightsNear), 0.0));
-	uint2 clusterDim = ceil(perPassLLF[0].BufferDim / float2(16, 16));
-	uint3 cluster = uint3(uint2((uv * perPassLLF[0].BufferDim) / clusterDim), clusterZ);
+	uint clusterZ = uint(max((log2(z) - log2(perPassLLF[0].LightsNear)) * clusterSize.z / log2(perPassLLF[0].LightsFar / perPassLLF[0].LightsNear), 0.0));
+	uint2 clusterDim = ceil(perPassLLF[0].BufferDim / float2(clusterSize.xy));
+	uint3 cluster = uint3(uint2((uv * perPassLLF[0].BufferDim) / clusterDim), min(clusterZ, clusterSize.z - 1));
 
-	clusterIndex = cluster.x + (16 * cluster.y) + (16 * 16 * cluster.z);
+	clusterIndex = cluster.x + (clusterSize.x * cluster.y) + (clusterSize.x * clusterSize.y * cluster.z);
 	return true;
 }
 
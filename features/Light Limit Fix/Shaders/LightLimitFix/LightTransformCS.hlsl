@@ -0,0 +1,34 @@
+#include "Common.hlsli"
+
+struct LightWorldData
+{
+	float3 color;
+	float radius;
+	float3 position;
+	uint firstPersonShadow;
+};
+
+StructuredBuffer<LightWorldData> lightWorldData : register(t0);
+RWStructuredBuffer<StructuredLight> lights : register(u0);
+
+[numthreads(64, 1, 1)] void main(uint3 dispatchThreadId
+								 : SV_DispatchThreadID) {
+	uint lightIndex = dispatchThreadId.x;
+	if (lightIndex >= LightCount)
+		return;
+
+	LightWorldData worldData = lightWorldData[lightIndex];
+
+	StructuredLight light;
+	light.color = worldData.color;
+	light.radius = worldData.radius;
+	light.firstPersonShadow = worldData.firstPersonShadow;
+
+	[unroll] for (uint eyeIndex = 0; eyeIndex < 2; eyeIndex++)
+	{
+		light.positionWS[eyeIndex] = worldData.position - EyePosition[eyeIndex].xyz;
+		light.positionVS[eyeIndex] = mul(float4(light.positionWS[eyeIndex], 1), ViewMatrix[eyeIndex]).xyz;
+	}
+
+	lights[lightIndex] = light;
+}
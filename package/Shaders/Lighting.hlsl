@@ -684,6 +684,9 @@ cbuffer PerGeometry : register(b2)
 	float4 PointLightPosition[7] : packoffset(c15);               // point light radius in w
 	float4 PointLightColor[7] : packoffset(c22);
 	float2 NumLightNumShadowLight : packoffset(c29);
+#		if defined(LIGHT_LIMIT_FIX)
+	uint StrictLightDataIndex : packoffset(c29.z);  // slot of this geometry in the strict light data ring
+#		endif
 #	else
 	// VR is [49] instead of [30]
 	float3 DirLightDirection : packoffset(c0);
@@ -703,6 +706,9 @@ cbuffer PerGeometry : register(b2)
 	float4 PointLightPosition[14] : packoffset(c27);              // point light radius in w
 	float4 PointLightColor[7] : packoffset(c41);
 	float2 NumLightNumShadowLight : packoffset(c48);
+#		if defined(LIGHT_LIMIT_FIX)
+	uint StrictLightDataIndex : packoffset(c48.z);  // slot of this geometry in the strict light data ring
+#		endif
 #	endif  // VR
 };
 
@@ -1650,15 +1656,15 @@ PS_OUTPUT main(PS_INPUT input, bool frontFace
 #	if !defined(LOD)
 	if (numLights > 0) {
 #		if defined(LIGHT_LIMIT_FIX)
-		[loop] for (uint lightIndex = 0; lightIndex < strictLightData[0].NumLights; lightIndex++)
+		[loop] for (uint lightIndex = 0; lightIndex < strictLightData[StrictLightDataIndex].NumLights; lightIndex++)
 		{
-			float3 lightDirection = strictLightData[0].PointLightPosition[lightIndex] - input.InputPosition;
+			float3 lightDirection = strictLightData[StrictLightDataIndex].PointLightPosition[lightIndex] - input.InputPosition;
 			float lightDist = length(lightDirection);
-			float intensityFactor = saturate(lightDist / strictLightData[0].PointLightRadius[lightIndex]);
+			float intensityFactor = saturate(lightDist / strictLightData[StrictLightDataIndex].PointLightRadius[lightIndex]);
 			if (intensityFactor == 1)
 				continue;
 			float intensityMultiplier = 1 - intensityFactor * intensityFactor;
-			float3 lightColor = strictLightData[0].PointLightColor[lightIndex] * intensityMultiplier;
+			float3 lightColor = strictLightData[StrictLightDataIndex].PointLightColor[lightIndex] * intensityMultiplier;
 #		else
 		[loop] for (uint lightIndex = 0; lightIndex < numLights; ++lightIndex)
 		{
@@ -2077,9 +2083,9 @@ PS_OUTPUT main(PS_INPUT input, bool frontFace
 #	if defined(LIGHT_LIMIT_FIX) && defined(LLFDEBUG)
 	if (perPassLLF[0].EnableLightsVisualisation) {
 		if (perPassLLF[0].LightsVisualisationMode == 0) {
-			psout.Albedo.xyz = TurboColormap(strictLightData[0].NumLights >= 7.0);
+			psout.Albedo.xyz = TurboColormap(strictLightData[StrictLightDataIndex].NumLights >= 7.0);
 		} else if (perPassLLF[0].LightsVisualisationMode == 1) {
-			psout.Albedo.xyz = TurboColormap((float)strictLightData[0].NumLights / 15.0);
+			psout.Albedo.xyz = TurboColormap((float)strictLightData[StrictLightDataIndex].NumLights / 15.0);
 		} else {
 			psout.Albedo.xyz = TurboColormap((float)lightCount / 128.0);
 		}
@@ -168,6 +168,141 @@ public:
 	winrt::com_ptr<ID3D11UnorderedAccessView> uav;
 };
 
+// Dynamic structured buffer which keeps its allocation while the element count changes.
+// Capacity grows geometrically and only shrinks after the count has stayed below a quarter of it for a while.
+// The views cover the whole capacity and are only recreated with the buffer, so shaders must take the live count
+// from a constant buffer rather than from GetDimensions.
+template <typename T>
+class DynamicStructuredBuffer
+{
+public:
+	enum class Usage
+	{
+		Dynamic,          // rewritten from the CPU on every update
+		Default,          // ranged updates of the elements that changed
+		UnorderedAccess,  // written by compute shaders, with a UAV
+	};
+
+	static constexpr UINT MinCapacity = 64;
+	static constexpr UINT ShrinkDelay = 300;  // updates below a quarter of the capacity before shrinking
+
+	DynamicStructuredBuffer(UINT a_capacity = MinCapacity, Usage a_usage = Usage::Dynamic) :
+		usage(a_usage)
+	{
+		Allocate(std::max(a_capacity, MinCapacity));
+	}
+
+	// Sizes the buffer for a_count elements, true when it was reallocated and the previous contents are gone
+	bool Reserve(UINT a_count)
+	{
+		count = a_count;
+		if (a_count > capacity) {
+			Allocate(std::max(a_count, capacity * 2));
+			return true;
+		}
+		if (a_count <= capacity / 4 && capacity > MinCapacity) {
+			if (++shrinkCounter >= ShrinkDelay) {
+				Allocate(std::max(a_count * 2, MinCapacity));
+				return true;
+			}
+		} else {
+			shrinkCounter = 0;
+		}
+		return false;
+	}
+
+	void Update(T const* a_data, UINT a_count)
+	{
+		Reserve(a_count);
+
+		if (usage != Usage::Dynamic) {
+			if (a_count)
+				UpdateRange(a_data, 0, a_count);
+			return;
+		}
+
+		ID3D11DeviceContext* ctx = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
+		D3D11_MAPPED_SUBRESOURCE mapped{};
+		DX::ThrowIfFailed(ctx->Map(resource.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+		if (a_count)
+			memcpy_s(mapped.pData, sizeof(T) * capacity, a_data, sizeof(T) * a_count);
+		else
+			memset(mapped.pData, 0, sizeof(T));
+		ctx->Unmap(resource.get(), 0);
+	}
+
+	// Uploads a_count elements starting at a_first, only for Default and UnorderedAccess buffers
+	void UpdateRange(T const* a_data, UINT a_first, UINT a_count)
+	{
+		ID3D11DeviceContext* ctx = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
+		D3D11_BOX box{ a_first * (UINT)sizeof(T), 0, 0, (a_first + a_count) * (UINT)sizeof(T), 1, 1 };
+		ctx->UpdateSubresource(resource.get(), 0, &box, a_data, 0, 0);
+	}
+
+	ID3D11ShaderResourceView* SRV() const { return srv.get(); }
+	ID3D11UnorderedAccessView* UAV() const { return uav.get(); }
+	UINT Count() const { return count; }
+	UINT Capacity() const { return capacity; }
+
+	std::uint64_t resourceAllocations = 0;
+	std::uint64_t viewAllocations = 0;
+
+private:
+	void Allocate(UINT a_capacity)
+	{
+		capacity = a_capacity;
+		shrinkCounter = 0;
+
+		D3D11_BUFFER_DESC desc{};
+		desc.Usage = usage == Usage::Dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+		desc.CPUAccessFlags = usage == Usage::Dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		if (usage == Usage::UnorderedAccess)
+			desc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = sizeof(T);
+		desc.ByteWidth = sizeof(T) * capacity;
+
+		// Default buffers only receive ranged updates, so they start out zeroed
+		std::vector<T> initialData(usage == Usage::Dynamic ? 0 : capacity);
+		D3D11_SUBRESOURCE_DATA subresourceData{ initialData.data(), 0, 0 };
+
+		auto device = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().forwarder;
+		resource = nullptr;
+		DX::ThrowIfFailed(device->CreateBuffer(&desc, initialData.empty() ? nullptr : &subresourceData, resource.put()));
+		resourceAllocations++;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = capacity;
+
+		srv = nullptr;
+		DX::ThrowIfFailed(device->CreateShaderResourceView(resource.get(), &srvDesc, srv.put()));
+		viewAllocations++;
+
+		uav = nullptr;
+		if (usage == Usage::UnorderedAccess) {
+			D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+			uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+			uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+			uavDesc.Buffer.FirstElement = 0;
+			uavDesc.Buffer.NumElements = capacity;
+			DX::ThrowIfFailed(device->CreateUnorderedAccessView(resource.get(), &uavDesc, uav.put()));
+			viewAllocations++;
+		}
+	}
+
+	winrt::com_ptr<ID3D11Buffer> resource;
+	winrt::com_ptr<ID3D11ShaderResourceView> srv;
+	winrt::com_ptr<ID3D11UnorderedAccessView> uav;
+	Usage usage;
+	UINT capacity = 0;
+	UINT count = 0;
+	UINT shrinkCounter = 0;
+};
+
 class Texture2D
 {
 public:
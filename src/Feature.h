@@ -1,5 +1,7 @@
 #pragma once
 
+#include "ShaderCache.h"
+
 struct Feature
 {
 	bool loaded = false;
@@ -27,6 +29,7 @@ struct Feature
 	virtual bool ValidateCache(CSimpleIniA& a_ini);
 	virtual void WriteDiskCacheInfo(CSimpleIniA& a_ini);
 	virtual void ClearShaderCache() {}
+	virtual std::vector<SIE::ComputeShaderDesc> GetComputeShaderDescs() { return {}; }
 
 	// Cat: add all the features in here
 	static const std::vector<Feature*>& GetFeatureList();
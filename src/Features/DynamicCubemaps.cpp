@@ -2,6 +2,8 @@
 #include <Util.h>
 
 constexpr auto MIPLEVELS = 10;
+constexpr std::uint32_t IBL_UPDATE_STEPS = MIPLEVELS;  // step 0 snapshots the capture, every other step prefilters one mip level
+constexpr float IBL_REFRESH_HOURS = 0.5f;              // time of day jumps larger than this (e.g. waiting) refresh at once
 
 void DynamicCubemaps::DrawSettings()
 {
@@ -46,6 +48,19 @@ void DynamicCubemaps::DrawSettings()
 		ImGui::Checkbox("updateCapture", &updateCapture);
 		ImGui::Checkbox("updateIBL", &updateIBL);
 
+		ImGui::SliderInt("IBL Update Frames", (int*)&iblUpdateFrames, 1, (int)IBL_UPDATE_STEPS);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Number of frames each image based lighting update is spread across. Changes of weather, moving to another worldspace or interior, or a large jump in time of day always update at once.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNodeEx("Statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
+		ImGui::Text(std::format("IBL Refreshes : {} ({} full)", iblSchedule.refreshCount, iblSchedule.fullRefreshCount).c_str());
 		ImGui::TreePop();
 	}
 }
@@ -79,8 +94,10 @@ RE::BSEventNotifyControl MenuOpenCloseEventHandler::ProcessEvent(const RE::MenuO
 {
 	// When entering a new cell, reset the capture
 	if (a_event->menuName == RE::LoadingMenu::MENU_NAME) {
-		if (!a_event->opening)
+		if (!a_event->opening) {
 			DynamicCubemaps::GetSingleton()->resetCapture = true;
+			DynamicCubemaps::GetSingleton()->iblSchedule.fullRefresh = true;
+		}
 	}
 	return RE::BSEventNotifyControl::kContinue;
 }
@@ -118,6 +135,16 @@ void DynamicCubemaps::ClearShaderCache()
 	}
 }
 
+std::vector<SIE::ComputeShaderDesc> DynamicCubemaps::GetComputeShaderDescs()
+{
+	return {
+		{ L"Data\\Shaders\\DynamicCubemaps\\UpdateCubemapCS.hlsl" },
+		{ L"Data\\Shaders\\DynamicCubemaps\\InferCubemapCS.hlsl" },
+		{ L"Data\\Shaders\\DynamicCubemaps\\SpecularIrradianceCS.hlsl" },
+		{ L"Data\\Shaders\\DynamicCubemaps\\SpbrdfCS.hlsl" },
+	};
+}
+
 ID3D11ComputeShader* DynamicCubemaps::GetComputeShaderUpdate()
 {
 	if (!updateCubemapCS) {
@@ -217,56 +244,91 @@ void DynamicCubemaps::DrawDeferred()
 		UpdateCubemapCapture();
 }
 
-void DynamicCubemaps::UpdateCubemap()
+bool DynamicCubemaps::IsLargeLightingChange()
 {
-	auto renderer = RE::BSGraphics::Renderer::GetSingleton();
-	auto context = renderer->GetRuntimeData().context;
+	IBLSchedule::LightingState lightingState;
 
-	{
-		ID3D11ShaderResourceView* views[2]{};
-		views[0] = nullptr;
-		views[1] = nullptr;
-		context->PSSetShaderResources(64, 2, views);
+	auto sky = RE::Sky::GetSingleton();
+	lightingState.weather = sky ? sky->currentWeather : nullptr;
+
+	if (auto player = RE::PlayerCharacter::GetSingleton()) {
+		lightingState.worldspace = player->GetWorldspace();
+		auto cell = player->GetParentCell();
+		lightingState.interiorCell = cell && cell->IsInteriorCell() ? cell : nullptr;
 	}
 
-	{
-		// Copy cubemap to other resources
+	auto calendar = RE::Calendar::GetSingleton();
+	lightingState.hour = calendar ? calendar->GetHour() : 0.0f;
+
+	bool changed = IBLSchedule::IsLargeChange(lastLightingState, lightingState, IBL_REFRESH_HOURS);
+	lastLightingState = lightingState;
+	return changed;
+}
+
+void DynamicCubemaps::UpdateIBLStep(std::uint32_t a_step)
+{
+	auto renderer = RE::BSGraphics::Renderer::GetSingleton();
+	auto context = renderer->GetRuntimeData().context;
+
+	if (a_step == 0) {
+		// Snapshot the capture so every mip level of this refresh is filtered from the same frame
 		auto cubemap = renderer->GetRendererData().cubemapRenderTargets[RE::RENDER_TARGETS_CUBEMAP::kREFLECTIONS];
 
 		context->GenerateMips(cubemap.SRV);
+		context->CopyResource(envSourceTexture->resource.get(), cubemap.texture);
 
 		for (uint face = 0; face < 6; face++) {
 			uint srcSubresourceIndex = D3D11CalcSubresource(0, face, MIPLEVELS);
-			context->CopySubresourceRegion(envTexture->resource.get(), D3D11CalcSubresource(0, face, MIPLEVELS), 0, 0, 0, cubemap.texture, srcSubresourceIndex, nullptr);
+			context->CopySubresourceRegion(envBackTexture->resource.get(), D3D11CalcSubresource(0, face, MIPLEVELS), 0, 0, 0, envSourceTexture->resource.get(), srcSubresourceIndex, nullptr);
 		}
+		return;
+	}
 
-		// Compute pre-filtered specular environment map.
-		{
-			auto srv = cubemap.SRV;
-			context->CSSetShaderResources(0, 1, &srv);
-			context->CSSetSamplers(0, 1, &computeSampler);
-			context->CSSetShader(GetComputeShaderSpecularIrradiance(), nullptr, 0);
+	// Compute pre-filtered specular environment map.
+	std::uint32_t level = a_step;
 
-			ID3D11Buffer* buffers[1];
-			buffers[0] = spmapCB->CB();
-			context->CSSetConstantBuffers(0, ARRAYSIZE(buffers), buffers);
+	auto srv = envSourceTexture->srv.get();
+	context->CSSetShaderResources(0, 1, &srv);
+	context->CSSetSamplers(0, 1, &computeSampler);
+	context->CSSetShader(GetComputeShaderSpecularIrradiance(), nullptr, 0);
 
-			float const delta_roughness = 1.0f / std::max(float(MIPLEVELS - 1), 1.0f);
+	ID3D11Buffer* buffers[1];
+	buffers[0] = spmapCB->CB();
+	context->CSSetConstantBuffers(0, ARRAYSIZE(buffers), buffers);
 
-			std::uint32_t size = std::max(envTexture->desc.Width, envTexture->desc.Height);
+	float const delta_roughness = 1.0f / std::max(float(MIPLEVELS - 1), 1.0f);
 
-			for (std::uint32_t level = 1; level < MIPLEVELS; level++, size /= 2) {
-				const UINT numGroups = (UINT)std::max(1u, size / 32);
+	std::uint32_t size = std::max(envBackTexture->desc.Width, envBackTexture->desc.Height) >> (level - 1);
+	const UINT numGroups = (UINT)std::max(1u, size / 32);
 
-				const SpecularMapFilterSettingsCB spmapConstants = { level * delta_roughness };
-				spmapCB->Update(spmapConstants);
+	const SpecularMapFilterSettingsCB spmapConstants = { level * delta_roughness };
+	spmapCB->Update(spmapConstants);
 
-				auto uav = uavArray[level - 1].get();
+	auto uav = uavBackArray[level - 1].get();
 
-				context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
-				context->Dispatch(numGroups, numGroups, 6);
-			}
-		}
+	context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+	context->Dispatch(numGroups, numGroups, 6);
+}
+
+void DynamicCubemaps::UpdateCubemap()
+{
+	auto renderer = RE::BSGraphics::Renderer::GetSingleton();
+	auto context = renderer->GetRuntimeData().context;
+
+	{
+		ID3D11ShaderResourceView* views[2]{};
+		views[0] = nullptr;
+		views[1] = nullptr;
+		context->PSSetShaderResources(64, 2, views);
+	}
+
+	// Large lighting changes restart the refresh and finish it within this frame
+	if (IsLargeLightingChange())
+		iblSchedule.fullRefresh = true;
+
+	if (iblSchedule.Advance(IBL_UPDATE_STEPS, iblUpdateFrames, [&](std::uint32_t a_step) { UpdateIBLStep(a_step); })) {
+		std::swap(envTexture, envBackTexture);
+		std::swap(uavArray, uavBackArray);
 	}
 
 	ID3D11ShaderResourceView* nullSRV = { nullptr };
@@ -409,6 +471,13 @@ void DynamicCubemaps::SetupResources()
 		envTexture->CreateSRV(srvDesc);
 		envTexture->CreateUAV(uavDesc);
 
+		envBackTexture = new Texture2D(texDesc);
+		envBackTexture->CreateSRV(srvDesc);
+		envBackTexture->CreateUAV(uavDesc);
+
+		envSourceTexture = new Texture2D(texDesc);
+		envSourceTexture->CreateSRV(srvDesc);
+
 		envCaptureTexture = new Texture2D(texDesc);
 		envCaptureTexture->CreateSRV(srvDesc);
 		envCaptureTexture->CreateUAV(uavDesc);
@@ -444,6 +513,7 @@ void DynamicCubemaps::SetupResources()
 		for (std::uint32_t level = 1; level < MIPLEVELS; ++level) {
 			uavDesc.Texture2DArray.MipSlice = level;
 			DX::ThrowIfFailed(device->CreateUnorderedAccessView(envTexture->resource.get(), &uavDesc, uavArray[level - 1].put()));
+			DX::ThrowIfFailed(device->CreateUnorderedAccessView(envBackTexture->resource.get(), &uavDesc, uavBackArray[level - 1].put()));
 		}
 	}
 }
@@ -2,6 +2,7 @@
 
 #include "Buffer.h"
 #include "Feature.h"
+#include <Features/DynamicCubemaps/IBLSchedule.h>
 
 class MenuOpenCloseEventHandler : public RE::BSTEventSink<RE::MenuOpenCloseEvent>
 {
@@ -36,6 +37,16 @@ public:
 	Texture2D* envTexture = nullptr;
 	winrt::com_ptr<ID3D11UnorderedAccessView> uavArray[9];
 
+	// Prefiltering is spread across several frames into a back buffer, which is swapped with envTexture once complete
+
+	Texture2D* envBackTexture = nullptr;
+	winrt::com_ptr<ID3D11UnorderedAccessView> uavBackArray[9];
+	Texture2D* envSourceTexture = nullptr;  // snapshot of the capture the current refresh filters from
+
+	std::uint32_t iblUpdateFrames = 4;
+	IBLSchedule iblSchedule;
+	IBLSchedule::LightingState lastLightingState;
+
 	// BRDF 2D LUT
 
 	ID3D11ComputeShader* spBRDFProgram = nullptr;
@@ -66,6 +77,8 @@ public:
 	ID3D11UnorderedAccessView* cubemapUAV;
 
 	void UpdateCubemap();
+	void UpdateIBLStep(std::uint32_t a_step);
+	bool IsLargeLightingChange();
 
 	virtual inline std::string GetName() { return "Dynamic Cubemaps"; }
 	virtual inline std::string GetShortName() { return "DynamicCubemaps"; }
@@ -98,6 +111,7 @@ public:
 	};
 
 	virtual void ClearShaderCache() override;
+	virtual std::vector<SIE::ComputeShaderDesc> GetComputeShaderDescs() override;
 	ID3D11ComputeShader* GetComputeShaderUpdate();
 	ID3D11ComputeShader* GetComputeShaderInferrence();
 	ID3D11ComputeShader* GetComputeShaderSpecularIrradiance();
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Spreads each image based lighting refresh across frames. Step 0 snapshots the capture and every other step prefilters one mip
+// level into the back buffer, which is swapped in once the last step ran. Kept free of game types so it can be tested outside the game.
+struct IBLSchedule
+{
+	// What the lighting of the capture depends on. Exterior cells of one worldspace share their lighting, so walking across cell
+	// borders is not a large change, only moving to another worldspace or interior is.
+	struct LightingState
+	{
+		const void* weather = nullptr;
+		const void* worldspace = nullptr;
+		const void* interiorCell = nullptr;  // nullptr outside
+		float hour = 0.0f;
+	};
+
+	std::uint32_t step = 0;
+	bool fullRefresh = true;
+	std::uint64_t refreshCount = 0;
+	std::uint64_t fullRefreshCount = 0;
+
+	static bool IsLargeChange(const LightingState& a_previous, const LightingState& a_current, float a_refreshHours)
+	{
+		float hourDelta = std::abs(a_current.hour - a_previous.hour);
+		hourDelta = std::min(hourDelta, 24.0f - hourDelta);
+		return a_current.weather != a_previous.weather || a_current.worldspace != a_previous.worldspace ||
+		       a_current.interiorCell != a_previous.interiorCell || hourDelta > a_refreshHours;
+	}
+
+	// Steps a refresh of a_steps steps spread over a_frames frames must run each frame
+	static std::uint32_t GetStepsPerFrame(std::uint32_t a_steps, std::uint32_t a_frames)
+	{
+		std::uint32_t frames = std::clamp(a_frames, 1u, a_steps);
+		return (a_steps + frames - 1) / frames;
+	}
+
+	// Runs this frame's steps through a_runStep(step). A full refresh restarts at step 0 and completes within the frame.
+	// True when the refresh completed this frame and the back buffer has to be swapped in.
+	template <class RunStep>
+	bool Advance(std::uint32_t a_steps, std::uint32_t a_frames, RunStep&& a_runStep)
+	{
+		if (fullRefresh)
+			step = 0;
+
+		std::uint32_t stepsPerFrame = fullRefresh ? a_steps : GetStepsPerFrame(a_steps, a_frames);
+		for (std::uint32_t i = 0; i < stepsPerFrame; i++) {
+			a_runStep(step);
+
+			if (++step == a_steps) {
+				refreshCount++;
+				if (fullRefresh)
+					fullRefreshCount++;
+				step = 0;
+				fullRefresh = false;
+				return true;
+			}
+		}
+		return false;
+	}
+};
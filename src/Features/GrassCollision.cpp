@@ -1,5 +1,6 @@
 #include "GrassCollision.h"
 
+#include "JobSystem.h"
 #include "State.h"
 #include "Util.h"
 
@@ -7,7 +8,15 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
 	GrassCollision::Settings,
 	EnableGrassCollision,
 	RadiusMultiplier,
-	DisplacementMultiplier)
+	DisplacementMultiplier,
+	gatherTimeBudget,
+	nearDistance,
+	farFrameInterval,
+	middleHighFrameInterval,
+	colliderBudget,
+	EnableExtrapolation,
+	EnableAdaptiveInterval,
+	adaptiveDistance)
 
 enum class GrassShaderTechniques
 {
@@ -61,7 +70,81 @@ void GrassCollision::DrawSettings()
 		if (ImGui::IsItemHovered()) {
 			ImGui::BeginTooltip();
 			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
-			ImGui::Text("How many frames to skip before calculating positions again. 0 means calculate every frame (most smooth/costly).");
+			ImGui::Text("How many frames to skip before calculating positions of the player and nearby actors again. 0 means calculate every frame (most smooth/costly).");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::SliderFloat("Near Tier Distance", &settings.nearDistance, 0.0f, 1500.0f);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Actors in combat or doing something interesting within this distance use the calculation frame interval above. Those further away use the far tier interval.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::SliderInt("Far Tier Frame Interval", (int*)&settings.farFrameInterval, 0, 30);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("How many frames to skip before calculating positions of far away actors again.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::SliderInt("Middle-High Tier Frame Interval", (int*)&settings.middleHighFrameInterval, 0, 30);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("How many frames to skip before calculating positions of less active actors (e.g., walking around town) again.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::Checkbox("Enable Extrapolation", (bool*)&settings.EnableExtrapolation);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Moves collisions along their last known velocity on frames where positions are not calculated, so grass keeps up with running actors at higher frame intervals.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::Checkbox("Enable Adaptive Interval", (bool*)&settings.EnableAdaptiveInterval);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Chooses the frame interval of each actor from how fast it moves, replacing the tier intervals above.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		if (settings.EnableAdaptiveInterval) {
+			ImGui::SliderFloat("Adaptive Distance", &settings.adaptiveDistance, 1.0f, 64.0f);
+			if (ImGui::IsItemHovered()) {
+				ImGui::BeginTooltip();
+				ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+				ImGui::Text("How far an actor may move before its positions are calculated again.");
+				ImGui::PopTextWrapPos();
+				ImGui::EndTooltip();
+			}
+		}
+
+		ImGui::SliderInt("Collider Budget", (int*)&settings.colliderBudget, 0, 2048);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Maximum number of collision shapes sent to the GPU. Colliders of the furthest actors are dropped first. 0 means no limit.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::SliderFloat("Gather Time Budget", &settings.gatherTimeBudget, 0.0f, 4.0f, "%.2f ms");
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Time allowed per update for gathering actor collisions. Actors furthest from the player are skipped once it runs out. 0 means no limit.");
 			ImGui::PopTextWrapPos();
 			ImGui::EndTooltip();
 		}
@@ -71,55 +154,112 @@ void GrassCollision::DrawSettings()
 	if (ImGui::TreeNodeEx("Statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
 		ImGui::Text(std::format("Active/Total Actors : {}/{}", activeActorCount, totalActorCount).c_str());
 		ImGui::Text(std::format("Total Collisions : {}", currentCollisionCount).c_str());
+		ImGui::Text(std::format("Near/Far/Middle-High Actors : {}/{}/{}", tierActorCount[(std::uint32_t)CollisionTier::Near], tierActorCount[(std::uint32_t)CollisionTier::Far], tierActorCount[(std::uint32_t)CollisionTier::MiddleHigh]).c_str());
+		ImGui::Text(std::format("Refreshed Actors : {}, {} colliders over budget", refreshedActorCount, budgetDroppedCount).c_str());
+		ImGui::Text(std::format("Gather Time : {:.3f} ms, {} actors skipped", gatherTime, skippedActorCount).c_str());
+		if (collisions)
+			ImGui::Text(std::format("Collision Buffer : {} capacity, {} buffer allocations, {} view allocations", collisions->Capacity(), collisions->resourceAllocations, collisions->viewAllocations).c_str());
+		ImGui::Text(std::format("Shape Extent Cache : {} hits, {} misses", shapeExtentCache.hits, shapeExtentCache.misses).c_str());
+		ImGui::Text(std::format("Collision Grid : {0}x{0} cells of {1:.1f} units, {2} entries", CollisionGridSize, collisionGrid.cellSize, collisionGrid.indices.size()).c_str());
 		ImGui::TreePop();
 	}
 }
 
-static bool GetShapeBound(RE::NiAVObject* a_node, RE::NiPoint3& centerPos, float& radius)
+bool GrassCollision::ShapeExtentCache::Find(const RE::hkpShape* a_shape, float& a_radius)
 {
-	RE::bhkNiCollisionObject* Colliedobj = nullptr;
-	if (a_node->collisionObject)
-		Colliedobj = a_node->collisionObject->AsBhkNiCollisionObject();
+	auto currentGeneration = generation.load();
+	auto hash = (std::uint32_t)((reinterpret_cast<std::uintptr_t>(a_shape) >> 4) * 0x9E3779B97F4A7C15ull >> 32);
+	for (std::uint32_t probe = 0; probe < Capacity; probe++) {
+		auto& entry = entries[(hash + probe) & (Capacity - 1)];
+		if (!entry.shape || entry.generation != currentGeneration)
+			break;
+		if (entry.shape == a_shape) {
+			a_radius = entry.radius;
+			hits++;
+			return true;
+		}
+	}
+	misses++;
+	return false;
+}
 
-	if (!Colliedobj)
+void GrassCollision::ShapeExtentCache::Insert(const RE::hkpShape* a_shape, float a_radius)
+{
+	if (sizeGeneration != generation.load()) {
+		sizeGeneration = generation.load();
+		size = 0;
+	}
+
+	// Nothing is ever erased within a generation, so a full table simply starts a new one
+	if (size >= MaxLoad) {
+		Invalidate();
+		sizeGeneration = generation.load();
+		size = 0;
+	}
+
+	auto hash = (std::uint32_t)((reinterpret_cast<std::uintptr_t>(a_shape) >> 4) * 0x9E3779B97F4A7C15ull >> 32);
+	for (std::uint32_t probe = 0; probe < Capacity; probe++) {
+		auto& entry = entries[(hash + probe) & (Capacity - 1)];
+		if (!entry.shape || entry.generation != sizeGeneration) {
+			entry = { a_shape, sizeGeneration, a_radius };
+			size++;
+			return;
+		}
+		if (entry.shape == a_shape) {
+			entry.radius = a_radius;
+			return;
+		}
+	}
+}
+
+RE::BSEventNotifyControl ObjectLoadedEventHandler::ProcessEvent(const RE::TESObjectLoadedEvent* a_event, RE::BSTEventSource<RE::TESObjectLoadedEvent>*)
+{
+	// Shapes of unloaded actors are freed and their addresses may be reused, so drop every cached extent
+	if (a_event && !a_event->loaded) {
+		if (RE::TESForm::LookupByID<RE::Actor>(a_event->formID))
+			GrassCollision::GetSingleton()->shapeExtentCache.Invalidate();
+	}
+	return RE::BSEventNotifyControl::kContinue;
+}
+
+bool ObjectLoadedEventHandler::Register()
+{
+	static ObjectLoadedEventHandler singleton;
+	auto scriptEventSource = RE::ScriptEventSourceHolder::GetSingleton();
+
+	if (!scriptEventSource) {
+		logger::error("Script event source not found");
 		return false;
+	}
 
-	RE::bhkRigidBody* bhkRigid = Colliedobj->body.get() ? Colliedobj->body.get()->AsBhkRigidBody() : nullptr;
-	RE::hkpRigidBody* hkpRigid = bhkRigid ? skyrim_cast<RE::hkpRigidBody*>(bhkRigid->referencedObject.get()) : nullptr;
-	if (bhkRigid && hkpRigid) {
-		RE::hkVector4 massCenter;
-		bhkRigid->GetCenterOfMassWorld(massCenter);
-		float massTrans[4];
-		_mm_store_ps(massTrans, massCenter.quad);
-		centerPos = RE::NiPoint3(massTrans[0], massTrans[1], massTrans[2]) * RE::bhkWorld::GetWorldScaleInverse();
+	scriptEventSource->AddEventSink<RE::TESObjectLoadedEvent>(&singleton);
 
-		const RE::hkpShape* shape = hkpRigid->collidable.GetShape();
-		if (shape) {
-			float upExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, 1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float downExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, -1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto z_extent = (upExtent + downExtent) / 2.0f;
+	logger::info("Registered {}", typeid(singleton).name());
 
-			float forwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float backwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, -1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto y_extent = (forwardExtent + backwardExtent) / 2.0f;
+	return true;
+}
 
-			float leftExtent = shape->GetMaximumProjection(RE::hkVector4{ 1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float rightExtent = shape->GetMaximumProjection(RE::hkVector4{ -1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto x_extent = (leftExtent + rightExtent) / 2.0f;
+static float GetShapeRadius(const RE::hkpShape* shape)
+{
+	float upExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, 1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
+	float downExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, -1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
+	auto z_extent = (upExtent + downExtent) / 2.0f;
 
-			radius = sqrtf(x_extent * x_extent + y_extent * y_extent + z_extent * z_extent);
+	float forwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
+	float backwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, -1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
+	auto y_extent = (forwardExtent + backwardExtent) / 2.0f;
 
-			return true;
-		}
-	}
+	float leftExtent = shape->GetMaximumProjection(RE::hkVector4{ 1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
+	float rightExtent = shape->GetMaximumProjection(RE::hkVector4{ -1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
+	auto x_extent = (leftExtent + rightExtent) / 2.0f;
 
-	return false;
+	return sqrtf(x_extent * x_extent + y_extent * y_extent + z_extent * z_extent);
 }
 
-static bool GetShapeBound(RE::bhkNiCollisionObject* Colliedobj, RE::NiPoint3& centerPos, float& radius)
+static const RE::hkpShape* GetShapeCentre(RE::bhkNiCollisionObject* Colliedobj, RE::NiPoint3& centerPos)
 {
 	if (!Colliedobj)
-		return false;
+		return nullptr;
 
 	RE::bhkRigidBody* bhkRigid = Colliedobj->body.get() ? Colliedobj->body.get()->AsBhkRigidBody() : nullptr;
 	RE::hkpRigidBody* hkpRigid = bhkRigid ? skyrim_cast<RE::hkpRigidBody*>(bhkRigid->referencedObject.get()) : nullptr;
@@ -130,27 +270,41 @@ static bool GetShapeBound(RE::bhkNiCollisionObject* Colliedobj, RE::NiPoint3& ce
 		_mm_store_ps(massTrans, massCenter.quad);
 		centerPos = RE::NiPoint3(massTrans[0], massTrans[1], massTrans[2]) * RE::bhkWorld::GetWorldScaleInverse();
 
-		const RE::hkpShape* shape = hkpRigid->collidable.GetShape();
-		if (shape) {
-			float upExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, 1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float downExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 0.0f, -1.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto z_extent = (upExtent + downExtent) / 2.0f;
-
-			float forwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, 1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float backwardExtent = shape->GetMaximumProjection(RE::hkVector4{ 0.0f, -1.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto y_extent = (forwardExtent + backwardExtent) / 2.0f;
-
-			float leftExtent = shape->GetMaximumProjection(RE::hkVector4{ 1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			float rightExtent = shape->GetMaximumProjection(RE::hkVector4{ -1.0f, 0.0f, 0.0f, 0.0f }) * RE::bhkWorld::GetWorldScaleInverse();
-			auto x_extent = (leftExtent + rightExtent) / 2.0f;
+		return hkpRigid->collidable.GetShape();
+	}
 
-			radius = sqrtf(x_extent * x_extent + y_extent * y_extent + z_extent * z_extent);
+	return nullptr;
+}
 
-			return true;
-		}
+static float GetCachedShapeRadius(const RE::hkpShape* shape)
+{
+	float radius;
+	auto& shapeExtentCache = GrassCollision::GetSingleton()->shapeExtentCache;
+	if (!shapeExtentCache.Find(shape, radius)) {
+		radius = GetShapeRadius(shape);
+		shapeExtentCache.Insert(shape, radius);
 	}
+	return radius;
+}
 
-	return false;
+bool GrassCollision::IsActorRefreshDue(CollisionTier a_tier, const ActorColliders& a_colliders, std::uint32_t a_frameCount)
+{
+	auto lastUpdateFrame = a_colliders.lastUpdateFrame;
+
+	// Slow actors are extrapolated accurately for longer, so only refresh once they could have moved adaptiveDistance
+	if (settings.EnableAdaptiveInterval)
+		return a_frameCount - lastUpdateFrame > ColliderExtrapolation::GetAdaptiveInterval(a_colliders.velocityMeasured, a_colliders.speed, deltaTime, settings.adaptiveDistance);
+
+	switch (a_tier) {
+	case CollisionTier::Near:
+		return settings.frameInterval == 0 || a_frameCount - lastUpdateFrame >= settings.frameInterval;
+	case CollisionTier::Far:
+		return a_frameCount - lastUpdateFrame > settings.farFrameInterval;
+	case CollisionTier::MiddleHigh:
+		return a_frameCount - lastUpdateFrame > settings.middleHighFrameInterval;
+	default:
+		return true;
+	}
 }
 
 void GrassCollision::UpdateCollisions()
@@ -159,65 +313,155 @@ void GrassCollision::UpdateCollisions()
 
 	auto frameCount = RE::BSGraphics::State::GetSingleton()->uiFrameCount;
 
-	if (settings.frameInterval == 0 || frameCount % settings.frameInterval == 0) {  // only calculate actor positions on some frames
-		currentCollisionCount = 0;
-		totalActorCount = 0;
-		activeActorCount = 0;
-		actorList.clear();
-		collisionsData.clear();
-		// actor query code from po3 under MIT
-		// https://github.com/powerof3/PapyrusExtenderSSE/blob/7a73b47bc87331bec4e16f5f42f2dbc98b66c3a7/include/Papyrus/Functions/Faction.h#L24C7-L46
-		if (const auto processLists = RE::ProcessLists::GetSingleton(); processLists && settings.maxDistance > 0.0f) {
-			std::vector<RE::BSTArray<RE::ActorHandle>*> actors;
-			actors.push_back(&processLists->highActorHandles);  // high actors are in combat or doing something interesting
-			for (auto array : actors) {
-				for (auto& actorHandle : *array) {
-					auto actorPtr = actorHandle.get();
-					if (actorPtr && actorPtr.get() && actorPtr.get()->Is3DLoaded()) {
-						actorList.push_back(actorPtr.get());
-						totalActorCount++;
-					}
+	static float* g_deltaTime = (float*)RELOCATION_ID(523660, 410199).address();  // 2F6B948, 30064C8
+	deltaTime = RE::UI::GetSingleton()->GameIsPaused() ? 0.0f : *g_deltaTime;
+	timer += deltaTime;
+
+	currentCollisionCount = 0;
+	totalActorCount = 0;
+	activeActorCount = 0;
+	collisionsData.clear();
+	actorCollisionTasks.clear();
+	ZeroMemory(tierActorCount, sizeof(tierActorCount));
+
+	RE::NiPoint3 playerPosition;
+	if (auto player = RE::PlayerCharacter::GetSingleton()) {
+		playerPosition = player->GetPosition();
+		if (player->Get3D(false))
+			actorCollisionTasks.push_back({ player, player->GetHandle().native_handle(), 0.0f, CollisionTier::Near });
+	}
+
+	// actor query code from po3 under MIT
+	// https://github.com/powerof3/PapyrusExtenderSSE/blob/7a73b47bc87331bec4e16f5f42f2dbc98b66c3a7/include/Papyrus/Functions/Faction.h#L24C7-L46
+	if (const auto processLists = RE::ProcessLists::GetSingleton(); processLists && settings.maxDistance > 0.0f) {
+		auto addActors = [&](RE::BSTArray<RE::ActorHandle>& a_actorHandles, bool a_high) {
+			for (auto& actorHandle : a_actorHandles) {
+				auto actorPtr = actorHandle.get();
+				if (actorPtr && actorPtr.get() && actorPtr.get()->Is3DLoaded()) {
+					totalActorCount++;
+					auto distance = playerPosition.GetDistance(actorPtr->GetPosition());
+					if (distance > settings.maxDistance)  // npc too far so skip
+						continue;
+					auto tier = CollisionTier::MiddleHigh;
+					if (a_high)
+						tier = distance <= settings.nearDistance ? CollisionTier::Near : CollisionTier::Far;
+					actorCollisionTasks.push_back({ actorPtr.get(), actorHandle.native_handle(), distance, tier });
 				}
 			}
+		};
+		addActors(processLists->highActorHandles, true);  // high actors are in combat or doing something interesting
+		addActors(processLists->middleHighActorHandles, false);
+	}
+
+	// Nearest actors first, so the time and collider budgets only ever drop the furthest ones
+	std::stable_sort(actorCollisionTasks.begin(), actorCollisionTasks.end(), [](const ActorCollisionTask& a, const ActorCollisionTask& b) {
+		return a.distance < b.distance;
+	});
+
+	refreshedActorCount = 0;
+	for (auto& task : actorCollisionTasks) {
+		activeActorCount++;
+		tierActorCount[(std::uint32_t)task.tier]++;
+		auto it = actorColliders.find(task.handle);
+		task.refresh = it == actorColliders.end() || IsActorRefreshDue(task.tier, it->second, frameCount);
+	}
+
+	auto gatherStart = std::chrono::high_resolution_clock::now();
+	auto gatherBudget = std::chrono::duration<float, std::milli>(settings.gatherTimeBudget);
+	auto nearestActor = actorCollisionTasks.empty() ? nullptr : actorCollisionTasks.front().actor;
+
+	// Each actor only writes its own output buffer, so actors can be traversed concurrently
+	JobSystem::GetSingleton()->ForEach(actorCollisionTasks.begin(), actorCollisionTasks.end(), [&](ActorCollisionTask& a_task) {
+		if (!a_task.refresh)
+			return;
+		if (a_task.actor != nearestActor && settings.gatherTimeBudget > 0.0f && std::chrono::high_resolution_clock::now() - gatherStart > gatherBudget) {
+			a_task.skipped = true;
+			return;
 		}
+		if (auto root = a_task.actor->Get3D(false)) {
+			RE::BSVisit::TraverseScenegraphCollision(root, [&](RE::bhkNiCollisionObject* a_object) -> RE::BSVisit::BSVisitControl {
+				RE::NiPoint3 centerPos;
+				if (auto shape = GetShapeCentre(a_object, centerPos))
+					a_task.shapes.push_back({ centerPos, shape });
+				return RE::BSVisit::BSVisitControl::kContinue;
+			});
+		}
+	});
+
+	gatherTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - gatherStart).count();
 
-		RE::NiPoint3 playerPosition;
-		if (auto player = RE::PlayerCharacter::GetSingleton()) {
-			actorList.push_back(player);
-			playerPosition = player->GetPosition();
+	RE::NiPoint3 eyePosition[2]{};
+	for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
+		if (!REL::Module::IsVR()) {
+			eyePosition[eyeIndex] = state->GetRuntimeData().posAdjust.getEye();
+		} else
+			eyePosition[eyeIndex] = state->GetVRRuntimeData().posAdjust.getEye(eyeIndex);
+	}
+
+	// Merge in actor order so the collision list does not depend on thread scheduling
+	skippedActorCount = 0;
+	budgetDroppedCount = 0;
+	for (auto& task : actorCollisionTasks) {
+		auto& cached = actorColliders[task.handle];
+		cached.lastSeenFrame = frameCount;
+
+		if (task.skipped) {
+			skippedActorCount++;
+		} else if (task.refresh) {
+			refreshedActorCount++;
+
+			// Scene graph traversal order is stable, so colliders are matched to their previous position by index and shape
+			float elapsed = (float)(timer - cached.lastUpdateTime);
+			bool matched = cached.lastUpdateFrame && elapsed > 0.0f && cached.colliders.size() == task.shapes.size();
+			cached.speed = 0.0f;
+			cached.velocityMeasured = matched;
+			for (size_t i = 0; i < task.shapes.size(); i++) {
+				auto& actorShape = task.shapes[i];
+				RE::NiPoint3 velocity{};
+				if (matched && cached.colliders[i].shape == actorShape.shape && ColliderExtrapolation::GetVelocity(cached.colliders[i].centre, actorShape.centre, elapsed, velocity))
+					cached.speed = std::max(cached.speed, velocity.Length());
+				else
+					cached.velocityMeasured = false;
+				if (i < cached.colliders.size())
+					cached.colliders[i] = { actorShape.centre, velocity, actorShape.shape, GetCachedShapeRadius(actorShape.shape) };
+				else
+					cached.colliders.push_back({ actorShape.centre, velocity, actorShape.shape, GetCachedShapeRadius(actorShape.shape) });
+			}
+			cached.colliders.resize(task.shapes.size());
+			cached.lastUpdateFrame = frameCount;
+			cached.lastUpdateTime = timer;
 		}
 
-		for (const auto actor : actorList) {
-			if (auto root = actor->Get3D(false)) {
-				if (playerPosition.GetDistance(actor->GetPosition()) > settings.maxDistance) {  // npc too far so skip
-					continue;
-				}
-				activeActorCount++;
-				RE::BSVisit::TraverseScenegraphCollision(root, [&](RE::bhkNiCollisionObject* a_object) -> RE::BSVisit::BSVisitControl {
-					RE::NiPoint3 centerPos;
-					float radius;
-					if (GetShapeBound(a_object, centerPos, radius)) {
-						radius *= settings.RadiusMultiplier;
-						CollisionSData data{};
-						RE::NiPoint3 eyePosition{};
-						for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
-							if (!REL::Module::IsVR()) {
-								eyePosition = state->GetRuntimeData().posAdjust.getEye();
-							} else
-								eyePosition = state->GetVRRuntimeData().posAdjust.getEye(eyeIndex);
-							data.centre[eyeIndex].x = centerPos.x - eyePosition.x;
-							data.centre[eyeIndex].y = centerPos.y - eyePosition.y;
-							data.centre[eyeIndex].z = centerPos.z - eyePosition.z;
-						}
-						data.radius = radius;
-						currentCollisionCount++;
-						collisionsData.push_back(data);
-					}
-					return RE::BSVisit::BSVisitControl::kContinue;
-				});
+		float extrapolationTime = settings.EnableExtrapolation ? (float)(timer - cached.lastUpdateTime) : 0.0f;
+
+		for (auto& collider : cached.colliders) {
+			if (settings.colliderBudget && currentCollisionCount >= settings.colliderBudget) {
+				budgetDroppedCount++;
+				continue;
+			}
+			auto centre = ColliderExtrapolation::Extrapolate(collider.centre, collider.velocity, extrapolationTime);
+			CollisionSData data{};
+			for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
+				data.centre[eyeIndex].x = centre.x - eyePosition[eyeIndex].x;
+				data.centre[eyeIndex].y = centre.y - eyePosition[eyeIndex].y;
+				data.centre[eyeIndex].z = centre.z - eyePosition[eyeIndex].z;
 			}
+			data.radius = collider.radius * settings.RadiusMultiplier;
+			currentCollisionCount++;
+			collisionsData.push_back(data);
 		}
 	}
+
+	actorCollisionTasks.clear();
+
+	// Forget actors that left every tier
+	for (auto it = actorColliders.begin(); it != actorColliders.end();) {
+		if (it->second.lastSeenFrame != frameCount)
+			it = actorColliders.erase(it);
+		else
+			++it;
+	}
+
 	if (!currentCollisionCount) {
 		CollisionSData data{};
 		ZeroMemory(&data, sizeof(data));
@@ -225,34 +469,37 @@ void GrassCollision::UpdateCollisions()
 		currentCollisionCount = 1;
 	}
 
-	bool collisionCountChanged = currentCollisionCount != colllisionCount;
-
-	if (!collisions || collisionCountChanged) {
-		colllisionCount = currentCollisionCount;
-
-		D3D11_BUFFER_DESC sbDesc{};
-		sbDesc.Usage = D3D11_USAGE_DYNAMIC;
-		sbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-		sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-		sbDesc.StructureByteStride = sizeof(CollisionSData);
-		sbDesc.ByteWidth = sizeof(CollisionSData) * colllisionCount;
-		collisions = std::make_unique<Buffer>(sbDesc);
-
-		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-		srvDesc.Buffer.FirstElement = 0;
-		srvDesc.Buffer.NumElements = colllisionCount;
-		collisions->CreateSRV(srvDesc);
-	}
+	colllisionCount = currentCollisionCount;
+
+	if (!collisions)
+		collisions = std::make_unique<DynamicStructuredBuffer<CollisionSData>>();
+	collisions->Update(collisionsData.data(), colllisionCount);
+
+	BuildCollisionGrid();
 
-	auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
-	D3D11_MAPPED_SUBRESOURCE mapped;
-	DX::ThrowIfFailed(context->Map(collisions->resource.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
-	size_t bytes = sizeof(CollisionSData) * colllisionCount;
-	memcpy_s(mapped.pData, bytes, collisionsData.data(), bytes);
-	context->Unmap(collisions->resource.get(), 0);
+	if (!collisionGridCells)
+		collisionGridCells = std::make_unique<DynamicStructuredBuffer<CollisionGrid::Cell>>(CollisionGridSize * CollisionGridSize);
+	collisionGridCells->Update(collisionGrid.cells.data(), (UINT)collisionGrid.cells.size());
+
+	if (!collisionGridIndices)
+		collisionGridIndices = std::make_unique<DynamicStructuredBuffer<std::uint32_t>>();
+	collisionGridIndices->Update(collisionGrid.indices.data(), (UINT)collisionGrid.indices.size());
+}
+
+void GrassCollision::BuildCollisionGrid()
+{
+	ZeroMemory(collisionGridOrigin, sizeof(collisionGridOrigin));
+
+	auto reference = CollisionGrid::Build(std::span<const CollisionSData>(collisionsData.data(), colllisionCount), CollisionGridSize, collisionGrid);
+	if (reference == colllisionCount)
+		return;
+
+	// Collider centres are eye relative, so the offset between eyes is the same for every collider
+	auto& referenceCollision = collisionsData[reference];
+	for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
+		collisionGridOrigin[eyeIndex].x = collisionGrid.minX + referenceCollision.centre[eyeIndex].x - referenceCollision.centre[0].x;
+		collisionGridOrigin[eyeIndex].y = collisionGrid.minY + referenceCollision.centre[eyeIndex].y - referenceCollision.centre[0].y;
+	}
 }
 
 void GrassCollision::ModifyGrass(const RE::BSShader*, const uint32_t)
@@ -287,6 +534,12 @@ void GrassCollision::ModifyGrass(const RE::BSShader*, const uint32_t)
 
 		perFrameData.Settings = settings;
 
+		for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++)
+			perFrameData.gridOrigin[eyeIndex] = collisionGridOrigin[eyeIndex];
+		perFrameData.gridCellSize = collisionGrid.cellSize;
+		perFrameData.gridSize = CollisionGridSize;
+		perFrameData.collisionCount = colllisionCount;
+
 		perFrame->Update(perFrameData);
 
 		updatePerFrame = false;
@@ -295,8 +548,10 @@ void GrassCollision::ModifyGrass(const RE::BSShader*, const uint32_t)
 	if (settings.EnableGrassCollision) {
 		auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
 
-		ID3D11ShaderResourceView* views[1]{};
-		views[0] = collisions->srv.get();
+		ID3D11ShaderResourceView* views[3]{};
+		views[0] = collisions->SRV();
+		views[1] = collisionGridCells->SRV();
+		views[2] = collisionGridIndices->SRV();
 		context->VSSetShaderResources(0, ARRAYSIZE(views), views);
 
 		ID3D11Buffer* buffers[1];
@@ -332,6 +587,11 @@ void GrassCollision::SetupResources()
 	perFrame = new ConstantBuffer(ConstantBufferDesc<PerFrame>());
 }
 
+void GrassCollision::DataLoaded()
+{
+	ObjectLoadedEventHandler::Register();
+}
+
 void GrassCollision::Reset()
 {
 	updatePerFrame = true;
@@ -2,6 +2,18 @@
 
 #include "Buffer.h"
 #include "Feature.h"
+#include "FrameArena.h"
+#include <Features/GrassCollision/ColliderExtrapolation.h>
+#include <Features/GrassCollision/CollisionGrid.h>
+
+#include <atomic>
+
+class ObjectLoadedEventHandler : public RE::BSTEventSink<RE::TESObjectLoadedEvent>
+{
+public:
+	virtual RE::BSEventNotifyControl ProcessEvent(const RE::TESObjectLoadedEvent* a_event, RE::BSTEventSource<RE::TESObjectLoadedEvent>* a_eventSource);
+	static bool Register();
+};
 
 struct GrassCollision : Feature
 {
@@ -24,6 +36,14 @@ struct GrassCollision : Feature
 		float DisplacementMultiplier = 16;
 		float maxDistance = 1000.0;
 		std::uint32_t frameInterval = 0;
+		float gatherTimeBudget = 1.0f;
+		float nearDistance = 400.0f;
+		std::uint32_t farFrameInterval = 2;
+		std::uint32_t middleHighFrameInterval = 4;
+		std::uint32_t colliderBudget = 512;
+		std::uint32_t EnableExtrapolation = 1;
+		std::uint32_t EnableAdaptiveInterval = 0;
+		float adaptiveDistance = 8.0f;
 	};
 
 	struct alignas(16) PerFrame
@@ -32,6 +52,11 @@ struct GrassCollision : Feature
 		float boundRadius;
 		Settings Settings;
 		float pad01[2];
+		Vector4 gridOrigin[2];
+		float gridCellSize;
+		std::uint32_t gridSize;
+		std::uint32_t collisionCount;
+		float pad02;
 	};
 
 	struct CollisionSData
@@ -40,11 +65,100 @@ struct GrassCollision : Feature
 		float radius;
 	};
 
-	std::unique_ptr<Buffer> collisions = nullptr;
+	// Colliders are binned into a uniform XY grid so each grass vertex only tests the colliders of its own cell
+	static constexpr std::uint32_t CollisionGridSize = 16;
+
+	// Shape extents only depend on the shape, so the radius is cached per hkpShape and only the centre is updated
+	struct ShapeExtentCache
+	{
+		static constexpr std::uint32_t Capacity = 1024;  // power of two, open addressing with linear probing
+		static constexpr std::uint32_t MaxLoad = Capacity * 3 / 4;
+
+		struct Entry
+		{
+			const RE::hkpShape* shape = nullptr;
+			std::uint32_t generation = 0;
+			float radius = 0.0f;
+		};
+
+		std::array<Entry, Capacity> entries{};
+		std::atomic<std::uint32_t> generation = 1;  // entries from older generations are treated as empty
+		std::uint32_t sizeGeneration = 0;
+		std::uint32_t size = 0;
+
+		std::uint64_t hits = 0;
+		std::uint64_t misses = 0;
+
+		bool Find(const RE::hkpShape* a_shape, float& a_radius);
+		void Insert(const RE::hkpShape* a_shape, float a_radius);
+		void Invalidate() { generation++; }
+	};
+
+	ShapeExtentCache shapeExtentCache;
+
+	std::unique_ptr<DynamicStructuredBuffer<CollisionSData>> collisions = nullptr;
+	std::unique_ptr<DynamicStructuredBuffer<CollisionGrid::Cell>> collisionGridCells = nullptr;
+	std::unique_ptr<DynamicStructuredBuffer<std::uint32_t>> collisionGridIndices = nullptr;
+	CollisionGrid::Grid collisionGrid;
+	Vector4 collisionGridOrigin[2]{};
 	std::uint32_t totalActorCount = 0;
 	std::uint32_t activeActorCount = 0;
 	std::uint32_t currentCollisionCount = 0;
-	std::vector<RE::Actor*> actorList{};
+
+	// Actors are refreshed at a cadence that depends on their tier, and reuse their cached colliders in between
+	enum class CollisionTier : std::uint32_t
+	{
+		Near,        // player and high process actors within nearDistance
+		Far,         // high process actors beyond nearDistance
+		MiddleHigh,  // middle-high process actors
+		Count
+	};
+
+	struct ActorCollisionShape
+	{
+		RE::NiPoint3 centre;
+		const RE::hkpShape* shape;
+	};
+
+	struct ActorCollisionTask
+	{
+		RE::Actor* actor;
+		std::uint32_t handle;
+		float distance;
+		CollisionTier tier;
+		bool refresh = false;
+		bool skipped = false;
+		FrameVector<ActorCollisionShape> shapes{};
+	};
+
+	struct WorldCollider
+	{
+		RE::NiPoint3 centre;
+		RE::NiPoint3 velocity;
+		const RE::hkpShape* shape;
+		float radius;  // without RadiusMultiplier, so the setting applies immediately
+	};
+
+	struct ActorColliders
+	{
+		std::vector<WorldCollider> colliders{};
+		std::uint32_t lastUpdateFrame = 0;
+		std::uint32_t lastSeenFrame = 0;
+		double lastUpdateTime = 0;
+		float speed = 0.0f;  // fastest collider, drives the adaptive interval
+		bool velocityMeasured = false;  // false after the first refresh, a teleport or a change of shapes
+	};
+
+	double timer = 0;
+	float deltaTime = 0.0f;
+
+	std::vector<ActorCollisionTask> actorCollisionTasks{};  // only valid during UpdateCollisions, the shapes live in the frame arena
+	eastl::hash_map<std::uint32_t, ActorColliders> actorColliders;
+	std::uint32_t tierActorCount[(std::uint32_t)CollisionTier::Count]{};
+	std::uint32_t refreshedActorCount = 0;
+	std::uint32_t skippedActorCount = 0;
+	std::uint32_t budgetDroppedCount = 0;
+	float gatherTime = 0.0f;
 	std::vector<CollisionSData> collisionsData{};
 	std::uint32_t colllisionCount = 0;
 
@@ -56,9 +170,12 @@ struct GrassCollision : Feature
 
 	virtual void SetupResources();
 	virtual void Reset();
+	virtual void DataLoaded() override;
 
 	virtual void DrawSettings();
 	void UpdateCollisions();
+	bool IsActorRefreshDue(CollisionTier a_tier, const ActorColliders& a_colliders, std::uint32_t a_frameCount);
+	void BuildCollisionGrid();
 	void ModifyGrass(const RE::BSShader* shader, const uint32_t descriptor);
 	virtual void Draw(const RE::BSShader* shader, const uint32_t descriptor);
 
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Between refreshes, collider centres are moved along the velocity measured over the last two refreshes, so skipped frames do
+// not leave grass lagging behind. Kept free of game types so the error can be simulated outside the game, a vector is anything
+// with +, -, * by a float and Length().
+namespace ColliderExtrapolation
+{
+	inline constexpr float MaxExtrapolationTime = 0.25f;
+	inline constexpr float MaxColliderSpeed = 2048.0f;  // anything faster is treated as a teleport
+	inline constexpr std::uint32_t MaxAdaptiveInterval = 30;
+
+	// False, with a zero velocity, for a teleport or when the time between refreshes is unknown
+	template <class Vector>
+	bool GetVelocity(const Vector& a_previous, const Vector& a_current, float a_elapsed, Vector& a_velocity)
+	{
+		a_velocity = {};
+		if (a_elapsed <= 0.0f)
+			return false;
+		auto velocity = (a_current - a_previous) * (1.0f / a_elapsed);
+		if (velocity.Length() > MaxColliderSpeed)
+			return false;
+		a_velocity = velocity;
+		return true;
+	}
+
+	template <class Vector>
+	Vector Extrapolate(const Vector& a_centre, const Vector& a_velocity, float a_timeSinceRefresh)
+	{
+		return a_centre + a_velocity * std::clamp(a_timeSinceRefresh, 0.0f, MaxExtrapolationTime);
+	}
+
+	// Frames to wait before the next refresh, once the actor could have moved a_distance at its last measured speed.
+	// Without a measurement, for an actor that just came into range or teleported, it could be moving at any speed so refresh right away.
+	inline std::uint32_t GetAdaptiveInterval(bool a_measured, float a_speed, float a_deltaTime, float a_distance)
+	{
+		if (!a_measured)
+			return 0;
+		float frameDistance = a_speed * a_deltaTime;
+		if (frameDistance <= 0.0f)
+			return MaxAdaptiveInterval;
+		return (std::uint32_t)std::clamp(a_distance / frameDistance, 0.0f, (float)MaxAdaptiveInterval);
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+// Uniform XY grid over the colliders, so each grass vertex only tests the colliders binned into its own cell.
+// Kept free of game types so it can be tested outside the game. A collider is anything with centre[0].x, centre[0].y
+// and radius, colliders with no radius are left out.
+namespace CollisionGrid
+{
+	struct Cell
+	{
+		std::uint32_t offset;
+		std::uint32_t count;
+	};
+
+	struct Grid
+	{
+		std::uint32_t size = 0;
+		float minX = 0.0f;
+		float minY = 0.0f;
+		float cellSize = 0.0f;  // 0 when there is nothing to collide with
+		std::vector<Cell> cells;
+		std::vector<std::uint32_t> indices;
+	};
+
+	inline std::uint32_t GetCell(const Grid& a_grid, float a_position, float a_min)
+	{
+		return (std::uint32_t)std::clamp((int)std::floor((a_position - a_min) / a_grid.cellSize), 0, (int)a_grid.size - 1);
+	}
+
+	// Returns the index of the first collider the grid was built from, or a_colliders.size() if there was none
+	template <class Collider>
+	size_t Build(std::span<const Collider> a_colliders, std::uint32_t a_size, Grid& a_grid)
+	{
+		a_grid.size = a_size;
+		a_grid.cells.assign(a_size * a_size, Cell{});
+		a_grid.indices.clear();
+		a_grid.minX = a_grid.minY = a_grid.cellSize = 0.0f;
+
+		// The grid covers the XY footprint of every collider, so vertices outside of it cannot be displaced
+		float minX = std::numeric_limits<float>::max(), minY = std::numeric_limits<float>::max();
+		float maxX = -std::numeric_limits<float>::max(), maxY = -std::numeric_limits<float>::max();
+		size_t reference = a_colliders.size();
+		for (size_t i = 0; i < a_colliders.size(); i++) {
+			auto& collider = a_colliders[i];
+			if (collider.radius <= 0.0f)
+				continue;
+			minX = std::min(minX, collider.centre[0].x - collider.radius);
+			minY = std::min(minY, collider.centre[0].y - collider.radius);
+			maxX = std::max(maxX, collider.centre[0].x + collider.radius);
+			maxY = std::max(maxY, collider.centre[0].y + collider.radius);
+			if (reference == a_colliders.size())
+				reference = i;
+		}
+
+		if (reference == a_colliders.size())
+			return reference;
+
+		a_grid.minX = minX;
+		a_grid.minY = minY;
+		a_grid.cellSize = std::max(std::max(maxX - minX, maxY - minY) / a_size, 1.0f);
+
+		auto forEachCell = [&](const Collider& a_collider, auto&& a_func) {
+			std::uint32_t x0 = GetCell(a_grid, a_collider.centre[0].x - a_collider.radius, minX);
+			std::uint32_t x1 = GetCell(a_grid, a_collider.centre[0].x + a_collider.radius, minX);
+			std::uint32_t y0 = GetCell(a_grid, a_collider.centre[0].y - a_collider.radius, minY);
+			std::uint32_t y1 = GetCell(a_grid, a_collider.centre[0].y + a_collider.radius, minY);
+			for (std::uint32_t y = y0; y <= y1; y++)
+				for (std::uint32_t x = x0; x <= x1; x++)
+					a_func(a_grid.cells[y * a_size + x]);
+		};
+
+		// Count, prefix sum, then fill so every cell owns a contiguous run of collider indices
+		for (auto& collider : a_colliders) {
+			if (collider.radius > 0.0f)
+				forEachCell(collider, [](Cell& a_cell) { a_cell.count++; });
+		}
+
+		std::uint32_t offset = 0;
+		for (auto& cell : a_grid.cells) {
+			cell.offset = offset;
+			offset += cell.count;
+			cell.count = 0;
+		}
+		a_grid.indices.resize(offset);
+
+		for (std::uint32_t i = 0; i < (std::uint32_t)a_colliders.size(); i++) {
+			if (a_colliders[i].radius > 0.0f)
+				forEachCell(a_colliders[i], [&](Cell& a_cell) { a_grid.indices[a_cell.offset + a_cell.count++] = i; });
+		}
+		return reference;
+	}
+
+	// The colliders a vertex at a_x, a_y tests, as GetDisplacedPosition in GrassCollision.hlsli looks them up
+	inline std::span<const std::uint32_t> GetColliders(const Grid& a_grid, float a_x, float a_y)
+	{
+		if (a_grid.cellSize <= 0.0f)
+			return {};
+		int x = (int)std::floor((a_x - a_grid.minX) / a_grid.cellSize);
+		int y = (int)std::floor((a_y - a_grid.minY) / a_grid.cellSize);
+		if (x < 0 || y < 0 || x >= (int)a_grid.size || y >= (int)a_grid.size)
+			return {};
+		auto& cell = a_grid.cells[y * a_grid.size + x];
+		return { a_grid.indices.data() + cell.offset, cell.count };
+	}
+}
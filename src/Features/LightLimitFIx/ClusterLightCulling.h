@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// CPU model of the light culling passes, ClusterCullingCS counting then filling and ClusterPrefixSumCS in between,
+// kept free of game types so the packing of the light list can be tested outside the game. Keep it in step with the shaders.
+namespace ClusterLightCulling
+{
+	inline constexpr std::uint32_t MaxClusterSize = 64;
+	inline constexpr std::uint32_t PrefixSumGroupSize = 1024;  // GROUP_SIZE in ClusterPrefixSumCS
+
+	inline std::uint32_t ClampClusterSize(std::uint32_t a_size)
+	{
+		return std::clamp(a_size, 1u, MaxClusterSize);
+	}
+
+	struct ClusterAABB
+	{
+		float minPoint[3];
+		float maxPoint[3];
+	};
+
+	struct Light
+	{
+		float positionVS[3];
+		float radius;
+	};
+
+	struct LightGrid
+	{
+		std::uint32_t offset;
+		std::uint32_t lightCount;
+	};
+
+	inline bool LightIntersectsCluster(const Light& a_light, const ClusterAABB& a_cluster)
+	{
+		// Released light slots are zeroed
+		if (a_light.radius <= 0)
+			return false;
+
+		float distanceSquared = 0;
+		for (int i = 0; i < 3; i++) {
+			float closest = std::max(a_cluster.minPoint[i], std::min(a_light.positionVS[i], a_cluster.maxPoint[i]));
+			float distance = closest - a_light.positionVS[i];
+			distanceSquared += distance * distance;
+		}
+		return distanceSquared <= a_light.radius * a_light.radius;
+	}
+
+	// ClusterCullingCS without CLUSTER_FILL
+	inline void CountLights(std::span<const ClusterAABB> a_clusters, std::span<const Light> a_lights, std::span<LightGrid> a_grid)
+	{
+		for (size_t clusterIndex = 0; clusterIndex < a_clusters.size(); clusterIndex++) {
+			std::uint32_t visibleLightCount = 0;
+			for (auto& light : a_lights)
+				visibleLightCount += LightIntersectsCluster(light, a_clusters[clusterIndex]);
+			a_grid[clusterIndex] = { 0, visibleLightCount };
+		}
+	}
+
+	// ClusterPrefixSumCS, one thread per run of clusters. Returns the untruncated total written to the light counter.
+	inline std::uint32_t PrefixSum(std::span<LightGrid> a_grid, std::uint32_t a_lightListCapacity)
+	{
+		auto clusterCount = (std::uint32_t)a_grid.size();
+		std::uint32_t runLength = (clusterCount + PrefixSumGroupSize - 1) / PrefixSumGroupSize;
+
+		std::vector<std::uint32_t> runTotals(PrefixSumGroupSize);
+		for (std::uint32_t groupIndex = 0; groupIndex < PrefixSumGroupSize; groupIndex++) {
+			std::uint32_t runStart = std::min(groupIndex * runLength, clusterCount);
+			std::uint32_t runEnd = std::min(runStart + runLength, clusterCount);
+			for (std::uint32_t clusterIndex = runStart; clusterIndex < runEnd; clusterIndex++)
+				runTotals[groupIndex] += a_grid[clusterIndex].lightCount;
+		}
+
+		std::uint32_t runOffset = 0;
+		for (std::uint32_t groupIndex = 0; groupIndex < PrefixSumGroupSize; groupIndex++) {
+			std::uint32_t runStart = std::min(groupIndex * runLength, clusterCount);
+			std::uint32_t runEnd = std::min(runStart + runLength, clusterCount);
+			std::uint32_t offset = runOffset;
+			for (std::uint32_t runIndex = runStart; runIndex < runEnd; runIndex++) {
+				std::uint32_t count = a_grid[runIndex].lightCount;
+				a_grid[runIndex].offset = offset;
+				// Clusters past the end of the list are truncated until the list has grown
+				a_grid[runIndex].lightCount = std::min(count, a_lightListCapacity - std::min(offset, a_lightListCapacity));
+				offset += count;
+			}
+			runOffset += runTotals[groupIndex];
+		}
+		return runOffset;
+	}
+
+	// ClusterCullingCS with CLUSTER_FILL, a_lightList holds the capacity the prefix sum was run with
+	inline void FillLights(std::span<const ClusterAABB> a_clusters, std::span<const Light> a_lights, std::span<const LightGrid> a_grid, std::span<std::uint32_t> a_lightList)
+	{
+		for (size_t clusterIndex = 0; clusterIndex < a_clusters.size(); clusterIndex++) {
+			auto [listOffset, listCount] = a_grid[clusterIndex];
+			std::uint32_t visibleLightCount = 0;
+			for (std::uint32_t lightIndex = 0; lightIndex < (std::uint32_t)a_lights.size(); lightIndex++) {
+				if (LightIntersectsCluster(a_lights[lightIndex], a_clusters[clusterIndex])) {
+					if (visibleLightCount < listCount)
+						a_lightList[listOffset + visibleLightCount] = lightIndex;
+					visibleLightCount++;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <PerlinNoise.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+// Flicker of particle lights. The noise is seeded from the geometry alone, so its permutation tables are built once per
+// geometry and cached instead of once per light per frame. Kept free of game types so it can be benchmarked outside the game.
+namespace FlickerNoise
+{
+	inline constexpr std::uint32_t Lifetime = 600;  // frames without flickering before an entry is dropped
+
+	struct Entry
+	{
+		siv::PerlinNoise perlin[4];
+		std::uint32_t frame;
+	};
+
+	struct Flicker
+	{
+		float x;
+		float y;
+		float z;
+		float intensity;
+	};
+
+	inline Entry Create(std::uint32_t a_seed, std::uint32_t a_frame)
+	{
+		return Entry{ { siv::PerlinNoise{ a_seed }, siv::PerlinNoise{ a_seed + 1 }, siv::PerlinNoise{ a_seed + 2 }, siv::PerlinNoise{ a_seed + 3 } }, a_frame };
+	}
+
+	// The intensity noise is the same for every channel, so it is only evaluated once
+	inline Flicker Evaluate(const Entry& a_entry, double a_scaledTimer, float a_movement, float a_intensity)
+	{
+		return {
+			(float)a_entry.perlin[0].noise1D(a_scaledTimer) * a_movement,
+			(float)a_entry.perlin[1].noise1D(a_scaledTimer) * a_movement,
+			(float)a_entry.perlin[2].noise1D(a_scaledTimer) * a_movement,
+			(float)a_entry.perlin[3].noise1D_01(a_scaledTimer) * a_intensity
+		};
+	}
+
+	// a_cache maps whatever identifies the geometry to an Entry
+	template <class Map, class Key>
+	Entry& Get(Map& a_cache, const Key& a_key, std::uint32_t a_seed, std::uint32_t a_frame, std::uint64_t& a_hits, std::uint64_t& a_misses)
+	{
+		auto it = a_cache.find(a_key);
+		if (it != a_cache.end()) {
+			a_hits++;
+			it->second.frame = a_frame;
+			return it->second;
+		}
+		a_misses++;
+		return a_cache.insert_or_assign(a_key, Create(a_seed, a_frame)).first->second;
+	}
+
+	template <class Map>
+	void Trim(Map& a_cache, std::uint32_t a_frame)
+	{
+		for (auto it = a_cache.begin(); it != a_cache.end();) {
+			if (a_frame - it->second.frame > Lifetime)
+				it = a_cache.erase(it);
+			else
+				++it;
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Selection of the lights kept when there are more than the budget, kept free of game types so it can be tested outside the game.
+namespace LightBudget
+{
+	struct Fade
+	{
+		float fade;
+		std::uint32_t frame;
+	};
+
+	// Projected coverage falls off with the squared distance, and is full once the camera is inside the light
+	template <class Vector>
+	float GetImportance(const Vector& a_position, float a_radius, const Vector& a_color, const Vector& a_eyePosition)
+	{
+		float x = a_position.x - a_eyePosition.x;
+		float y = a_position.y - a_eyePosition.y;
+		float z = a_position.z - a_eyePosition.z;
+		float distanceSquared = x * x + y * y + z * z;
+		float radiusSquared = a_radius * a_radius;
+		float coverage = distanceSquared > radiusSquared ? radiusSquared / distanceSquared : 1.0f;
+		float luminance = a_color.x * 0.3f + a_color.y * 0.59f + a_color.z * 0.11f;
+		return coverage * luminance;
+	}
+
+	// Keeps the a_budget candidates of highest importance. Each candidate has a fade that moves by a_fadeStep toward 1 while it
+	// is selected and toward 0 while it is not, also once everything fits the budget again, so lights never pop.
+	// a_applyFade(candidate, fade) scales a kept candidate, rejected candidates are removed once they have faded out.
+	// Importance only has to be set when there are more candidates than the budget. Returns the candidates still fading out.
+	template <class Candidates, class Fades, class ApplyFade>
+	std::uint32_t Select(Candidates& a_candidates, Fades& a_fades, size_t a_budget, float a_fadeStep, std::uint32_t a_frame, ApplyFade&& a_applyFade)
+	{
+		auto budgetEnd = a_candidates.begin() + std::min(a_budget, (size_t)a_candidates.size());
+		if (budgetEnd != a_candidates.end()) {
+			// Partition so the first a_budget candidates are the most important, in linear time
+			std::nth_element(a_candidates.begin(), budgetEnd, a_candidates.end(), [](const auto& a, const auto& b) {
+				return a.importance > b.importance;
+			});
+		}
+
+		std::uint32_t fading = 0;
+		auto kept = budgetEnd;
+		for (auto it = a_candidates.begin(); it != a_candidates.end(); ++it) {
+			bool selected = it < budgetEnd;
+			auto [fadeIt, inserted] = a_fades.insert({ it->key, { selected ? 1.0f : 0.0f, a_frame } });
+			auto& fade = fadeIt->second;
+			if (!inserted)
+				fade.fade = selected ? std::min(1.0f, fade.fade + a_fadeStep) : std::max(0.0f, fade.fade - a_fadeStep);
+			fade.frame = a_frame;
+
+			a_applyFade(*it, fade.fade);
+
+			// Rejected lights stay until they have faded out
+			if (!selected && fade.fade > 0.0f) {
+				std::iter_swap(it, kept++);
+				fading++;
+			}
+		}
+		a_candidates.erase(kept, a_candidates.end());
+
+		for (auto it = a_fades.begin(); it != a_fades.end();) {
+			if (it->second.frame != a_frame)
+				it = a_fades.erase(it);
+			else
+				++it;
+		}
+		return fading;
+	}
+}
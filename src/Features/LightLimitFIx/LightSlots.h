@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Keeps each light in the same slot of the light buffer for as long as it stays visible, keyed on whatever identifies
+// the light across frames, so only slots whose data changed have to be uploaded. Kept free of game types so it can be
+// tested and benchmarked outside the game.
+template <class T>
+class LightSlots
+{
+	static_assert(std::is_trivially_copyable_v<T>, "slots are compared and uploaded as raw bytes");
+
+public:
+	// Returns false when the slot already held the same data and nothing has to be uploaded
+	bool Assign(std::uint64_t a_key, const T& a_data, std::uint32_t a_frame)
+	{
+		// Two lights can share a key within a frame, e.g. overlapping cluster cells, so probe for a free one
+		auto it = slots.find(a_key);
+		while (it != slots.end() && frames[it->second] == a_frame)
+			it = slots.find(++a_key);
+
+		std::uint32_t slot;
+		if (it != slots.end()) {
+			slot = it->second;
+			if (!std::memcmp(&data[slot], &a_data, sizeof(T))) {
+				frames[slot] = a_frame;
+				return false;
+			}
+		} else {
+			if (!freeSlots.empty()) {
+				slot = freeSlots.back();
+				freeSlots.pop_back();
+			} else {
+				slot = (std::uint32_t)keys.size();
+				keys.push_back(0);
+				frames.push_back(0);
+				data.push_back({});
+			}
+			slots.insert({ a_key, slot });
+			keys[slot] = a_key;
+		}
+
+		frames[slot] = a_frame;
+		data[slot] = a_data;
+		dirtySlots.push_back(slot);
+		return true;
+	}
+
+	// Frees every slot not assigned in a_frame, zeroing its data so consumers can skip it until it is reused
+	void ReleaseStale(std::uint32_t a_frame)
+	{
+		for (std::uint32_t slot = 0; slot < (std::uint32_t)keys.size(); slot++) {
+			if (keys[slot] && frames[slot] != a_frame) {
+				slots.erase(keys[slot]);
+				keys[slot] = 0;
+				data[slot] = {};
+				freeSlots.push_back(slot);
+				dirtySlots.push_back(slot);
+			}
+		}
+	}
+
+	// Coalesces the dirty slots into contiguous ranges and calls a_upload(first, count) for each, returns the slots uploaded
+	template <class Upload>
+	std::uint32_t FlushDirty(Upload&& a_upload)
+	{
+		std::sort(dirtySlots.begin(), dirtySlots.end());
+		dirtySlots.erase(std::unique(dirtySlots.begin(), dirtySlots.end()), dirtySlots.end());
+
+		std::uint32_t uploaded = 0;
+		for (size_t i = 0; i < dirtySlots.size();) {
+			std::uint32_t first = dirtySlots[i];
+			std::uint32_t last = first;
+			while (++i < dirtySlots.size() && dirtySlots[i] == last + 1)
+				last++;
+			a_upload(first, last - first + 1);
+			uploaded += last - first + 1;
+		}
+		dirtySlots.clear();
+		return uploaded;
+	}
+
+	void ClearDirty() { dirtySlots.clear(); }
+
+	// Drops free slots from the end so the used range stays compact, call after the released slots were uploaded
+	void Trim()
+	{
+		while (!keys.empty() && !keys.back()) {
+			keys.pop_back();
+			frames.pop_back();
+			data.pop_back();
+		}
+		auto count = (std::uint32_t)keys.size();
+		freeSlots.erase(std::remove_if(freeSlots.begin(), freeSlots.end(), [count](std::uint32_t slot) { return slot >= count; }), freeSlots.end());
+
+		// Hand out the lowest slots first
+		std::sort(freeSlots.begin(), freeSlots.end(), std::greater<std::uint32_t>());
+	}
+
+	const std::vector<T>& GetData() const { return data; }
+	std::uint32_t GetCount() const { return (std::uint32_t)data.size(); }
+
+private:
+	std::unordered_map<std::uint64_t, std::uint32_t> slots;
+	std::vector<std::uint64_t> keys;  // 0 for a free slot
+	std::vector<std::uint32_t> frames;
+	std::vector<T> data;
+	std::vector<std::uint32_t> freeSlots;
+	std::vector<std::uint32_t> dirtySlots;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Uniform spatial hash clustering of particle lights, kept free of game types so it can be tested and benchmarked outside the game.
+// A cluster is anything with id, color, radius, position and count members, where color and position support += and /=.
+namespace ParticleLightClustering
+{
+	// 21 bits per axis covers +-1048576 cells, far beyond any worldspace at the minimum cell size
+	inline std::uint64_t GetCellKey(float a_x, float a_y, float a_z, float a_cellSize)
+	{
+		auto x = (std::int64_t)std::floor(a_x / a_cellSize) & 0x1FFFFF;
+		auto y = (std::int64_t)std::floor(a_y / a_cellSize) & 0x1FFFFF;
+		auto z = (std::int64_t)std::floor(a_z / a_cellSize) & 0x1FFFFF;
+		return ((std::uint64_t)x << 42) | ((std::uint64_t)y << 21) | (std::uint64_t)z;
+	}
+
+	// Adds a_particle to the cluster with the same id, or starts a new one. Sums only, Finalize turns them into averages.
+	template <class Clusters, class CellMap, class Cluster>
+	void Accumulate(Clusters& a_clusters, CellMap& a_idToCluster, const Cluster& a_particle)
+	{
+		auto [it, inserted] = a_idToCluster.try_emplace(a_particle.id, (std::uint32_t)a_clusters.size());
+		if (inserted) {
+			a_clusters.push_back(a_particle);
+			return;
+		}
+		auto& cluster = a_clusters[it->second];
+		cluster.color += a_particle.color;
+		cluster.radius += a_particle.radius;
+		cluster.position += a_particle.position;
+		cluster.count += a_particle.count;
+	}
+
+	// Sorting by id keeps the light order stable between frames, whatever order the particles and systems came in
+	template <class Clusters>
+	void Finalize(Clusters& a_clusters)
+	{
+		std::sort(a_clusters.begin(), a_clusters.end(), [](const auto& a, const auto& b) {
+			return a.id < b.id;
+		});
+
+		for (auto& cluster : a_clusters) {
+			cluster.radius /= (float)cluster.count;
+			cluster.position /= (float)cluster.count;
+		}
+	}
+}
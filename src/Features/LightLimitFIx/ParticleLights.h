@@ -32,8 +32,15 @@ public:
 		RE::NiColor color;
 	};
 
-	std::unordered_map<std::string, Config> particleLightConfigs;
-	std::unordered_map<std::string, GradientConfig> particleLightGradientConfigs;
+	// Transparent so texture names built in the frame arena can be looked up without a std::string copy
+	struct StringHash
+	{
+		using is_transparent = void;
+		size_t operator()(std::string_view a_string) const { return std::hash<std::string_view>{}(a_string); }
+	};
+
+	std::unordered_map<std::string, Config, StringHash, std::equal_to<>> particleLightConfigs;
+	std::unordered_map<std::string, GradientConfig, StringHash, std::equal_to<>> particleLightGradientConfigs;
 
 	void GetConfigs();
 };
\ No newline at end of file
@@ -1,17 +1,9 @@
 #include "LightLimitFix.h"
 
-#include <PerlinNoise.hpp>
-
+#include "JobSystem.h"
 #include "State.h"
 #include "Util.h"
 
-static constexpr uint CLUSTER_SIZE_X = 16;
-static constexpr uint CLUSTER_SIZE_Y = 16;
-static constexpr uint CLUSTER_SIZE_Z = 16;
-constexpr uint CLUSTER_MAX_LIGHTS = 128;
-
-constexpr std::uint32_t CLUSTER_COUNT = CLUSTER_SIZE_X * CLUSTER_SIZE_Y * CLUSTER_SIZE_Z;
-
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
 	LightLimitFix::Settings,
 	EnableContactShadows,
@@ -22,7 +14,12 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
 	ParticleLightsBrightness,
 	ParticleLightsSaturation,
 	EnableParticleLightsOptimization,
-	ParticleLightsOptimisationClusterRadius)
+	ParticleLightsOptimisationClusterRadius,
+	EnableLightBudget,
+	LightBudget,
+	ClusterSizeX,
+	ClusterSizeY,
+	ClusterSizeZ)
 
 void LightLimitFix::DrawSettings()
 {
@@ -66,7 +63,7 @@ void LightLimitFix::DrawSettings()
 		if (ImGui::IsItemHovered()) {
 			ImGui::BeginTooltip();
 			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
-			ImGui::Text("Radius to use for clustering lights.");
+			ImGui::Text("Size of the world-space grid cells used for clustering lights.");
 			ImGui::PopTextWrapPos();
 			ImGui::EndTooltip();
 		}
@@ -97,6 +94,54 @@ void LightLimitFix::DrawSettings()
 		ImGui::TreePop();
 	}
 
+	if (ImGui::TreeNodeEx("Light Budget", ImGuiTreeNodeFlags_DefaultOpen)) {
+		ImGui::Checkbox("Enable Light Budget", &settings.EnableLightBudget);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Limits the number of clustered lights, keeping the most important ones. Lights are ranked by their brightness and size on screen.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+		ImGui::SliderInt("Maximum Lights", (int*)&settings.LightBudget, 64, 4096);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Number of lights kept by the light budget. Lights over the budget are faded out.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::SliderInt("Cluster Grid X", (int*)&settings.ClusterSizeX, 4, 64);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Number of screen tiles across the width that lights are sorted into. More tiles give tighter light lists, but culling cost and the memory of the cluster and light list buffers grow with the total cluster count. The clusters are rebuilt when this changes.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+		ImGui::SliderInt("Cluster Grid Y", (int*)&settings.ClusterSizeY, 4, 64);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Number of screen tiles down the height that lights are sorted into. More tiles give tighter light lists, but culling cost and the memory of the cluster and light list buffers grow with the total cluster count. The clusters are rebuilt when this changes.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+		ImGui::SliderInt("Cluster Grid Z", (int*)&settings.ClusterSizeZ, 4, 64);
+		if (ImGui::IsItemHovered()) {
+			ImGui::BeginTooltip();
+			ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+			ImGui::Text("Number of depth slices lights are sorted into. More slices give tighter light lists, but culling cost and the memory of the cluster and light list buffers grow with the total cluster count. The clusters are rebuilt when this changes.");
+			ImGui::PopTextWrapPos();
+			ImGui::EndTooltip();
+		}
+
+		ImGui::Spacing();
+		ImGui::Spacing();
+		ImGui::TreePop();
+	}
+
 	if (ImGui::TreeNodeEx("Shadows", ImGuiTreeNodeFlags_DefaultOpen)) {
 		ImGui::Checkbox("Enable Contact Shadows", &settings.EnableContactShadows);
 		if (ImGui::IsItemHovered()) {
@@ -152,12 +197,55 @@ void LightLimitFix::DrawSettings()
 
 	if (ImGui::TreeNodeEx("Statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
 		ImGui::Text(std::format("Clustered Light Count : {}", lightCount).c_str());
-		ImGui::Text(std::format("Particle Lights Detection Count : {}", particleLightsDetectionHits).c_str());
+		ImGui::Text(std::format("Light Budget : {} candidates, {} kept, {} fading", lightBudgetCandidateCount, lightCount, lightBudgetFadingCount).c_str());
+		ImGui::Text(std::format("Cluster Light List : {} used, {} capacity", lightListTotal, lightListCapacity).c_str());
+		ImGui::Text(std::format("Light Slots : {} used, {} uploaded", lightSlots.GetCount(), uploadedLightCount).c_str());
+		if (lights)
+			ImGui::Text(std::format("Light Buffers : {} capacity, {} buffer allocations, {} view allocations", lights->Capacity(), lights->resourceAllocations + lightWorldBuffer->resourceAllocations, lights->viewAllocations + lightWorldBuffer->viewAllocations).c_str());
+		ImGui::Text(std::format("Strict Light Data : {} maps for {} draws ({} saved)", strictLightDataMapsLastFrame, strictLightDataDrawsLastFrame, strictLightDataDrawsLastFrame - strictLightDataMapsLastFrame).c_str());
+		ImGui::Text(std::format("Particle Lights Detection Count : {}", particleLightsDetectionHits.load()).c_str());
+
+		auto hitRate = [](std::uint64_t a_hits, std::uint64_t a_misses) {
+			return a_hits + a_misses ? 100.0 * (double)a_hits / (double)(a_hits + a_misses) : 0.0;
+		};
+		ImGui::Text(std::format("Particle Material Cache : {} entries, {:.1f}% hit rate", particleMaterialCache.size(), hitRate(particleMaterialCacheHits, particleMaterialCacheMisses)).c_str());
+		ImGui::Text(std::format("Vertex Color Cache : {} entries, {:.1f}% hit rate", vertexColorCache.size(), hitRate(vertexColorCacheHits, vertexColorCacheMisses)).c_str());
+		ImGui::Text(std::format("Flicker Noise Cache : {} entries, {:.1f}% hit rate", flickerNoiseCache.size(), hitRate(flickerNoiseCacheHits, flickerNoiseCacheMisses)).c_str());
 
 		ImGui::TreePop();
 	}
 }
 
+std::vector<SIE::ComputeShaderDesc> LightLimitFix::GetComputeShaderDescs()
+{
+	return {
+		{ L"Data\\Shaders\\LightLimitFix\\ClusterBuildingCS.hlsl" },
+		{ L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl" },
+		{ L"Data\\Shaders\\LightLimitFix\\ClusterPrefixSumCS.hlsl" },
+		{ L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl", { { "CLUSTER_FILL", "" } } },
+		{ L"Data\\Shaders\\LightLimitFix\\LightTransformCS.hlsl" },
+	};
+}
+
+void LightLimitFix::CreateComputeShaders()
+{
+	clusterBuildingCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterBuildingCS.hlsl", {}, "cs_5_0");
+	clusterCountCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl", {}, "cs_5_0");
+	clusterPrefixSumCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterPrefixSumCS.hlsl", {}, "cs_5_0");
+	clusterFillCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl", { { "CLUSTER_FILL", "" } }, "cs_5_0");
+	lightTransformCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\LightTransformCS.hlsl", {}, "cs_5_0");
+}
+
+// The cluster shaders are used every frame rather than created on first use, so they are rebuilt right away
+void LightLimitFix::ClearShaderCache()
+{
+	for (auto shader : { clusterBuildingCS, clusterCountCS, clusterPrefixSumCS, clusterFillCS, lightTransformCS }) {
+		if (shader)
+			shader->Release();
+	}
+	CreateComputeShaders();
+}
+
 void LightLimitFix::SetupResources()
 {
 	{
@@ -179,27 +267,39 @@ void LightLimitFix::SetupResources()
 	}
 
 	{
+		auto device = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().forwarder;
+
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options{};
+		if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+			strictLightDataNoOverwrite = options.MapNoOverwriteOnDynamicBufferSRV;
+		logger::info("[LLF] Strict light data ring buffer {}", strictLightDataNoOverwrite ? "enabled" : "not supported, using a single slot");
+
+		uint ringSize = strictLightDataNoOverwrite ? StrictLightDataRingSize : 1;
+
 		D3D11_BUFFER_DESC sbDesc{};
 		sbDesc.Usage = D3D11_USAGE_DYNAMIC;
 		sbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 		sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 		sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
 		sbDesc.StructureByteStride = sizeof(StrictLightData);
-		sbDesc.ByteWidth = sizeof(StrictLightData);
-		strictLightData = std::make_unique<Buffer>(sbDesc);
+		sbDesc.ByteWidth = sizeof(StrictLightData) * ringSize;
+
+		std::vector<StrictLightData> initialData(ringSize);
+		D3D11_SUBRESOURCE_DATA subresourceData{ initialData.data(), 0, 0 };
+		strictLightData = std::make_unique<Buffer>(sbDesc, &subresourceData);
 
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
 		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
 		srvDesc.Buffer.FirstElement = 0;
-		srvDesc.Buffer.NumElements = 1;
+		srvDesc.Buffer.NumElements = ringSize;
 		strictLightData->CreateSRV(srvDesc);
 	}
 	{
-		clusterBuildingCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterBuildingCS.hlsl", {}, "cs_5_0");
-		clusterCullingCS = (ID3D11ComputeShader*)Util::CompileShader(L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl", {}, "cs_5_0");
+		CreateComputeShaders();
 
 		perFrameLightCulling = new ConstantBuffer(ConstantBufferDesc<PerFrameLightCulling>());
+		perFrameLightTransform = new ConstantBuffer(ConstantBufferDesc<PerFrameLightTransform>(true));
 	}
 
 	{
@@ -208,60 +308,145 @@ void LightLimitFix::SetupResources()
 		sbDesc.CPUAccessFlags = 0;
 		sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
 		sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		sbDesc.StructureByteStride = sizeof(uint32_t);
+		sbDesc.ByteWidth = sizeof(uint32_t);
+		lightCounter = eastl::make_unique<Buffer>(sbDesc);
 
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
 		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
 		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = 1;
+		lightCounter->CreateSRV(srvDesc);
 
 		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
 		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
 		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
 		uavDesc.Buffer.FirstElement = 0;
 		uavDesc.Buffer.Flags = 0;
+		uavDesc.Buffer.NumElements = 1;
+		lightCounter->CreateUAV(uavDesc);
 
-		std::uint32_t numElements = CLUSTER_COUNT;
+		D3D11_BUFFER_DESC readbackDesc{};
+		readbackDesc.Usage = D3D11_USAGE_STAGING;
+		readbackDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		readbackDesc.ByteWidth = sizeof(uint32_t);
+		auto device = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().forwarder;
+		for (auto& readback : lightCounterReadback)
+			DX::ThrowIfFailed(device->CreateBuffer(&readbackDesc, nullptr, readback.put()));
+	}
 
-		sbDesc.StructureByteStride = sizeof(ClusterAABB);
-		sbDesc.ByteWidth = sizeof(ClusterAABB) * numElements;
-		clusters = eastl::make_unique<Buffer>(sbDesc);
-		srvDesc.Buffer.NumElements = numElements;
-		clusters->CreateSRV(srvDesc);
-		uavDesc.Buffer.NumElements = numElements;
-		clusters->CreateUAV(uavDesc);
+	CreateClusterResources();
+}
 
-		numElements = 1;
-		sbDesc.StructureByteStride = sizeof(uint32_t);
-		sbDesc.ByteWidth = sizeof(uint32_t) * numElements;
-		lightCounter = eastl::make_unique<Buffer>(sbDesc);
-		srvDesc.Buffer.NumElements = numElements;
-		lightCounter->CreateSRV(srvDesc);
-		uavDesc.Buffer.NumElements = numElements;
-		lightCounter->CreateUAV(uavDesc);
+void LightLimitFix::CreateClusterResources()
+{
+	clusterSize[0] = ClusterLightCulling::ClampClusterSize(settings.ClusterSizeX);
+	clusterSize[1] = ClusterLightCulling::ClampClusterSize(settings.ClusterSizeY);
+	clusterSize[2] = ClusterLightCulling::ClampClusterSize(settings.ClusterSizeZ);
+	clusterCount = clusterSize[0] * clusterSize[1] * clusterSize[2];
+	clustersDirty = true;
+
+	D3D11_BUFFER_DESC sbDesc{};
+	sbDesc.Usage = D3D11_USAGE_DEFAULT;
+	sbDesc.CPUAccessFlags = 0;
+	sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.Flags = 0;
+
+	std::uint32_t numElements = clusterCount;
+
+	sbDesc.StructureByteStride = sizeof(ClusterAABB);
+	sbDesc.ByteWidth = sizeof(ClusterAABB) * numElements;
+	clusters = eastl::make_unique<Buffer>(sbDesc);
+	srvDesc.Buffer.NumElements = numElements;
+	clusters->CreateSRV(srvDesc);
+	uavDesc.Buffer.NumElements = numElements;
+	clusters->CreateUAV(uavDesc);
+
+	sbDesc.StructureByteStride = sizeof(LightGrid);
+	sbDesc.ByteWidth = sizeof(LightGrid) * numElements;
+	lightGrid = eastl::make_unique<Buffer>(sbDesc);
+	srvDesc.Buffer.NumElements = numElements;
+	lightGrid->CreateSRV(srvDesc);
+	uavDesc.Buffer.NumElements = numElements;
+	lightGrid->CreateUAV(uavDesc);
+
+	// Start with room for a few lights per cluster, the list grows to the real total
+	ResizeLightList(clusterCount * 8);
+}
 
-		numElements = CLUSTER_COUNT * CLUSTER_MAX_LIGHTS;
-		sbDesc.StructureByteStride = sizeof(uint32_t);
-		sbDesc.ByteWidth = sizeof(uint32_t) * numElements;
-		lightList = eastl::make_unique<Buffer>(sbDesc);
-		srvDesc.Buffer.NumElements = numElements;
-		lightList->CreateSRV(srvDesc);
-		uavDesc.Buffer.NumElements = numElements;
-		lightList->CreateUAV(uavDesc);
-
-		numElements = CLUSTER_COUNT;
-		sbDesc.StructureByteStride = sizeof(LightGrid);
-		sbDesc.ByteWidth = sizeof(LightGrid) * numElements;
-		lightGrid = eastl::make_unique<Buffer>(sbDesc);
-		srvDesc.Buffer.NumElements = numElements;
-		lightGrid->CreateSRV(srvDesc);
-		uavDesc.Buffer.NumElements = numElements;
-		lightGrid->CreateUAV(uavDesc);
+void LightLimitFix::ResizeLightList(uint a_capacity)
+{
+	lightListCapacity = std::max(a_capacity, 1u);
+	lightListShrinkCounter = 0;
+
+	D3D11_BUFFER_DESC sbDesc{};
+	sbDesc.Usage = D3D11_USAGE_DEFAULT;
+	sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	sbDesc.StructureByteStride = sizeof(uint32_t);
+	sbDesc.ByteWidth = sizeof(uint32_t) * lightListCapacity;
+	lightList = eastl::make_unique<Buffer>(sbDesc);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = lightListCapacity;
+	lightList->CreateSRV(srvDesc);
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.Flags = 0;
+	uavDesc.Buffer.NumElements = lightListCapacity;
+	lightList->CreateUAV(uavDesc);
+}
+
+void LightLimitFix::UpdateLightListCapacity()
+{
+	auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
+
+	// Copy this frame's total, then read the oldest copy which the GPU should have finished by now
+	uint frame = lightCounterReadbackFrame++;
+	context->CopyResource(lightCounterReadback[frame % LightListReadbackLatency].get(), lightCounter->resource.get());
+	if (frame + 1 < LightListReadbackLatency)
+		return;
+
+	auto& readback = lightCounterReadback[(frame + 1) % LightListReadbackLatency];
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(readback.get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped)))
+		return;
+	lightListTotal = *reinterpret_cast<uint*>(mapped.pData);
+	context->Unmap(readback.get(), 0);
+
+	if (lightListTotal > lightListCapacity) {
+		ResizeLightList(lightListTotal + lightListTotal / 2);
+	} else if (lightListTotal < lightListCapacity / 4 && lightListCapacity > clusterCount) {
+		if (++lightListShrinkCounter >= LightListShrinkDelay)
+			ResizeLightList(std::max(lightListTotal * 2, clusterCount));
+	} else {
+		lightListShrinkCounter = 0;
 	}
 }
 
 void LightLimitFix::Reset()
 {
 	rendered = false;
+	strictLightDataDrawsLastFrame = std::exchange(strictLightDataDraws, 0);
+	strictLightDataMapsLastFrame = std::exchange(strictLightDataMaps, 0);
 	for (auto& particleLight : particleLights) {
 		if (const auto particleSystem = netimmerse_cast<RE::NiParticleSystem*>(particleLight.first)) {
 			if (auto particleData = particleSystem->GetParticleRuntimeData().particleData.get()) {
@@ -278,6 +463,9 @@ void LightLimitFix::Load(json& o_json)
 {
 	if (o_json[GetName()].is_object())
 		settings = o_json[GetName()];
+	settings.ClusterSizeX = ClusterLightCulling::ClampClusterSize(settings.ClusterSizeX);
+	settings.ClusterSizeY = ClusterLightCulling::ClampClusterSize(settings.ClusterSizeY);
+	settings.ClusterSizeZ = ClusterLightCulling::ClampClusterSize(settings.ClusterSizeZ);
 	Feature::Load(o_json);
 }
 
@@ -317,35 +505,65 @@ void LightLimitFix::BSLightingShader_SetupGeometry_GeometrySetupConstantPointLig
 	}
 }
 
-void LightLimitFix::BSLightingShader_SetupGeometry_After(RE::BSRenderPass*)
+bool LightLimitFix::IsStrictLightDataEqual(const StrictLightData& a_lhs, const StrictLightData& a_rhs)
 {
-	auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
-	D3D11_MAPPED_SUBRESOURCE mapped;
-	DX::ThrowIfFailed(context->Map(strictLightData->resource.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
-	size_t bytes = sizeof(StrictLightData);
-	memcpy_s(mapped.pData, bytes, &strictLightDataTemp, bytes);
-	context->Unmap(strictLightData->resource.get(), 0);
+	if (a_lhs.NumLights != a_rhs.NumLights)
+		return false;
+	// Only the active lights are read by the shader
+	for (uint i = 0; i < a_lhs.NumLights; i++) {
+		if (a_lhs.PointLightPosition[i] != a_rhs.PointLightPosition[i] || a_lhs.PointLightRadius[i] != a_rhs.PointLightRadius[i] || a_lhs.PointLightColor[i] != a_rhs.PointLightColor[i])
+			return false;
+	}
+	return true;
 }
 
-void LightLimitFix::SetLightPosition(LightLimitFix::LightData& a_light, RE::NiPoint3& a_initialPosition)
+void LightLimitFix::BSLightingShader_SetupGeometry_SetStrictLightDataSlot(const REX::PixelShaderConstantGroup& a_pixelCG)
 {
-	auto state = RE::BSGraphics::RendererShadowState::GetSingleton();
-	for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
-		auto eyePosition = eyeCount == 1 ?
-		                       state->GetRuntimeData().posAdjust.getEye(eyeIndex) :
-		                       state->GetVRRuntimeData().posAdjust.getEye(eyeIndex);
-		auto viewMatrix = eyeCount == 1 ?
-		                      state->GetRuntimeData().cameraData.getEye(eyeIndex).viewMat :
-		                      state->GetVRRuntimeData().cameraData.getEye(eyeIndex).viewMat;
-		auto worldPos = a_initialPosition - eyePosition;
-		a_light.positionWS[eyeIndex].x = worldPos.x;
-		a_light.positionWS[eyeIndex].y = worldPos.y;
-		a_light.positionWS[eyeIndex].z = worldPos.z;
-		a_light.positionVS[eyeIndex] = DirectX::SimpleMath::Vector3::Transform(a_light.positionWS[eyeIndex], viewMatrix);
+	auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
+	strictLightDataDraws++;
+
+	uint slot;
+	if (strictLightDataNoOverwrite && !strictLightDataTemp.NumLights) {
+		slot = 0;
+	} else if (strictLightDataUploaded && IsStrictLightDataEqual(strictLightDataTemp, strictLightDataLast)) {
+		slot = strictLightDataSlot;
+	} else {
+		D3D11_MAP mapType = D3D11_MAP_WRITE_DISCARD;
+		slot = 0;
+		if (strictLightDataNoOverwrite) {
+			if (strictLightDataRingOffset >= StrictLightDataRingSize)
+				strictLightDataRingOffset = 1;
+			else
+				mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+			slot = strictLightDataRingOffset++;
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		DX::ThrowIfFailed(context->Map(strictLightData->resource.get(), 0, mapType, 0, &mapped));
+		auto ring = reinterpret_cast<StrictLightData*>(mapped.pData);
+		if (mapType == D3D11_MAP_WRITE_DISCARD && strictLightDataNoOverwrite)
+			ring[0] = {};
+		ring[slot] = strictLightDataTemp;
+		context->Unmap(strictLightData->resource.get(), 0);
+
+		strictLightDataMaps++;
+		strictLightDataLast = strictLightDataTemp;
+		strictLightDataSlot = slot;
+		strictLightDataUploaded = true;
 	}
+
+	// z and w of NumLightNumShadowLight are padding the game never reads, written after it has set x and y
+	a_pixelCG.Param<uint>(NumLightNumShadowLightConstant)[2] = slot;
 }
 
-float LightLimitFix::CalculateLuminance(CachedParticleLight& light, RE::NiPoint3& point)
+void LightLimitFix::BSLightingShader_SetupGeometry_After(RE::BSRenderPass*)
+{
+	auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
+	ID3D11ShaderResourceView* views[1]{ strictLightData->srv.get() };
+	context->PSSetShaderResources(37, ARRAYSIZE(views), views);
+}
+
+float LightLimitFix::CalculateLuminance(const CachedParticleLight& light, RE::NiPoint3& point)
 {
 	// See BSLight::CalculateLuminance_14131D3D0
 	// Performs lighting on the CPU which is identical to GPU code
@@ -358,19 +576,68 @@ float LightLimitFix::CalculateLuminance(CachedParticleLight& light, RE::NiPoint3
 	return light.grey * intensityMultiplier;
 }
 
+void LightLimitFix::PublishParticleLightGrid()
+{
+	// Reuse the back grid unless a detection query still holds it
+	if (!backParticleLightGrid || backParticleLightGrid.use_count() > 1)
+		backParticleLightGrid = std::make_shared<ParticleLightGrid>();
+
+	auto& grid = *backParticleLightGrid;
+	grid.lights.clear();
+	grid.cells.clear();
+
+	grid.maxRadius = 0.0f;
+	for (auto& light : cachedParticleLights)
+		grid.maxRadius = std::max(grid.maxRadius, light.radius);
+	grid.cellSize = std::max(grid.maxRadius, 64.0f);
+
+	FrameEastlVector<std::pair<std::uint64_t, std::uint32_t>> keys;
+	keys.reserve(cachedParticleLights.size());
+	for (std::uint32_t i = 0; i < (std::uint32_t)cachedParticleLights.size(); i++)
+		keys.push_back({ GetClusterCellKey(cachedParticleLights[i].position, grid.cellSize), i });
+	std::sort(keys.begin(), keys.end());
+
+	grid.lights.reserve(keys.size());
+	for (auto& [key, index] : keys) {
+		auto [it, inserted] = grid.cells.insert({ key, { (std::uint32_t)grid.lights.size(), 0 } });
+		it->second.second++;
+		grid.lights.push_back(cachedParticleLights[index]);
+	}
+
+	particleLightGrid.store(backParticleLightGrid);
+	std::swap(backParticleLightGrid, frontParticleLightGrid);
+}
+
 void LightLimitFix::AddParticleLightLuminance(RE::NiPoint3& targetPosition, int& numHits, float& lightLevel)
 {
-	std::lock_guard<std::shared_mutex> lk{ cachedParticleLightsMutex };
-	particleLightsDetectionHits = 0;
+	uint32_t hits = 0;
 	if (settings.EnableParticleLightsDetection) {
-		for (auto& light : cachedParticleLights) {
-			auto luminance = CalculateLuminance(light, targetPosition);
-			lightLevel += luminance;
-			if (luminance > 0.0)
-				particleLightsDetectionHits++;
+		if (auto grid = particleLightGrid.load(); grid && !grid->lights.empty()) {
+			auto cellSize = grid->cellSize;
+			auto minCell = RE::NiPoint3{ std::floor((targetPosition.x - grid->maxRadius) / cellSize), std::floor((targetPosition.y - grid->maxRadius) / cellSize), std::floor((targetPosition.z - grid->maxRadius) / cellSize) };
+			auto maxCell = RE::NiPoint3{ std::floor((targetPosition.x + grid->maxRadius) / cellSize), std::floor((targetPosition.y + grid->maxRadius) / cellSize), std::floor((targetPosition.z + grid->maxRadius) / cellSize) };
+
+			for (float x = minCell.x; x <= maxCell.x; x++) {
+				for (float y = minCell.y; y <= maxCell.y; y++) {
+					for (float z = minCell.z; z <= maxCell.z; z++) {
+						// Sample the centre of the cell so the key matches the one used when building
+						auto key = GetClusterCellKey({ (x + 0.5f) * cellSize, (y + 0.5f) * cellSize, (z + 0.5f) * cellSize }, cellSize);
+						auto it = grid->cells.find(key);
+						if (it == grid->cells.end())
+							continue;
+						for (uint32_t i = it->second.first; i < it->second.first + it->second.second; i++) {
+							auto luminance = CalculateLuminance(grid->lights[i], targetPosition);
+							lightLevel += luminance;
+							if (luminance > 0.0)
+								hits++;
+						}
+					}
+				}
+			}
 		}
 	}
-	numHits += particleLightsDetectionHits;
+	particleLightsDetectionHits = hits;
+	numHits += hits;
 }
 
 void LightLimitFix::Bind()
@@ -399,7 +666,7 @@ void LightLimitFix::Bind()
 
 		{
 			ID3D11ShaderResourceView* views[4]{};
-			views[0] = lights->srv.get();
+			views[0] = lights->SRV();
 			views[1] = lightList->srv.get();
 			views[2] = lightGrid->srv.get();
 			views[3] = RE::BSGraphics::Renderer::GetSingleton()->GetDepthStencilData().depthStencils[RE::RENDER_TARGETS_DEPTHSTENCIL::kPOST_ZPREPASS_COPY].depthSRV;
@@ -436,6 +703,9 @@ void LightLimitFix::Bind()
 			perPassData.EnableContactShadows = settings.EnableContactShadows;
 			perPassData.EnableLightsVisualisation = settings.EnableLightsVisualisation;
 			perPassData.LightsVisualisationMode = settings.LightsVisualisationMode;
+			perPassData.ClusterSizeX = clusterSize[0];
+			perPassData.ClusterSizeY = clusterSize[1];
+			perPassData.ClusterSizeZ = clusterSize[2];
 
 			D3D11_MAPPED_SUBRESOURCE mapped;
 			DX::ThrowIfFailed(context->Map(perPass->resource.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
@@ -473,69 +743,113 @@ struct VertexColor
 	std::uint8_t data[4];
 };
 
-bool LightLimitFix::CheckParticleLights(RE::BSRenderPass* a_pass, uint32_t)
+static bool GetParticleTextureName(const RE::BSFixedString& a_path, FrameString& a_textureName)
 {
-	// See https://www.nexusmods.com/skyrimspecialedition/articles/1391
-	if (settings.EnableParticleLights) {
-		if (auto shaderProperty = netimmerse_cast<RE::BSEffectShaderProperty*>(a_pass->shaderProperty)) {
-			if (!shaderProperty->lightData) {
-				if (auto material = shaderProperty->material) {
-					if (!material->sourceTexturePath.empty()) {
-						std::string textureName = material->sourceTexturePath.c_str();
+	std::string_view path = a_path.c_str();
 
-						{
-							if (textureName.size() < 1)
-								return false;
+	if (path.size() < 1)
+		return false;
 
-							auto lastSeparatorPos = textureName.find_last_of("\\/");
-							if (lastSeparatorPos == std::string::npos)
-								return false;
+	auto lastSeparatorPos = path.find_last_of("\\/");
+	if (lastSeparatorPos == std::string_view::npos)
+		return false;
 
-							textureName = textureName.substr(lastSeparatorPos + 1);
-							if (textureName.size() < 4)
-								return false;
+	a_textureName = path.substr(lastSeparatorPos + 1);
+	if (a_textureName.size() < 4)
+		return false;
 
-							textureName.erase(textureName.length() - 4);  // Remove ".dds"
+	a_textureName.erase(a_textureName.length() - 4);  // Remove ".dds"
 #pragma warning(push)
 #pragma warning(disable: 4244)
-							std::transform(textureName.begin(), textureName.end(), textureName.begin(), ::tolower);
+	std::transform(a_textureName.begin(), a_textureName.end(), a_textureName.begin(), ::tolower);
 #pragma warning(pop)
-						}
+	return true;
+}
 
-						auto& configs = ParticleLights::GetSingleton()->particleLightConfigs;
-						auto it = configs.find(textureName);
-						if (it == configs.end())
-							return false;
+const LightLimitFix::ParticleMaterialCacheEntry& LightLimitFix::GetParticleMaterialConfig(RE::BSEffectShaderMaterial* a_material)
+{
+	const char* sourceTexturePath = a_material->sourceTexturePath.c_str();
+	const char* greyscaleTexturePath = a_material->greyscaleTexturePath.c_str();
 
-						ParticleLights::Config* config = &it->second;
-						ParticleLights::GradientConfig* gradientConfig = nullptr;
-						if (!material->greyscaleTexturePath.empty()) {
-							textureName = material->greyscaleTexturePath.c_str();
-							{
-								if (textureName.size() < 1)
-									return false;
+	auto it = particleMaterialCache.find(a_material);
+	if (it != particleMaterialCache.end() && it->second.sourceTexturePath == sourceTexturePath && it->second.greyscaleTexturePath == greyscaleTexturePath) {
+		particleMaterialCacheHits++;
+		return it->second;
+	}
+	particleMaterialCacheMisses++;
 
-								auto lastSeparatorPos = textureName.find_last_of("\\/");
-								if (lastSeparatorPos == std::string::npos)
-									return false;
+	// Materials are never removed individually, drop everything if the cache gets large
+	if (it == particleMaterialCache.end() && particleMaterialCache.size() >= 4096) {
+		particleMaterialCache.clear();
+	}
 
-								textureName = textureName.substr(lastSeparatorPos + 1);
-								if (textureName.size() < 4)
-									return false;
+	ParticleMaterialCacheEntry entry{ sourceTexturePath, greyscaleTexturePath, nullptr, nullptr };
+
+	FrameString textureName;
+	if (!a_material->sourceTexturePath.empty() && GetParticleTextureName(a_material->sourceTexturePath, textureName)) {
+		auto& configs = ParticleLights::GetSingleton()->particleLightConfigs;
+		auto itConfig = configs.find(std::string_view(textureName));
+		if (itConfig != configs.end()) {
+			entry.config = &itConfig->second;
+			if (!a_material->greyscaleTexturePath.empty()) {
+				auto& gradientConfigs = ParticleLights::GetSingleton()->particleLightGradientConfigs;
+				auto itGradient = GetParticleTextureName(a_material->greyscaleTexturePath, textureName) ? gradientConfigs.find(std::string_view(textureName)) : gradientConfigs.end();
+				if (itGradient != gradientConfigs.end())
+					entry.gradientConfig = &itGradient->second;
+				else
+					entry.config = nullptr;
+			}
+		}
+	}
 
-								textureName.erase(textureName.length() - 4);  // Remove ".dds"
-#pragma warning(push)
-#pragma warning(disable: 4244)
-								std::transform(textureName.begin(), textureName.end(), textureName.begin(), ::tolower);
-#pragma warning(pop)
-							}
+	return particleMaterialCache.insert_or_assign(a_material, entry).first->second;
+}
 
-							auto& gradientConfigs = ParticleLights::GetSingleton()->particleLightGradientConfigs;
-							auto itGradient = gradientConfigs.find(textureName);
-							if (itGradient == gradientConfigs.end())
-								return false;
-							gradientConfig = &itGradient->second;
-						}
+const RE::NiColorA& LightLimitFix::GetMaxVertexColor(RE::BSGeometry* a_geometry)
+{
+	auto rendererData = a_geometry->GetGeometryRuntimeData().rendererData;
+	auto triShape = a_geometry->AsTriShape();
+	std::uint32_t vertexCount = triShape->GetTrishapeRuntimeData().vertexCount;
+
+	auto it = vertexColorCache.find(rendererData);
+	if (it != vertexColorCache.end() && it->second.rawVertexData == rendererData->rawVertexData && it->second.vertexCount == vertexCount) {
+		vertexColorCacheHits++;
+		return it->second.color;
+	}
+	vertexColorCacheMisses++;
+
+	if (it == vertexColorCache.end() && vertexColorCache.size() >= 4096) {
+		vertexColorCache.clear();
+	}
+
+	uint32_t vertexSize = rendererData->vertexDesc.GetSize();
+	uint32_t offset = rendererData->vertexDesc.GetAttributeOffset(RE::BSGraphics::Vertex::Attribute::VA_COLOR);
+	RE::NiColorA vertexColor{};
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		if (VertexColor* vertex = reinterpret_cast<VertexColor*>(&rendererData->rawVertexData[vertexSize * v + offset])) {
+			RE::NiColorA niColor{ (float)vertex->data[0] / 255.0f, (float)vertex->data[1] / 255.0f, (float)vertex->data[2] / 255.0f, (float)vertex->data[3] / 255.0f };
+			if (niColor.alpha > vertexColor.alpha)
+				vertexColor = niColor;
+		}
+	}
+
+	return vertexColorCache.insert_or_assign(rendererData, VertexColorCacheEntry{ rendererData->rawVertexData, vertexCount, vertexColor }).first->second.color;
+}
+
+bool LightLimitFix::CheckParticleLights(RE::BSRenderPass* a_pass, uint32_t)
+{
+	// See https://www.nexusmods.com/skyrimspecialedition/articles/1391
+	if (settings.EnableParticleLights) {
+		if (auto shaderProperty = netimmerse_cast<RE::BSEffectShaderProperty*>(a_pass->shaderProperty)) {
+			if (!shaderProperty->lightData) {
+				if (auto material = static_cast<RE::BSEffectShaderMaterial*>(shaderProperty->material)) {
+					if (!material->sourceTexturePath.empty()) {
+						auto& materialConfig = GetParticleMaterialConfig(material);
+						if (!materialConfig.config)
+							return false;
+
+						ParticleLights::Config* config = materialConfig.config;
+						ParticleLights::GradientConfig* gradientConfig = materialConfig.gradientConfig;
 
 						a_pass->geometry->IncRefCount();
 						if (const auto particleSystem = netimmerse_cast<RE::NiParticleSystem*>(a_pass->geometry)) {
@@ -558,17 +872,8 @@ bool LightLimitFix::CheckParticleLights(RE::BSRenderPass* a_pass, uint32_t)
 
 						if (auto rendererData = a_pass->geometry->GetGeometryRuntimeData().rendererData) {
 							if (rendererData->vertexDesc.HasFlag(RE::BSGraphics::Vertex::Flags::VF_COLORS)) {
-								if (auto triShape = a_pass->geometry->AsTriShape()) {
-									uint32_t vertexSize = rendererData->vertexDesc.GetSize();
-									uint32_t offset = rendererData->vertexDesc.GetAttributeOffset(RE::BSGraphics::Vertex::Attribute::VA_COLOR);
-									RE::NiColorA vertexColor{};
-									for (int v = 0; v < triShape->GetTrishapeRuntimeData().vertexCount; v++) {
-										if (VertexColor* vertex = reinterpret_cast<VertexColor*>(&rendererData->rawVertexData[vertexSize * v + offset])) {
-											RE::NiColorA niColor{ (float)vertex->data[0] / 255.0f, (float)vertex->data[1] / 255.0f, (float)vertex->data[2] / 255.0f, (float)vertex->data[3] / 255.0f };
-											if (niColor.alpha > vertexColor.alpha)
-												vertexColor = niColor;
-										}
-									}
+								if (a_pass->geometry->AsTriShape()) {
+									auto& vertexColor = GetMaxVertexColor(a_pass->geometry);
 									color.red *= vertexColor.red;
 									color.green *= vertexColor.green;
 									color.blue *= vertexColor.blue;
@@ -643,12 +948,17 @@ float LightLimitFix::CalculateLightDistance(float3 a_lightPosition, float a_radi
 	return (a_lightPosition.x * a_lightPosition.x) + (a_lightPosition.y * a_lightPosition.y) + (a_lightPosition.z * a_lightPosition.z) - (a_radius * a_radius);
 }
 
-bool LightLimitFix::AddCachedParticleLights(eastl::vector<LightData>& lightsData, LightLimitFix::LightData& light, ParticleLights::Config* a_config, RE::BSGeometry* a_geometry, double a_timer)
+bool LightLimitFix::AddCachedParticleLights(std::uint64_t a_key, LightWorldData& light, ParticleLights::Config* a_config, RE::BSGeometry* a_geometry, double a_timer)
 {
+	auto state = RE::BSGraphics::RendererShadowState::GetSingleton();
+	auto eyePosition = eyeCount == 1 ?
+	                       state->GetRuntimeData().posAdjust.getEye(0) :
+	                       state->GetVRRuntimeData().posAdjust.getEye(0);
+
 	static float& lightFadeStart = (*(float*)RELOCATION_ID(527668, 414582).address());
 	static float& lightFadeEnd = (*(float*)RELOCATION_ID(527669, 414583).address());
 
-	float distance = CalculateLightDistance(light.positionWS[0], light.radius);
+	float distance = CalculateLightDistance(light.position - float3(eyePosition.x, eyePosition.y, eyePosition.z), light.radius);
 
 	float dimmer = 0.0f;
 
@@ -678,44 +988,26 @@ bool LightLimitFix::AddCachedParticleLights(eastl::vector<LightData>& lightsData
 	if ((light.color.x + light.color.y + light.color.z) > 1e-4 && light.radius > 1e-4) {
 		if (a_geometry && a_config && a_config->flicker) {
 			auto seed = (std::uint32_t)std::hash<void*>{}(a_geometry);
-
-			siv::PerlinNoise perlin1{ seed };
-			siv::PerlinNoise perlin2{ seed + 1 };
-			siv::PerlinNoise perlin3{ seed + 2 };
-			siv::PerlinNoise perlin4{ seed + 3 };
-
-			auto scaledTimer = a_timer * a_config->flickerSpeed;
-
-			for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
-				light.positionWS[eyeIndex].x += (float)perlin1.noise1D(scaledTimer) * a_config->flickerMovement;
-				light.positionWS[eyeIndex].y += (float)perlin2.noise1D(scaledTimer) * a_config->flickerMovement;
-				light.positionWS[eyeIndex].z += (float)perlin3.noise1D(scaledTimer) * a_config->flickerMovement;
-			}
-
-			light.color.x = std::max(0.0f, light.color.x - ((float)perlin4.noise1D_01(scaledTimer) * a_config->flickerIntensity));
-			light.color.y = std::max(0.0f, light.color.y - ((float)perlin4.noise1D_01(scaledTimer) * a_config->flickerIntensity));
-			light.color.z = std::max(0.0f, light.color.z - ((float)perlin4.noise1D_01(scaledTimer) * a_config->flickerIntensity));
+			auto& flickerNoise = FlickerNoise::Get(flickerNoiseCache, a_geometry, seed, lightFrame, flickerNoiseCacheHits, flickerNoiseCacheMisses);
+			auto flicker = FlickerNoise::Evaluate(flickerNoise, a_timer * a_config->flickerSpeed, a_config->flickerMovement, a_config->flickerIntensity);
+
+			light.position.x += flicker.x;
+			light.position.y += flicker.y;
+			light.position.z += flicker.z;
+			light.color.x = std::max(0.0f, light.color.x - flicker.intensity);
+			light.color.y = std::max(0.0f, light.color.y - flicker.intensity);
+			light.color.z = std::max(0.0f, light.color.z - flicker.intensity);
 		}
 
 		CachedParticleLight cachedParticleLight{};
 		cachedParticleLight.grey = float3(light.color.x, light.color.y, light.color.z).Dot(float3(0.3f, 0.59f, 0.11f));
 		cachedParticleLight.radius = light.radius;
 
-		auto state = RE::BSGraphics::RendererShadowState::GetSingleton();
-		auto eyePosition = eyeCount == 1 ?
-		                       state->GetRuntimeData().posAdjust.getEye(0) :
-		                       state->GetVRRuntimeData().posAdjust.getEye(0);
-		cachedParticleLight.position = { light.positionWS[0].x + eyePosition.x, light.positionWS[0].y + eyePosition.y, light.positionWS[0].z + eyePosition.z };
-		for (int eyeIndex = 0; eyeIndex < eyeCount; eyeIndex++) {
-			auto viewMatrix = eyeCount == 1 ?
-			                      state->GetRuntimeData().cameraData.getEye(eyeIndex).viewMat :
-			                      state->GetVRRuntimeData().cameraData.getEye(eyeIndex).viewMat;
-			light.positionVS[eyeIndex] = DirectX::SimpleMath::Vector3::Transform(light.positionWS[eyeIndex], viewMatrix);
-		}
+		cachedParticleLight.position = { light.position.x, light.position.y, light.position.z };
 
 		cachedParticleLights.push_back(cachedParticleLight);
 
-		lightsData.push_back(light);
+		SubmitLight(a_key, light);
 		return true;
 	}
 	return false;
@@ -730,6 +1022,178 @@ float3 LightLimitFix::Saturation(float3 color, float saturation)
 	return color;
 }
 
+std::uint64_t LightLimitFix::GetClusterCellKey(const RE::NiPoint3& a_position, float a_cellSize)
+{
+	return ParticleLightClustering::GetCellKey(a_position.x, a_position.y, a_position.z, a_cellSize);
+}
+
+void LightLimitFix::ClusterParticleSystem(ParticleSystemClusterTask& a_task, float a_cellSize, bool a_merge)
+{
+	a_task.clusters.clear();
+
+	auto particleSystem = a_task.particleSystem;
+	auto& particleInfo = *a_task.info;
+	auto particleData = particleSystem->GetParticleRuntimeData().particleData.get();
+	auto& particlesRuntimeData = particleData->GetParticlesRuntimeData();
+
+	RE::NiPoint3 offset{};
+	if (!particleSystem->GetParticleSystemRuntimeData().isWorldspace) {
+		// Detect first-person meshes
+		if ((particleSystem->GetModelData().modelBound.radius * particleSystem->world.scale) != particleSystem->worldBound.radius)
+			offset = particleSystem->worldBound.center;
+		else
+			offset = particleSystem->world.translate;
+	}
+
+	// Vertices are bucketed by the world-space cell they fall in, so the result does not depend on vertex order
+	FrameUnorderedMap<std::uint64_t, std::uint32_t> cellToCluster;
+
+	std::uint32_t numVertices = particleData->GetActiveVertexCount();
+	a_task.clusters.reserve(a_merge ? std::min<std::uint32_t>(numVertices, 256) : numVertices);
+
+	for (std::uint32_t p = 0; p < numVertices; p++) {
+		auto position = particlesRuntimeData.positions[p] + offset;
+
+		float alpha = particleInfo.color.alpha * particlesRuntimeData.color[p].alpha;
+		float3 color;
+		color.x = particleInfo.color.red * particlesRuntimeData.color[p].red;
+		color.y = particleInfo.color.green * particlesRuntimeData.color[p].green;
+		color.z = particleInfo.color.blue * particlesRuntimeData.color[p].blue;
+		color = Saturation(color, settings.ParticleLightsSaturation) * alpha;
+
+		float radius = particlesRuntimeData.sizes[p] * 64 * particleInfo.config.radiusMult;
+
+		if (!a_merge) {
+			auto id = (std::uint64_t)std::hash<void*>{}(particleSystem) ^ ((std::uint64_t)p << 32);
+			a_task.clusters.push_back({ id, color, radius, { position.x, position.y, position.z }, 1 });
+			continue;
+		}
+
+		ParticleLightCluster particle{ GetClusterCellKey(position, a_cellSize), color, radius, { position.x, position.y, position.z }, 1 };
+		ParticleLightClustering::Accumulate(a_task.clusters, cellToCluster, particle);
+	}
+}
+
+void LightLimitFix::ClusterParticleLights()
+{
+	particleLightClusters.clear();
+
+	bool merge = settings.EnableParticleLightsOptimization;
+	float cellSize = (float)std::max(settings.ParticleLightsOptimisationClusterRadius, 1u);
+
+	// Each particle system only writes its own bucket, so systems can be clustered concurrently
+	JobSystem::GetSingleton()->ForEach(particleSystemClusterTasks.begin(), particleSystemClusterTasks.end(), [&](ParticleSystemClusterTask& a_task) {
+		ClusterParticleSystem(a_task, cellSize, merge);
+	});
+
+	if (!merge) {
+		for (auto& task : particleSystemClusterTasks)
+			particleLightClusters.insert(particleLightClusters.end(), task.clusters.begin(), task.clusters.end());
+	} else {
+		// Merge the same cell across particle systems
+		FrameUnorderedMap<std::uint64_t, std::uint32_t> idToCluster;
+		for (auto& task : particleSystemClusterTasks) {
+			for (auto& cluster : task.clusters)
+				ParticleLightClustering::Accumulate(particleLightClusters, idToCluster, cluster);
+		}
+	}
+
+	particleSystemClusterTasks.clear();
+
+	ParticleLightClustering::Finalize(particleLightClusters);
+}
+
+void LightLimitFix::SubmitLight(std::uint64_t a_key, const LightWorldData& a_light)
+{
+	lightCandidates.push_back({ a_key, a_light, 0.0f });
+}
+
+void LightLimitFix::ApplyLightBudget(float a_deltaTime)
+{
+	lightBudgetCandidateCount = (std::uint32_t)lightCandidates.size();
+
+	// Without a budget everything is selected, and lights rejected earlier fade back in
+	size_t budget = settings.EnableLightBudget ? settings.LightBudget : lightCandidates.size();
+	if (lightCandidates.size() > budget) {
+		auto state = RE::BSGraphics::RendererShadowState::GetSingleton();
+		auto eyePosition = eyeCount == 1 ?
+		                       state->GetRuntimeData().posAdjust.getEye(0) :
+		                       state->GetVRRuntimeData().posAdjust.getEye(0);
+		float3 eye = { eyePosition.x, eyePosition.y, eyePosition.z };
+
+		for (auto& candidate : lightCandidates)
+			candidate.importance = LightBudget::GetImportance(candidate.light.position, candidate.light.radius, candidate.light.color, eye);
+	}
+
+	lightBudgetFadingCount = LightBudget::Select(lightCandidates, lightBudgetFades, budget, a_deltaTime / LightBudgetFadeTime, lightFrame, [](LightCandidate& a_candidate, float a_fade) {
+		a_candidate.light.color *= a_fade;
+	});
+}
+
+void LightLimitFix::UploadLights()
+{
+	auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
+	auto state = RE::BSGraphics::RendererShadowState::GetSingleton();
+
+	if (!lights) {
+		lightWorldBuffer = eastl::make_unique<DynamicStructuredBuffer<LightWorldData>>(256, DynamicStructuredBuffer<LightWorldData>::Usage::Default);
+		lights = eastl::make_unique<DynamicStructuredBuffer<LightData>>(256, DynamicStructuredBuffer<LightData>::Usage::UnorderedAccess);
+	}
+
+	// Released slots are uploaded as zero before being trimmed
+	auto& lightWorldData = lightSlots.GetData();
+	uint slotCount = lightSlots.GetCount();
+
+	// Both buffers are sized from the same counts, so they grow and shrink together
+	lights->Reserve(slotCount);
+	if (lightWorldBuffer->Reserve(slotCount)) {
+		if (slotCount)
+			lightWorldBuffer->UpdateRange(lightWorldData.data(), 0, slotCount);
+		uploadedLightCount = slotCount;
+		lightSlots.ClearDirty();
+	} else {
+		uploadedLightCount = lightSlots.FlushDirty([&](uint a_first, uint a_count) {
+			lightWorldBuffer->UpdateRange(&lightWorldData[a_first], a_first, a_count);
+		});
+	}
+
+	lightSlots.Trim();
+	uint slotsUsed = lightSlots.GetCount();
+
+	// Apply the camera to every light on the GPU
+	PerFrameLightTransform perFrameData{};
+	for (int eyeIndex = 0; eyeIndex < 2; eyeIndex++) {
+		int eye = std::min(eyeIndex, eyeCount - 1);
+		auto eyePosition = eyeCount == 1 ?
+		                       state->GetRuntimeData().posAdjust.getEye(eye) :
+		                       state->GetVRRuntimeData().posAdjust.getEye(eye);
+		perFrameData.ViewMatrix[eyeIndex] = eyeCount == 1 ?
+		                                        state->GetRuntimeData().cameraData.getEye(eye).viewMat :
+		                                        state->GetVRRuntimeData().cameraData.getEye(eye).viewMat;
+		perFrameData.EyePosition[eyeIndex] = { eyePosition.x, eyePosition.y, eyePosition.z, 0 };
+	}
+	perFrameData.LightCount = slotsUsed;
+	perFrameLightTransform->Update(perFrameData);
+
+	ID3D11Buffer* perframe_cb = perFrameLightTransform->CB();
+	context->CSSetConstantBuffers(1, 1, &perframe_cb);
+
+	ID3D11ShaderResourceView* srv = lightWorldBuffer->SRV();
+	context->CSSetShaderResources(0, 1, &srv);
+
+	ID3D11UnorderedAccessView* uav = lights->UAV();
+	context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+
+	context->CSSetShader(lightTransformCS, nullptr, 0);
+	context->Dispatch((slotsUsed + 63) / 64, 1, 1);
+	context->CSSetShader(nullptr, nullptr, 0);
+
+	ID3D11ShaderResourceView* null_srv = nullptr;
+	context->CSSetShaderResources(0, 1, &null_srv);
+	ID3D11UnorderedAccessView* null_uav = nullptr;
+	context->CSSetUnorderedAccessViews(0, 1, &null_uav, nullptr);
+}
+
 void LightLimitFix::UpdateLights()
 {
 	auto accumulator = RE::BSGraphics::BSShaderAccumulator::GetCurrentAccumulator();
@@ -737,8 +1201,6 @@ void LightLimitFix::UpdateLights()
 	lightsNear = std::max(0.0f, accumulator->kCamera->GetRuntimeData2().viewFrustum.fNear);
 	lightsFar = std::min(16384.0f, accumulator->kCamera->GetRuntimeData2().viewFrustum.fFar);
 
-	std::uint32_t currentLightCount = 0;  // Max number of lights is 4294967295
-
 	auto shadowSceneNode = RE::BSShaderManager::State::GetSingleton().shadowSceneNode[0];
 	auto state = RE::BSGraphics::RendererShadowState::GetSingleton();
 
@@ -764,7 +1226,8 @@ void LightLimitFix::UpdateLights()
 		}
 	}
 
-	eastl::vector<LightData> lightsData{};
+	lightFrame++;
+	lightCandidates.clear();
 
 	static float* g_deltaTime = (float*)RELOCATION_ID(523660, 410199).address();  // 2F6B948, 30064C8
 	static double timer = 0;
@@ -778,19 +1241,22 @@ void LightLimitFix::UpdateLights()
 				if (IsValidLight(bsLight) && IsGlobalLight(bsLight)) {
 					auto& runtimeData = niLight->GetLightRuntimeData();
 
-					LightData light{};
+					LightWorldData light{};
 					light.color = { runtimeData.diffuse.red, runtimeData.diffuse.green, runtimeData.diffuse.blue };
 					light.color *= runtimeData.fade;
 					light.color *= bsLight->lodDimmer;
 
 					light.radius = runtimeData.radius.x;
 
-					SetLightPosition(light, niLight->world.translate);
+					light.position = { niLight->world.translate.x, niLight->world.translate.y, niLight->world.translate.z };
 
 					static float& lightFadeStart = (*(float*)RELOCATION_ID(527668, 414582).address());
 					static float& lightFadeEnd = (*(float*)RELOCATION_ID(527669, 414583).address());
 
-					float distance = CalculateLightDistance(light.positionWS[0], light.radius);
+					auto eyePosition = eyeCount == 1 ?
+					                       state->GetRuntimeData().posAdjust.getEye(0) :
+					                       state->GetVRRuntimeData().posAdjust.getEye(0);
+					float distance = CalculateLightDistance(light.position - float3(eyePosition.x, eyePosition.y, eyePosition.z), light.radius);
 
 					float distantLightFadeStart = lightsFar * lightsFar * (lightFadeStart / lightFadeEnd);
 					float distantLightFadeEnd = lightsFar * lightsFar;
@@ -809,8 +1275,7 @@ void LightLimitFix::UpdateLights()
 
 					if ((light.color.x + light.color.y + light.color.z) > 1e-4 && light.radius > 1e-4) {
 						light.firstPersonShadow = bsLight == firstPersonLight || bsLight == thirdPersonLight || niLight == refLight || niLight == magicLight;
-						lightsData.push_back(light);
-						currentLightCount++;
+						SubmitLight((std::uint64_t)bsLight, light);
 					}
 				}
 			}
@@ -818,82 +1283,18 @@ void LightLimitFix::UpdateLights()
 	}
 
 	{
-		std::lock_guard<std::shared_mutex> lk{ cachedParticleLightsMutex };
 		cachedParticleLights.clear();
 
-		LightData clusteredLight{};
-		uint32_t clusteredLights = 0;
-
-		auto eyePosition = eyeCount == 1 ?
-		                       state->GetRuntimeData().posAdjust.getEye(0) :
-		                       state->GetVRRuntimeData().posAdjust.getEye(0);
+		particleSystemClusterTasks.clear();
 
 		for (const auto& particleLight : particleLights) {
 			if (const auto particleSystem = netimmerse_cast<RE::NiParticleSystem*>(particleLight.first);
 				particleSystem && particleSystem->GetParticleRuntimeData().particleData.get()) {
-				// process BSGeometry
-				auto particleData = particleSystem->GetParticleRuntimeData().particleData.get();
-
-				auto numVertices = particleData->GetActiveVertexCount();
-				for (std::uint32_t p = 0; p < numVertices; p++) {
-					float radius = particleData->GetParticlesRuntimeData().sizes[p] * 64;
-
-					auto initialPosition = particleData->GetParticlesRuntimeData().positions[p];
-					if (!particleSystem->GetParticleSystemRuntimeData().isWorldspace) {
-						// Detect first-person meshes
-						if ((particleLight.first->GetModelData().modelBound.radius * particleLight.first->world.scale) != particleLight.first->worldBound.radius)
-							initialPosition += particleLight.first->worldBound.center;
-						else
-							initialPosition += particleLight.first->world.translate;
-					}
-
-					RE::NiPoint3 positionWS = initialPosition - eyePosition;
-
-					if (clusteredLights) {
-						auto averageRadius = clusteredLight.radius / (float)clusteredLights;
-						float radiusDiff = abs(averageRadius - radius);
-
-						auto averagePosition = clusteredLight.positionWS[0] / (float)clusteredLights;
-						float positionDiff = positionWS.GetDistance({ averagePosition.x, averagePosition.y, averagePosition.z });
-
-						if ((radiusDiff + positionDiff) > settings.ParticleLightsOptimisationClusterRadius || !settings.EnableParticleLightsOptimization) {
-							clusteredLight.radius /= (float)clusteredLights;
-							clusteredLight.positionWS[0] /= (float)clusteredLights;
-							clusteredLight.positionWS[1] = clusteredLight.positionWS[0];
-							if (eyeCount == 2) {
-								auto offset = eyePosition - state->GetVRRuntimeData().posAdjust.getEye(1);
-								clusteredLight.positionWS[1].x += offset.x / (float)clusteredLights;
-								clusteredLight.positionWS[1].y += offset.y / (float)clusteredLights;
-								clusteredLight.positionWS[1].z += offset.z / (float)clusteredLights;
-							}
-
-							currentLightCount += AddCachedParticleLights(lightsData, clusteredLight);
-
-							clusteredLights = 0;
-							clusteredLight.color = { 0, 0, 0 };
-							clusteredLight.radius = 0;
-							clusteredLight.positionWS[0] = { 0, 0, 0 };
-						}
-					}
-
-					float alpha = particleLight.second.color.alpha * particleData->GetParticlesRuntimeData().color[p].alpha;
-					float3 color;
-					color.x = particleLight.second.color.red * particleData->GetParticlesRuntimeData().color[p].red;
-					color.y = particleLight.second.color.green * particleData->GetParticlesRuntimeData().color[p].green;
-					color.z = particleLight.second.color.blue * particleData->GetParticlesRuntimeData().color[p].blue;
-					clusteredLight.color += Saturation(color, settings.ParticleLightsSaturation) * alpha;
-
-					clusteredLight.radius += radius * particleLight.second.config.radiusMult;
-					clusteredLight.positionWS[0].x += positionWS.x;
-					clusteredLight.positionWS[0].y += positionWS.y;
-					clusteredLight.positionWS[0].z += positionWS.z;
-
-					clusteredLights++;
-				}
-
+				// process BSGeometry, clustered below
+				particleSystemClusterTasks.push_back({ particleSystem, &particleLight.second, {} });
 			} else {
 				// process billboard
-				LightData light{};
+				LightWorldData light{};
 
 				light.color.x = particleLight.second.color.red;
 				light.color.y = particleLight.second.color.green;
@@ -907,89 +1308,78 @@ void LightLimitFix::UpdateLights()
 
 				light.radius = radius * settings.ParticleLightsRadiusBillboards;
 
-				SetLightPosition(light, particleLight.first->worldBound.center);  //light is complete for both eyes by now
+				auto& center = particleLight.first->worldBound.center;
+				light.position = { center.x, center.y, center.z };
 
-				currentLightCount += AddCachedParticleLights(lightsData, light, &particleLight.second.config, particleLight.first, timer);
+				AddCachedParticleLights((std::uint64_t)particleLight.first, light, &particleLight.second.config, particleLight.first, timer);
 			}
 		}
 
-		if (clusteredLights) {
-			clusteredLight.radius /= (float)clusteredLights;
-			clusteredLight.positionWS[0] /= (float)clusteredLights;
-			clusteredLight.positionWS[1] = clusteredLight.positionWS[0];
-			if (eyeCount == 2) {
-				auto offset = eyePosition - state->GetVRRuntimeData().posAdjust.getEye(1);
-				clusteredLight.positionWS[1].x += offset.x / (float)clusteredLights;
-				clusteredLight.positionWS[1].y += offset.y / (float)clusteredLights;
-				clusteredLight.positionWS[1].z += offset.z / (float)clusteredLights;
-			}
-			currentLightCount += AddCachedParticleLights(lightsData, clusteredLight);
+		ClusterParticleLights();
+
+		for (const auto& cluster : particleLightClusters) {
+			LightWorldData clusteredLight{};
+			clusteredLight.color = cluster.color;
+			clusteredLight.radius = cluster.radius;
+			clusteredLight.position = cluster.position;
+
+			// Pointers are aligned, so the low bit keeps cluster keys apart from light and geometry keys
+			AddCachedParticleLights((cluster.id << 1) | 1, clusteredLight);
 		}
+
+		PublishParticleLightGrid();
 	}
 
 	auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
 
-	{
-		if (!currentLightCount) {
-			LightData data{};
-			lightsData.push_back(data);
-			currentLightCount = 1;
-		}
+	ApplyLightBudget(RE::UI::GetSingleton()->GameIsPaused() ? 0.0f : *g_deltaTime);
 
-		bool lightCountChanged = currentLightCount != lightCount;
-
-		if (!lights || lightCountChanged) {
-			lightCount = currentLightCount;
-
-			D3D11_BUFFER_DESC sbDesc{};
-			sbDesc.Usage = D3D11_USAGE_DYNAMIC;
-			sbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			sbDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-			sbDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-			sbDesc.StructureByteStride = sizeof(LightData);
-			sbDesc.ByteWidth = sizeof(LightData) * lightCount;
-			lights = eastl::make_unique<Buffer>(sbDesc);
-
-			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-			srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-			srvDesc.Buffer.FirstElement = 0;
-			srvDesc.Buffer.NumElements = lightCount;
-			lights->CreateSRV(srvDesc);
-		}
+	for (auto& candidate : lightCandidates)
+		lightSlots.Assign(candidate.key, candidate.light, lightFrame);
+	lightCount = (std::uint32_t)lightCandidates.size();
 
-		D3D11_MAPPED_SUBRESOURCE mapped;
-		DX::ThrowIfFailed(context->Map(lights->resource.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
-		size_t bytes = sizeof(LightData) * lightCount;
-		memcpy_s(mapped.pData, bytes, lightsData.data(), bytes);
-		context->Unmap(lights->resource.get(), 0);
-	}
+	lightSlots.ReleaseStale(lightFrame);
+	UploadLights();
+
+	FlickerNoise::Trim(flickerNoiseCache, lightFrame);
 
 	{
 		auto projMatrixUnjittered = eyeCount == 1 ? state->GetRuntimeData().cameraData.getEye().projMatrixUnjittered : state->GetVRRuntimeData().cameraData.getEye().projMatrixUnjittered;
 		float fov = atan(1.0f / static_cast<float4x4>(projMatrixUnjittered).m[0][0]) * 2.0f * (180.0f / 3.14159265359f);
 
-		static float _near = 0.0f, _far = 0.0f, _fov = 0.0f, _lightsNear = 0.0f, _lightsFar = 0.0f;
-		if (fabs(_near - accumulator->kCamera->GetRuntimeData2().viewFrustum.fNear) > 1e-4 || fabs(_far - accumulator->kCamera->GetRuntimeData2().viewFrustum.fFar) > 1e-4 || fabs(_fov - fov) > 1e-4 || fabs(_lightsNear - lightsNear) > 1e-4 || fabs(_lightsFar - lightsFar) > 1e-4) {
-			PerFrameLightCulling perFrameData{};
-			perFrameData.InvProjMatrix[0] = DirectX::XMMatrixInverse(nullptr, projMatrixUnjittered);
-			if (eyeCount == 1)
-				perFrameData.InvProjMatrix[1] = perFrameData.InvProjMatrix[0];
-			else
-				perFrameData.InvProjMatrix[1] = DirectX::XMMatrixInverse(nullptr, state->GetVRRuntimeData().cameraData.getEye(1).projMatrixUnjittered);
-			perFrameData.LightsNear = lightsNear;
-			perFrameData.LightsFar = lightsFar;
-
-			perFrameLightCulling->Update(perFrameData);
-
-			ID3D11Buffer* perframe_cb = perFrameLightCulling->CB();
-			context->CSSetConstantBuffers(0, 1, &perframe_cb);
+		// Compared clamped, the sliders can be typed into past their range
+		if (clusterSize[0] != ClusterLightCulling::ClampClusterSize(settings.ClusterSizeX) ||
+			clusterSize[1] != ClusterLightCulling::ClampClusterSize(settings.ClusterSizeY) ||
+			clusterSize[2] != ClusterLightCulling::ClampClusterSize(settings.ClusterSizeZ))
+			CreateClusterResources();
+
+		PerFrameLightCulling perFrameData{};
+		perFrameData.InvProjMatrix[0] = DirectX::XMMatrixInverse(nullptr, projMatrixUnjittered);
+		if (eyeCount == 1)
+			perFrameData.InvProjMatrix[1] = perFrameData.InvProjMatrix[0];
+		else
+			perFrameData.InvProjMatrix[1] = DirectX::XMMatrixInverse(nullptr, state->GetVRRuntimeData().cameraData.getEye(1).projMatrixUnjittered);
+		perFrameData.LightsNear = lightsNear;
+		perFrameData.LightsFar = lightsFar;
+		perFrameData.ClusterSizeX = clusterSize[0];
+		perFrameData.ClusterSizeY = clusterSize[1];
+		perFrameData.ClusterSizeZ = clusterSize[2];
+		perFrameData.ClusterCount = clusterCount;
+		perFrameData.LightListCapacity = lightListCapacity;
+
+		perFrameLightCulling->Update(perFrameData);
+
+		// the light count of PerFrameLightTransform bounds the culling loop, the lights view covers the whole buffer
+		ID3D11Buffer* perframe_cbs[] = { perFrameLightCulling->CB(), perFrameLightTransform->CB() };
+		context->CSSetConstantBuffers(0, ARRAYSIZE(perframe_cbs), perframe_cbs);
 
+		static float _near = 0.0f, _far = 0.0f, _fov = 0.0f, _lightsNear = 0.0f, _lightsFar = 0.0f;
+		if (clustersDirty || fabs(_near - accumulator->kCamera->GetRuntimeData2().viewFrustum.fNear) > 1e-4 || fabs(_far - accumulator->kCamera->GetRuntimeData2().viewFrustum.fFar) > 1e-4 || fabs(_fov - fov) > 1e-4 || fabs(_lightsNear - lightsNear) > 1e-4 || fabs(_lightsFar - lightsFar) > 1e-4) {
 			ID3D11UnorderedAccessView* clusters_uav = clusters->uav.get();
 			context->CSSetUnorderedAccessViews(0, 1, &clusters_uav, nullptr);
 
 			context->CSSetShader(clusterBuildingCS, nullptr, 0);
-			context->Dispatch(CLUSTER_SIZE_X, CLUSTER_SIZE_Y, CLUSTER_SIZE_Z);
+			context->Dispatch(clusterSize[0], clusterSize[1], clusterSize[2]);
 			context->CSSetShader(nullptr, nullptr, 0);
 
 			ID3D11UnorderedAccessView* null_uav = nullptr;
@@ -1000,24 +1390,50 @@ void LightLimitFix::UpdateLights()
 			_fov = fov;
 			_lightsNear = lightsNear;
 			_lightsFar = lightsFar;
+			clustersDirty = false;
 		}
 	}
 
+	// Count the lights per cluster, turn the counts into offsets, then fill the packed list
+	uint cullingGroups = (clusterCount + 63) / 64;
+	{
+		ID3D11ShaderResourceView* srvs[] = { clusters->srv.get(), lights->SRV() };
+		context->CSSetShaderResources(0, ARRAYSIZE(srvs), srvs);
+		ID3D11UnorderedAccessView* uavs[] = { lightGrid->uav.get() };
+		context->CSSetUnorderedAccessViews(0, ARRAYSIZE(uavs), uavs, nullptr);
+
+		context->CSSetShader(clusterCountCS, nullptr, 0);
+		context->Dispatch(cullingGroups, 1, 1);
+	}
+
+	{
+		ID3D11UnorderedAccessView* uavs[] = { lightGrid->uav.get(), lightCounter->uav.get() };
+		context->CSSetUnorderedAccessViews(0, ARRAYSIZE(uavs), uavs, nullptr);
+
+		context->CSSetShader(clusterPrefixSumCS, nullptr, 0);
+		context->Dispatch(1, 1, 1);
+	}
+
 	{
-		ID3D11ShaderResourceView* srvs[] = { clusters->srv.get(), lights->srv.get() };
+		ID3D11UnorderedAccessView* null_uavs[2] = { nullptr };
+		context->CSSetUnorderedAccessViews(0, ARRAYSIZE(null_uavs), null_uavs, nullptr);
+
+		ID3D11ShaderResourceView* srvs[] = { clusters->srv.get(), lights->SRV(), lightGrid->srv.get() };
 		context->CSSetShaderResources(0, ARRAYSIZE(srvs), srvs);
-		ID3D11UnorderedAccessView* uavs[] = { lightCounter->uav.get(), lightList->uav.get(), lightGrid->uav.get() };
+		ID3D11UnorderedAccessView* uavs[] = { lightList->uav.get() };
 		context->CSSetUnorderedAccessViews(0, ARRAYSIZE(uavs), uavs, nullptr);
 
-		context->CSSetShader(clusterCullingCS, nullptr, 0);
-		context->Dispatch(CLUSTER_SIZE_X / 16, CLUSTER_SIZE_Y / 16, CLUSTER_SIZE_Z / 4);
+		context->CSSetShader(clusterFillCS, nullptr, 0);
+		context->Dispatch(cullingGroups, 1, 1);
 		context->CSSetShader(nullptr, nullptr, 0);
 	}
 
-	ID3D11ShaderResourceView* null_srvs[2] = { nullptr };
+	ID3D11ShaderResourceView* null_srvs[3] = { nullptr };
 	context->CSSetShaderResources(0, ARRAYSIZE(null_srvs), null_srvs);
-	ID3D11UnorderedAccessView* null_uavs[3] = { nullptr };
+	ID3D11UnorderedAccessView* null_uavs[1] = { nullptr };
 	context->CSSetUnorderedAccessViews(0, ARRAYSIZE(null_uavs), null_uavs, nullptr);
+
+	UpdateLightListCapacity();
 }
 
 bool LightLimitFix::HasShaderDefine(RE::BSShader::Type shaderType)
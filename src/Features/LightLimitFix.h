@@ -3,10 +3,17 @@
 #include <d3d11.h>
 
 #include "Buffer.h"
-#include <shared_mutex>
+#include <atomic>
 
 #include "Feature.h"
+#include "FrameArena.h"
 #include "ShaderCache.h"
+#include "ShaderTools/BSShader.h"
+#include <Features/LightLimitFix/ClusterLightCulling.h>
+#include <Features/LightLimitFix/FlickerNoise.h>
+#include <Features/LightLimitFix/LightBudget.h>
+#include <Features/LightLimitFix/LightSlots.h>
+#include <Features/LightLimitFix/ParticleLightClustering.h>
 #include <Features/LightLimitFix/ParticleLights.h>
 
 struct LightLimitFix : Feature
@@ -37,6 +44,15 @@ public:
 		uint firstPersonShadow;
 	};
 
+	// Camera independent light data, only uploaded when a light moves or changes
+	struct LightWorldData
+	{
+		float3 color;
+		float radius;
+		float3 position;
+		uint firstPersonShadow;
+	};
+
 	struct ClusterAABB
 	{
 		float4 minPoint;
@@ -54,7 +70,20 @@ public:
 		float4x4 InvProjMatrix[2];
 		float LightsNear;
 		float LightsFar;
-		uint pad[2];
+		uint ClusterSizeX;
+		uint ClusterSizeY;
+		uint ClusterSizeZ;
+		uint ClusterCount;
+		uint LightListCapacity;
+		uint pad;
+	};
+
+	struct alignas(16) PerFrameLightTransform
+	{
+		float4x4 ViewMatrix[2];
+		float4 EyePosition[2];
+		uint LightCount;
+		uint pad[3];
 	};
 
 	struct PerPass
@@ -68,6 +97,9 @@ public:
 		float4 CameraData;
 		float2 BufferDim;
 		uint FrameCount;
+		uint ClusterSizeX;
+		uint ClusterSizeY;
+		uint ClusterSizeZ;
 	};
 
 	struct StrictLightData
@@ -80,6 +112,25 @@ public:
 
 	StrictLightData strictLightDataTemp;
 
+	// Strict light data is sub-allocated from a ring with NO_OVERWRITE maps behind a single view,
+	// the slot of each draw is passed in the otherwise unused z of NumLightNumShadowLight.
+	// Slot 0 is reserved for geometry without strict lights.
+	static constexpr uint StrictLightDataRingSize = 2048;
+	static constexpr uint NumLightNumShadowLightConstant = 0;  // index in the Lighting pixel shader constant table
+
+	bool strictLightDataNoOverwrite = false;
+	bool strictLightDataUploaded = false;
+	uint strictLightDataRingOffset = 1;
+	uint strictLightDataSlot = 0;
+	StrictLightData strictLightDataLast;
+
+	std::uint32_t strictLightDataDraws = 0;
+	std::uint32_t strictLightDataMaps = 0;
+	std::uint32_t strictLightDataDrawsLastFrame = 0;
+	std::uint32_t strictLightDataMapsLastFrame = 0;
+
+	static bool IsStrictLightDataEqual(const StrictLightData& a_lhs, const StrictLightData& a_rhs);
+
 	struct CachedParticleLight
 	{
 		float grey;
@@ -94,18 +145,56 @@ public:
 	int eyeCount = !REL::Module::IsVR() ? 1 : 2;
 
 	ID3D11ComputeShader* clusterBuildingCS = nullptr;
-	ID3D11ComputeShader* clusterCullingCS = nullptr;
+	ID3D11ComputeShader* clusterCountCS = nullptr;
+	ID3D11ComputeShader* clusterPrefixSumCS = nullptr;
+	ID3D11ComputeShader* clusterFillCS = nullptr;
+	ID3D11ComputeShader* lightTransformCS = nullptr;
 
 	ConstantBuffer* perFrameLightCulling = nullptr;
+	ConstantBuffer* perFrameLightTransform = nullptr;
 
-	eastl::unique_ptr<Buffer> lights = nullptr;
+	eastl::unique_ptr<DynamicStructuredBuffer<LightWorldData>> lightWorldBuffer = nullptr;
+	eastl::unique_ptr<DynamicStructuredBuffer<LightData>> lights = nullptr;
 	eastl::unique_ptr<Buffer> clusters = nullptr;
 	eastl::unique_ptr<Buffer> lightCounter = nullptr;
 	eastl::unique_ptr<Buffer> lightList = nullptr;
 	eastl::unique_ptr<Buffer> lightGrid = nullptr;
 
+	// The light list is sized from the total of a previous frame, read back without stalling
+	static constexpr uint LightListReadbackLatency = 3;
+	static constexpr uint LightListShrinkDelay = 300;
+
+	uint clusterSize[3]{};
+	uint clusterCount = 0;
+	bool clustersDirty = true;
+	uint lightListCapacity = 0;
+	uint lightListTotal = 0;
+	uint lightListShrinkCounter = 0;
+	std::array<winrt::com_ptr<ID3D11Buffer>, LightListReadbackLatency> lightCounterReadback;
+	uint lightCounterReadbackFrame = 0;
+
 	std::uint32_t lightCount = 0;
 
+	// Each light keeps its slot for as long as it stays visible, keyed on the light, geometry or cluster
+	LightSlots<LightWorldData> lightSlots;
+	std::uint32_t lightFrame = 0;
+	std::uint32_t uploadedLightCount = 0;
+
+	struct LightCandidate
+	{
+		std::uint64_t key;
+		LightWorldData light;
+		float importance;
+	};
+
+	// Lights outside the budget fade out over a short time rather than popping
+	static constexpr float LightBudgetFadeTime = 0.25f;
+
+	eastl::vector<LightCandidate> lightCandidates;
+	eastl::hash_map<std::uint64_t, LightBudget::Fade> lightBudgetFades;
+	std::uint32_t lightBudgetCandidateCount = 0;
+	std::uint32_t lightBudgetFadingCount = 0;
+
 	Texture2D* screenSpaceShadowsTexture = nullptr;
 
 	struct ParticleLightInfo
@@ -117,6 +206,52 @@ public:
 	eastl::hash_map<RE::BSGeometry*, ParticleLightInfo> queuedParticleLights;
 	eastl::hash_map<RE::BSGeometry*, ParticleLightInfo> particleLights;
 
+	struct ParticleLightCluster
+	{
+		std::uint64_t id;  // world-space grid cell, stable while the cluster does not move
+		float3 color;
+		float radius;
+		float3 position;
+		std::uint32_t count;
+	};
+
+	struct ParticleSystemClusterTask
+	{
+		RE::NiParticleSystem* particleSystem;
+		const ParticleLightInfo* info;
+		FrameVector<ParticleLightCluster> clusters;
+	};
+
+	std::vector<ParticleSystemClusterTask> particleSystemClusterTasks;  // only valid during UpdateLights, the clusters live in the frame arena
+	std::vector<ParticleLightCluster> particleLightClusters;
+
+	struct ParticleMaterialCacheEntry
+	{
+		const char* sourceTexturePath;  // BSFixedString data is interned, so a new pointer means a new texture
+		const char* greyscaleTexturePath;
+		ParticleLights::Config* config;  // nullptr when the material does not emit light
+		ParticleLights::GradientConfig* gradientConfig;
+	};
+
+	struct VertexColorCacheEntry
+	{
+		std::uint8_t* rawVertexData;
+		std::uint32_t vertexCount;
+		RE::NiColorA color;
+	};
+
+	eastl::hash_map<RE::BSEffectShaderMaterial*, ParticleMaterialCacheEntry> particleMaterialCache;
+	eastl::hash_map<RE::BSGraphics::TriShape*, VertexColorCacheEntry> vertexColorCache;
+
+	eastl::hash_map<RE::BSGeometry*, FlickerNoise::Entry> flickerNoiseCache;
+
+	std::uint64_t particleMaterialCacheHits = 0;
+	std::uint64_t particleMaterialCacheMisses = 0;
+	std::uint64_t vertexColorCacheHits = 0;
+	std::uint64_t vertexColorCacheMisses = 0;
+	std::uint64_t flickerNoiseCacheHits = 0;
+	std::uint64_t flickerNoiseCacheMisses = 0;
+
 	virtual void SetupResources();
 	virtual void Reset();
 
@@ -128,10 +263,23 @@ public:
 
 	virtual void PostPostLoad() override;
 	virtual void DataLoaded() override;
+	virtual void ClearShaderCache() override;
+	virtual std::vector<SIE::ComputeShaderDesc> GetComputeShaderDescs() override;
+	void CreateComputeShaders();
 
 	float CalculateLightDistance(float3 a_lightPosition, float a_radius);
-	bool AddCachedParticleLights(eastl::vector<LightData>& lightsData, LightLimitFix::LightData& light, ParticleLights::Config* a_config = nullptr, RE::BSGeometry* a_geometry = nullptr, double timer = 0.0f);
-	void SetLightPosition(LightLimitFix::LightData& a_light, RE::NiPoint3& a_initialPosition);
+	bool AddCachedParticleLights(std::uint64_t a_key, LightWorldData& light, ParticleLights::Config* a_config = nullptr, RE::BSGeometry* a_geometry = nullptr, double timer = 0.0f);
+	void SubmitLight(std::uint64_t a_key, const LightWorldData& a_light);
+	void ApplyLightBudget(float a_deltaTime);
+	void UploadLights();
+	void CreateClusterResources();
+	void ResizeLightList(uint a_capacity);
+	void UpdateLightListCapacity();
+	static std::uint64_t GetClusterCellKey(const RE::NiPoint3& a_position, float a_cellSize);
+	void ClusterParticleSystem(ParticleSystemClusterTask& a_task, float a_cellSize, bool a_merge);
+	void ClusterParticleLights();
+	const ParticleMaterialCacheEntry& GetParticleMaterialConfig(RE::BSEffectShaderMaterial* a_material);
+	const RE::NiColorA& GetMaxVertexColor(RE::BSGeometry* a_geometry);
 	void UpdateLights();
 	void Bind();
 
@@ -153,6 +301,11 @@ public:
 		float ParticleLightsRadiusBillboards = 1.0f;
 		bool EnableParticleLightsOptimization = true;
 		uint ParticleLightsOptimisationClusterRadius = 32;
+		bool EnableLightBudget = true;
+		uint LightBudget = 1024;
+		uint ClusterSizeX = 16;
+		uint ClusterSizeY = 16;
+		uint ClusterSizeZ = 16;
 	};
 
 	float lightsNear = 0.0f;
@@ -172,13 +325,28 @@ public:
 
 	void BSLightingShader_SetupGeometry_GeometrySetupConstantPointLights(RE::BSRenderPass* a_pass, DirectX::XMMATRIX& Transform, uint32_t, uint32_t, float WorldScale, Space RenderSpace);
 
+	void BSLightingShader_SetupGeometry_SetStrictLightDataSlot(const REX::PixelShaderConstantGroup& a_pixelCG);
+
 	void BSLightingShader_SetupGeometry_After(RE::BSRenderPass* a_pass);
 
-	std::shared_mutex cachedParticleLightsMutex;
+	// Built on the render thread each frame, then published to the AI threads as an immutable grid
 	eastl::vector<CachedParticleLight> cachedParticleLights;
-	uint32_t particleLightsDetectionHits = 0;
 
-	float CalculateLuminance(CachedParticleLight& light, RE::NiPoint3& point);
+	struct ParticleLightGrid
+	{
+		float cellSize = 0.0f;  // never smaller than the largest radius, so a query touches at most 3x3x3 cells
+		float maxRadius = 0.0f;
+		eastl::vector<CachedParticleLight> lights;                                   // sorted by cell
+		eastl::hash_map<std::uint64_t, std::pair<std::uint32_t, std::uint32_t>> cells;  // first light, light count
+	};
+
+	std::atomic<std::shared_ptr<const ParticleLightGrid>> particleLightGrid;
+	std::shared_ptr<ParticleLightGrid> frontParticleLightGrid;
+	std::shared_ptr<ParticleLightGrid> backParticleLightGrid;
+	std::atomic<uint32_t> particleLightsDetectionHits = 0;
+
+	void PublishParticleLightGrid();
+	float CalculateLuminance(const CachedParticleLight& light, RE::NiPoint3& point);
 	void AddParticleLightLuminance(RE::NiPoint3& targetPosition, int& numHits, float& lightLevel);
 
 	struct Hooks
@@ -264,10 +432,11 @@ public:
 
 		struct BSLightingShader_SetupGeometry_GeometrySetupConstantPointLights
 		{
-			static void thunk(RE::BSGraphics::PixelShader* PixelShader, RE::BSRenderPass* Pass, DirectX::XMMATRIX& Transform, uint32_t LightCount, uint32_t ShadowLightCount, float WorldScale, Space RenderSpace)
+			static void thunk(const REX::PixelShaderConstantGroup& PixelCG, RE::BSRenderPass* Pass, DirectX::XMMATRIX& Transform, uint32_t LightCount, uint32_t ShadowLightCount, float WorldScale, Space RenderSpace)
 			{
 				GetSingleton()->BSLightingShader_SetupGeometry_GeometrySetupConstantPointLights(Pass, Transform, LightCount, ShadowLightCount, WorldScale, RenderSpace);
-				func(PixelShader, Pass, Transform, LightCount, ShadowLightCount, WorldScale, RenderSpace);
+				func(PixelCG, Pass, Transform, LightCount, ShadowLightCount, WorldScale, RenderSpace);
+				GetSingleton()->BSLightingShader_SetupGeometry_SetStrictLightDataSlot(PixelCG);
 			}
 			static inline REL::Relocation<decltype(thunk)> func;
 		};
@@ -203,6 +203,15 @@ void ScreenSpaceShadows::ClearShaderCache()
 	}
 }
 
+std::vector<SIE::ComputeShaderDesc> ScreenSpaceShadows::GetComputeShaderDescs()
+{
+	return {
+		{ L"Data\\Shaders\\ScreenSpaceShadows\\RaymarchCS.hlsl" },
+		{ L"Data\\Shaders\\ScreenSpaceShadows\\FilterCS.hlsl", { { "HORIZONTAL", "" } } },
+		{ L"Data\\Shaders\\ScreenSpaceShadows\\FilterCS.hlsl", { { "VERTICAL", "" } } },
+	};
+}
+
 ID3D11ComputeShader* ScreenSpaceShadows::GetComputeShader()
 {
 	if (!raymarchProgram) {
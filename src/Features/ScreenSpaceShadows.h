@@ -75,6 +75,7 @@ struct ScreenSpaceShadows : Feature
 	void ModifyDistantTree(const RE::BSShader*, const uint32_t descriptor);
 
 	virtual void ClearShaderCache() override;
+	virtual std::vector<SIE::ComputeShaderDesc> GetComputeShaderDescs() override;
 	ID3D11ComputeShader* GetComputeShader();
 	ID3D11ComputeShader* GetComputeShaderHorizontalBlur();
 	ID3D11ComputeShader* GetComputeShaderVerticalBlur();
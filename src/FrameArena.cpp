@@ -0,0 +1,41 @@
+#include "FrameArena.h"
+
+#include <bit>
+
+FrameArena::FrameArena()
+{
+	block.reset(new std::byte[capacity]);
+}
+
+void* FrameArena::Allocate(size_t a_size, size_t a_alignment)
+{
+	allocations++;
+	auto padded = a_size + a_alignment - 1;
+	auto offset = used.fetch_add(padded, std::memory_order_relaxed);
+
+	std::byte* memory;
+	if (offset + padded <= capacity) {
+		memory = block.get() + offset;
+	} else {
+		std::scoped_lock lock(overflowMutex);
+		overflowBlocks.emplace_back(new std::byte[padded]);
+		memory = overflowBlocks.back().get();
+	}
+
+	auto address = reinterpret_cast<uintptr_t>(memory);
+	return reinterpret_cast<void*>((address + a_alignment - 1) & ~(uintptr_t)(a_alignment - 1));
+}
+
+void FrameArena::Reset()
+{
+	frameAllocations = allocations.exchange(0);
+	frameBytes = used.exchange(0);
+
+	// grow with some headroom so the next frame fits in one block again
+	if (!overflowBlocks.empty()) {
+		overflowBlocks.clear();
+		capacity = std::bit_ceil(frameBytes + frameBytes / 2);
+		block.reset(new std::byte[capacity]);
+		logger::debug("Frame arena grown to {} KB", capacity / 1024);
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// Linear allocator for data thrown away within the frame. Allocating is a pointer bump, freeing does nothing and everything
+// is released at once when the Present hook calls Reset, so nothing allocated here may be used after the frame it came from.
+class FrameArena
+{
+public:
+	static FrameArena* GetSingleton()
+	{
+		static FrameArena singleton;
+		return &singleton;
+	}
+
+	// Thread safe, so jobs running on the JobSystem during the frame can allocate as well
+	void* Allocate(size_t a_size, size_t a_alignment = alignof(std::max_align_t));
+	void Reset();
+
+	uint32_t GetFrameAllocations() const { return frameAllocations; }
+	size_t GetFrameBytes() const { return frameBytes; }
+	size_t GetCapacity() const { return capacity; }
+
+private:
+	FrameArena();
+
+	static constexpr size_t InitialCapacity = 1 << 20;
+
+	std::unique_ptr<std::byte[]> block;
+	size_t capacity = InitialCapacity;
+	std::atomic<size_t> used = 0;
+	std::atomic<uint32_t> allocations = 0;
+	std::vector<std::unique_ptr<std::byte[]>> overflowBlocks;  // allocations that did not fit, block grows on the next Reset instead
+	std::mutex overflowMutex;
+
+	// last finished frame
+	uint32_t frameAllocations = 0;
+	size_t frameBytes = 0;
+};
+
+template <class T>
+struct FrameAllocator
+{
+	using value_type = T;
+
+	FrameAllocator() noexcept = default;
+	template <class U>
+	FrameAllocator(const FrameAllocator<U>&) noexcept
+	{}
+
+	T* allocate(size_t a_count) { return static_cast<T*>(FrameArena::GetSingleton()->Allocate(a_count * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) noexcept {}
+
+	template <class U>
+	bool operator==(const FrameAllocator<U>&) const noexcept
+	{
+		return true;
+	}
+};
+
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+template <class Key, class Value, class Hash = std::hash<Key>>
+using FrameUnorderedMap = std::unordered_map<Key, Value, Hash, std::equal_to<Key>, FrameAllocator<std::pair<const Key, Value>>>;
+using FrameString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+
+class FrameEastlAllocator
+{
+public:
+	FrameEastlAllocator(const char* = nullptr) {}
+	FrameEastlAllocator(const FrameEastlAllocator&, const char*) {}
+
+	void* allocate(size_t a_size, int = 0) { return FrameArena::GetSingleton()->Allocate(a_size); }
+	void* allocate(size_t a_size, size_t a_alignment, size_t a_offset, int = 0)
+	{
+		// EASTL wants (pointer + offset) aligned rather than the pointer itself
+		auto address = reinterpret_cast<uintptr_t>(FrameArena::GetSingleton()->Allocate(a_size + a_alignment, 1));
+		return reinterpret_cast<void*>(((address + a_offset + a_alignment - 1) & ~(uintptr_t)(a_alignment - 1)) - a_offset);
+	}
+	void deallocate(void*, size_t) {}
+
+	const char* get_name() const { return "FrameArena"; }
+	void set_name(const char*) {}
+
+	bool operator==(const FrameEastlAllocator&) const { return true; }
+	bool operator!=(const FrameEastlAllocator&) const { return false; }
+};
+
+template <class T>
+using FrameEastlVector = eastl::vector<T, FrameEastlAllocator>;
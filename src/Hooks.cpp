@@ -2,6 +2,8 @@
 
 #include <detours/Detours.h>
 
+#include "Feature.h"
+#include "FrameArena.h"
 #include "Menu.h"
 #include "ShaderCache.h"
 #include "State.h"
@@ -95,6 +97,7 @@ void hk_BSShader_LoadShaders(RE::BSShader* shader, std::uintptr_t stream)
 			auto vertexShaderDesriptor = entry->id;
 			auto pixelShaderDescriptor = entry->id;
 			State::GetSingleton()->ModifyShaderLookup(*shader, vertexShaderDesriptor, pixelShaderDescriptor);
+			shaderCache.RecordDescriptor(*shader, SIE::ShaderClass::Vertex, entry->id, vertexShaderDesriptor);
 			shaderCache.GetVertexShader(*shader, vertexShaderDesriptor);
 		}
 		for (const auto& entry : shader->pixelShaders) {
@@ -105,6 +108,7 @@ void hk_BSShader_LoadShaders(RE::BSShader* shader, std::uintptr_t stream)
 			auto vertexShaderDesriptor = entry->id;
 			auto pixelShaderDescriptor = entry->id;
 			State::GetSingleton()->ModifyShaderLookup(*shader, vertexShaderDesriptor, pixelShaderDescriptor);
+			shaderCache.RecordDescriptor(*shader, SIE::ShaderClass::Pixel, entry->id, pixelShaderDescriptor);
 			shaderCache.GetPixelShader(*shader, pixelShaderDescriptor);
 		}
 	}
@@ -130,7 +134,16 @@ HRESULT WINAPI hk_IDXGISwapChain_Present(IDXGISwapChain* This, UINT SyncInterval
 {
 	State::GetSingleton()->Reset();
 	Menu::GetSingleton()->DrawOverlay();
-	return (This->*ptr_IDXGISwapChain_Present)(SyncInterval, Flags);
+	FrameArena::GetSingleton()->Reset();
+	if (SIE::ShaderCache::Instance().computeShadersReloaded.exchange(false)) {
+		for (auto* feature : Feature::GetFeatureList()) {
+			if (feature->loaded)
+				feature->ClearShaderCache();
+		}
+	}
+	auto result = (This->*ptr_IDXGISwapChain_Present)(SyncInterval, Flags);
+	SIE::ShaderCache::Instance().ReleaseRetiredShaders();
+	return result;
 }
 
 void hk_BSGraphics_SetDirtyStates(bool isCompute);
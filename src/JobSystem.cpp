@@ -0,0 +1,140 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "JobSystemPlatform.h"
+
+namespace
+{
+	thread_local const JobSystem* currentSystem = nullptr;  // the instance the calling thread works for, if any
+	thread_local size_t currentWorker = SIZE_MAX;
+}
+
+JobSystem::JobSystem(size_t a_workerCount)
+{
+	auto workerCount = a_workerCount ? a_workerCount : static_cast<size_t>(std::max(static_cast<int32_t>(std::thread::hardware_concurrency()) - 1, 1));
+	for (size_t i = 0; i < workerCount; i++)
+		workers.push_back(std::make_unique<Worker>());
+	for (size_t i = 0; i < workerCount; i++)
+		threads.emplace_back([this, i](std::stop_token a_stoken) { Run(a_stoken, i); });
+	logger::debug("JobSystem initialized with {} workers", workerCount);
+}
+
+JobSystem::~JobSystem()
+{
+	for (auto& thread : threads)
+		thread.request_stop();
+	sleepCondition.notify_all();
+	threads.clear();  // joins before the queues and condition variable go away
+}
+
+void JobSystem::Submit(Job a_job, JobPriority a_priority)
+{
+	// workers keep their own jobs local, everyone else spreads them over the workers
+	auto index = currentSystem == this ? currentWorker : nextWorker++ % workers.size();
+	{
+		auto& worker = *workers[index];
+		std::scoped_lock lock(worker.mutex);
+		worker.queues[static_cast<size_t>(a_priority)].push_back(std::move(a_job));
+	}
+	{
+		std::scoped_lock lock(sleepMutex);
+		pendingJobs++;
+	}
+	sleepCondition.notify_one();
+}
+
+void JobSystem::ParallelFor(size_t a_count, const std::function<void(size_t)>& a_func, JobPriority a_priority)
+{
+	if (!a_count)
+		return;
+
+	// helpers that only start after every index was claimed return without touching a_func
+	struct Range
+	{
+		std::atomic<size_t> next = 0;
+		std::atomic<size_t> done = 0;
+	};
+	auto range = std::make_shared<Range>();
+	auto runRange = [range, &a_func, a_count]() {
+		for (size_t index; (index = range->next++) < a_count;) {
+			try {
+				a_func(index);
+			} catch (const std::exception& ex) {
+				logger::error("Parallel job {} failed: {}", index, ex.what());
+			}
+			if (++range->done == a_count)
+				range->done.notify_all();
+		}
+	};
+
+	auto helpers = std::min(a_count - 1, workers.size());
+	for (size_t i = 0; i < helpers; i++)
+		Submit(runRange, a_priority);
+	runRange();
+
+	// every index is claimed by now, sleep until the helpers still running theirs are done
+	for (size_t done; (done = range->done) < a_count;)
+		range->done.wait(done);
+}
+
+bool JobSystem::TryTake(size_t a_workerIndex, Job& a_job, JobPriority& a_priority)
+{
+	for (size_t priority = 0; priority < static_cast<size_t>(JobPriority::Count); priority++) {
+		a_priority = static_cast<JobPriority>(priority);
+		{
+			auto& own = *workers[a_workerIndex];
+			std::scoped_lock lock(own.mutex);
+			auto& queue = own.queues[priority];
+			if (!queue.empty()) {
+				a_job = std::move(queue.back());
+				queue.pop_back();
+				pendingJobs--;
+				return true;
+			}
+		}
+		for (size_t offset = 1; offset < workers.size(); offset++) {
+			auto& victim = *workers[(a_workerIndex + offset) % workers.size()];
+			std::scoped_lock lock(victim.mutex);
+			auto& queue = victim.queues[priority];
+			if (!queue.empty()) {
+				a_job = std::move(queue.front());
+				queue.pop_front();
+				pendingJobs--;
+				stolenJobs++;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void JobSystem::Run(std::stop_token a_stoken, size_t a_workerIndex)
+{
+	currentSystem = this;
+	currentWorker = a_workerIndex;
+	bool background = false;
+	while (!a_stoken.stop_requested()) {
+		Job job;
+		JobPriority priority;
+		if (!TryTake(a_workerIndex, job, priority)) {
+			std::unique_lock lock(sleepMutex);
+			sleepCondition.wait(lock, a_stoken, [this]() { return pendingJobs > 0; });
+			continue;
+		}
+
+		// compiles run below normal priority so they do not compete with the game's own threads
+		if (background != (priority == JobPriority::Background)) {
+			background = priority == JobPriority::Background;
+			JobSystemPlatform::SetBackgroundPriority(background);
+		}
+
+		try {
+			job();
+		} catch (const std::exception& ex) {
+			logger::error("Job failed: {}", ex.what());
+		}
+		executedJobs++;
+	}
+}
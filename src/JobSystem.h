@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+enum class JobPriority
+{
+	FrameCritical,  // per-frame feature work the render thread is waiting on
+	Normal,
+	Background,  // shader compilation
+	Count
+};
+
+// Single executor for shader compilation and per-frame feature work.
+// Every worker owns a deque per priority and steals from the others when its own are empty. Higher priorities are always
+// taken first, so a worker finishing a background compile picks up waiting frame-critical jobs before its next compile.
+// Platform calls go through JobSystemPlatform.h, so it also builds and runs outside the game.
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	static JobSystem* GetSingleton()
+	{
+		static JobSystem singleton;
+		return &singleton;
+	}
+
+	// a_workerCount of 0 leaves one hardware thread to the caller, tests and benchmarks run their own instances
+	explicit JobSystem(size_t a_workerCount = 0);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void Submit(Job a_job, JobPriority a_priority = JobPriority::Normal);
+
+	// Runs a_func for every index and returns once all are done, the calling thread works on the range as well
+	void ParallelFor(size_t a_count, const std::function<void(size_t)>& a_func, JobPriority a_priority = JobPriority::FrameCritical);
+
+	template <class It, class Func>
+	void ForEach(It a_begin, It a_end, Func&& a_func, JobPriority a_priority = JobPriority::FrameCritical)
+	{
+		ParallelFor(
+			static_cast<size_t>(std::distance(a_begin, a_end)), [&](size_t a_index) { a_func(*std::next(a_begin, a_index)); }, a_priority);
+	}
+
+	size_t GetWorkerCount() const { return workers.size(); }
+	uint64_t GetExecutedJobs() const { return executedJobs; }
+	uint64_t GetStolenJobs() const { return stolenJobs; }
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::array<std::deque<Job>, static_cast<size_t>(JobPriority::Count)> queues;
+	};
+
+	bool TryTake(size_t a_workerIndex, Job& a_job, JobPriority& a_priority);
+	void Run(std::stop_token a_stoken, size_t a_workerIndex);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::jthread> threads;
+	std::atomic<size_t> nextWorker = 0;  // round robin for jobs submitted from outside the pool
+	std::atomic<size_t> pendingJobs = 0;
+	std::atomic<uint64_t> executedJobs = 0;
+	std::atomic<uint64_t> stolenJobs = 0;
+	std::mutex sleepMutex;
+	std::condition_variable_any sleepCondition;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+// The platform calls JobSystem makes. The plugin sets Win32 thread priorities and logs through SKSE from the PCH, a standalone build
+// (tests/ defines JOBSYSTEM_STANDALONE) leaves thread priorities alone and prints errors to stderr.
+#ifdef JOBSYSTEM_STANDALONE
+#	include <cstdio>
+#	include <sstream>
+#	include <string_view>
+#	include <utility>
+
+namespace logger
+{
+	namespace detail
+	{
+		inline void Format(std::ostringstream& a_out, std::string_view a_fmt)
+		{
+			a_out << a_fmt;
+		}
+
+		template <class Arg, class... Args>
+		void Format(std::ostringstream& a_out, std::string_view a_fmt, Arg&& a_arg, Args&&... a_args)
+		{
+			auto field = a_fmt.find("{}");
+			if (field == std::string_view::npos) {
+				a_out << a_fmt;
+				return;
+			}
+			a_out << a_fmt.substr(0, field) << a_arg;
+			Format(a_out, a_fmt.substr(field + 2), std::forward<Args>(a_args)...);
+		}
+	}
+
+	template <class... Args>
+	void debug(std::string_view, Args&&...)
+	{}
+
+	template <class... Args>
+	void error(std::string_view a_fmt, Args&&... a_args)
+	{
+		std::ostringstream out;
+		detail::Format(out, a_fmt, std::forward<Args>(a_args)...);
+		std::fprintf(stderr, "%s\n", out.str().c_str());
+	}
+}
+#endif
+
+namespace JobSystemPlatform
+{
+	inline void SetBackgroundPriority([[maybe_unused]] bool a_background)
+	{
+#ifndef JOBSYSTEM_STANDALONE
+		SetThreadPriority(GetCurrentThread(), a_background ? THREAD_PRIORITY_BELOW_NORMAL : THREAD_PRIORITY_NORMAL);
+#endif
+	}
+}
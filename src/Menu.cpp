@@ -5,6 +5,8 @@
 #include <imgui_stdlib.h>
 #include <magic_enum.hpp>
 
+#include "FrameArena.h"
+#include "JobSystem.h"
 #include "ShaderCache.h"
 #include "State.h"
 
@@ -233,7 +235,7 @@ RE::BSEventNotifyControl Menu::ProcessEvent(RE::InputEvent* const* a_event, RE::
 						IsEnabled = !IsEnabled;
 					} else if (key == skipCompilationKey) {
 						auto& shaderCache = SIE::ShaderCache::Instance();
-						shaderCache.backgroundCompilation = true;
+						shaderCache.ContinueInBackground();
 					} else if (key == effectToggleKey) {
 						auto& shaderCache = SIE::ShaderCache::Instance();
 						shaderCache.SetEnabled(!shaderCache.IsEnabled());
@@ -423,6 +425,19 @@ void Menu::DrawSettings()
 					ImGui::EndTooltip();
 				}
 
+				bool useTieredCompilation = shaderCache.IsTieredCompilation();
+				ImGui::TableNextColumn();
+				if (ImGui::Checkbox("Enable Tiered Compilation", &useTieredCompilation)) {
+					shaderCache.SetTieredCompilation(useTieredCompilation);
+				}
+				if (ImGui::IsItemHovered()) {
+					ImGui::BeginTooltip();
+					ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+					ImGui::Text("Compiles shaders without optimizations first so they show up sooner, then replaces them with fully optimized versions in the background. Only optimized shaders are saved to the disk cache.");
+					ImGui::PopTextWrapPos();
+					ImGui::EndTooltip();
+				}
+
 				ImGui::EndTable();
 			}
 		}
@@ -580,8 +595,60 @@ void Menu::DrawSettings()
 			if (ImGui::Button("Dump Ini Settings", { -1, 0 })) {
 				Util::DumpSettingsOptions();
 			}
+			if (ImGui::Button("Analyze Permutations", { -1, 0 })) {
+				shaderCache.WritePermutationReport();
+			}
+			if (ImGui::IsItemHovered()) {
+				ImGui::BeginTooltip();
+				ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+				ImGui::Text(
+					"Estimates how many permutations, how much compile time and how much bytecode would remain if further descriptor flags were handled as runtime branches. "
+					"Needs the disk cache or shader dumping enabled at startup so the loaded descriptors are recorded. "
+					"Writes %sPermutations.csv next to the log.",
+					Plugin::NAME.data());
+				ImGui::PopTextWrapPos();
+				ImGui::EndTooltip();
+			}
 			if (ImGui::TreeNodeEx("Statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
 				ImGui::Text(std::format("Shader Compiler : {}", shaderCache.GetShaderStatsString()).c_str());
+				auto jobSystem = JobSystem::GetSingleton();
+				ImGui::Text(std::format("Job System : {} workers, {} jobs run, {} stolen", jobSystem->GetWorkerCount(), jobSystem->GetExecutedJobs(), jobSystem->GetStolenJobs()).c_str());
+				auto frameArena = FrameArena::GetSingleton();
+				ImGui::Text(std::format("Frame Arena : {} allocations, {:.1f}/{} KB last frame", frameArena->GetFrameAllocations(), frameArena->GetFrameBytes() / 1024.0, frameArena->GetCapacity() / 1024).c_str());
+				ImGui::TreePop();
+			}
+			if (ImGui::TreeNodeEx("Compile Telemetry")) {
+				auto summary = shaderCache.GetTelemetrySummary();
+				if (summary.empty()) {
+					ImGui::TextDisabled("No shaders have been compiled yet.");
+				} else if (ImGui::BeginTable("##CompileTelemetry", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+					ImGui::TableSetupColumn("Type");
+					ImGui::TableSetupColumn("Technique");
+					ImGui::TableSetupColumn("Permutations");
+					ImGui::TableSetupColumn("Compiled");
+					ImGui::TableSetupColumn("Failed");
+					ImGui::TableSetupColumn("Total/Max Time");
+					ImGui::TableSetupColumn("Avg Instructions");
+					ImGui::TableHeadersRow();
+					for (auto& entry : summary) {
+						ImGui::TableNextColumn();
+						ImGui::TextUnformatted(entry.type.c_str());
+						ImGui::TableNextColumn();
+						ImGui::TextUnformatted(entry.technique.c_str());
+						ImGui::TableNextColumn();
+						ImGui::Text("%u", entry.permutations);
+						ImGui::TableNextColumn();
+						ImGui::Text("%u", entry.compiled);
+						ImGui::TableNextColumn();
+						ImGui::Text("%u", entry.failed);
+						ImGui::TableNextColumn();
+						ImGui::Text("%.1f s / %.0f ms", entry.totalMs / 1000.0, entry.maxMs);
+						ImGui::TableNextColumn();
+						ImGui::Text("%.0f", entry.averageInstructions);
+					}
+					ImGui::EndTable();
+					ImGui::TextDisabled("Per permutation data is written to %sCompile.csv next to the log once compilation finishes.", Plugin::NAME.data());
+				}
 				ImGui::TreePop();
 			}
 		}
@@ -670,11 +737,6 @@ void Menu::DrawOverlay()
 
 	auto failed = shaderCache.GetFailedTasks();
 	auto hide = shaderCache.IsHideErrors();
-	auto progressTitle = fmt::format("{}Compiling Shaders: {}",
-		shaderCache.backgroundCompilation ? "Background " : "",
-		shaderCache.GetShaderStatsString(!state->IsDeveloperMode()).c_str());
-	auto percent = (float)compiledShaders / (float)totalShaders;
-	auto progressOverlay = fmt::format("{}/{} ({:2.1f}%)", compiledShaders, totalShaders, 100 * percent);
 	if (shaderCache.IsCompiling()) {
 		ImGui::SetNextWindowBgAlpha(1);
 		ImGui::SetNextWindowPos(ImVec2(10, 10));
@@ -682,10 +744,19 @@ void Menu::DrawOverlay()
 			ImGui::End();
 			return;
 		}
+		// only formatted while shown, into the frame arena
+		FrameString progressTitle;
+		fmt::format_to(std::back_inserter(progressTitle), "{}Compiling Shaders: {}",
+			shaderCache.backgroundCompilation ? "Background " : "",
+			shaderCache.GetShaderStatsString(!state->IsDeveloperMode()));
+		auto percent = (float)compiledShaders / (float)totalShaders;
+		FrameString progressOverlay;
+		fmt::format_to(std::back_inserter(progressOverlay), "{}/{} ({:2.1f}%)", compiledShaders, totalShaders, 100 * percent);
 		ImGui::TextUnformatted(progressTitle.c_str());
 		ImGui::ProgressBar(percent, ImVec2(0.0f, 0.0f), progressOverlay.c_str());
 		if (!shaderCache.backgroundCompilation && shaderCache.menuLoaded) {
-			auto skipShadersText = fmt::format(
+			FrameString skipShadersText;
+			fmt::format_to(std::back_inserter(skipShadersText),
 				"Press {} to proceed without completing shader compilation. "
 				"WARNING: Uncompiled shaders will have visual errors or cause stuttering when loading.",
 				KeyIdToString(skipCompilationKey));
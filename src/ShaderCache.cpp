@@ -5,11 +5,27 @@
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <fmt/std.h>
+#include <rapidcsv.h>
 #include <wrl/client.h>
 
 #include "Feature.h"
+#include "JobSystem.h"
+#include "ShaderTools/PermutationAnalyzer.h"
 #include "State.h"
 
+// descriptor flags go up to 1 << 23, far outside magic_enum's default range
+template <>
+struct magic_enum::customize::enum_range<SIE::ShaderCache::LightingShaderFlags>
+{
+	static constexpr bool is_flags = true;
+};
+
+template <>
+struct magic_enum::customize::enum_range<SIE::ShaderCache::WaterShaderFlags>
+{
+	static constexpr bool is_flags = true;
+};
+
 namespace SIE
 {
 	namespace SShaderCache
@@ -947,24 +963,105 @@ namespace SIE
 			return result;
 		}
 
-		static ID3DBlob* CompileShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, bool useDiskCache)
+		template <class T>
+		static std::string GetTechniqueName(uint32_t technique)
+		{
+			auto name = magic_enum::enum_name(static_cast<T>(technique));
+			return name.empty() ? std::to_string(technique) : std::string(name);
+		}
+
+		static std::string GetTechniqueName(RE::BSShader::Type type, uint32_t descriptor)
+		{
+			switch (type) {
+			case RE::BSShader::Type::Lighting:
+				return GetTechniqueName<ShaderCache::LightingShaderTechniques>(GetTechnique(descriptor));
+			case RE::BSShader::Type::BloodSplatter:
+				return GetTechniqueName<BloodSplatterShaderTechniques>(descriptor);
+			case RE::BSShader::Type::DistantTree:
+				return GetTechniqueName<DistantTreeShaderTechniques>(descriptor & 1);
+			case RE::BSShader::Type::Sky:
+				return GetTechniqueName<SkyShaderTechniques>(descriptor);
+			case RE::BSShader::Type::Grass:
+				return GetTechniqueName<GrassShaderTechniques>(descriptor & 0b1111);
+			case RE::BSShader::Type::Particle:
+				return GetTechniqueName<ParticleShaderTechniques>(descriptor);
+			case RE::BSShader::Type::Water:
+				return GetTechniqueName<ShaderCache::WaterShaderTechniques>((descriptor >> 11) & 0xF);
+			}
+			return std::to_string(descriptor);
+		}
+
+		static CompilationCostModel::Key GetCostKey(ShaderClass shaderClass, RE::BSShader::Type type, CompilationTier tier, const std::string& technique, const std::string& defines)
+		{
+			return { std::string(magic_enum::enum_name(type)), std::string(magic_enum::enum_name(shaderClass)), technique, defines, std::string(magic_enum::enum_name(tier)) };
+		}
+
+		template <class T>
+		static std::vector<PermutationAnalyzer::Flag> GetDescriptorFlags()
+		{
+			std::vector<PermutationAnalyzer::Flag> flags;
+			for (auto& [value, name] : magic_enum::enum_entries<T>())
+				flags.push_back({ std::string(name), static_cast<uint32_t>(value) });
+			return flags;
+		}
+
+		static uint32_t GetInstructionCount(ID3DBlob& shaderData)
+		{
+			Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflector;
+			D3D11_SHADER_DESC desc{};
+			if (FAILED(D3DReflect(shaderData.GetBufferPointer(), shaderData.GetBufferSize(), IID_PPV_ARGS(&reflector))) ||
+				FAILED(reflector->GetDesc(&desc)))
+				return 0;
+			return desc.InstructionCount;
+		}
+
+		static void RecordTelemetry(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, CompilationTier tier,
+			CompilationTelemetry::Source source, ID3DBlob* shaderBlob, uint32_t instructionCount, high_resolution_clock::time_point startTime)
+		{
+			CompilationTelemetry telemetry;
+			telemetry.shaderClass = shaderClass;
+			telemetry.type = shader.shaderType.get();
+			telemetry.descriptor = descriptor;
+			telemetry.tier = tier;
+			telemetry.technique = GetTechniqueName(telemetry.type, descriptor);
+			std::array<D3D_SHADER_MACRO, 64> defines{};
+			GetShaderDefines(telemetry.type, descriptor, &defines[0]);
+			telemetry.defines = MergeDefinesString(defines, true);
+			telemetry.source = source;
+			telemetry.failed = shaderBlob == nullptr;
+			telemetry.bytecodeSize = shaderBlob ? shaderBlob->GetBufferSize() : 0;
+			telemetry.instructionCount = instructionCount;
+			telemetry.wallMs = duration<double, std::milli>(high_resolution_clock::now() - startTime).count();
+			if (source == CompilationTelemetry::Source::Compile && shaderBlob)
+				ShaderCache::Instance().RecordCompileCost(telemetry);
+			// a memory hit must not hide what the permutation originally cost
+			ShaderCache::Instance().AddTelemetry(ShaderCompilationTask(shaderClass, shader, descriptor, tier).GetId(), std::move(telemetry),
+				source != CompilationTelemetry::Source::Memory);
+		}
+
+		static ID3DBlob* CompileShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, bool useDiskCache, CompilationTier tier = CompilationTier::Optimized)
 		{
 			ID3DBlob* shaderBlob = nullptr;
+			const auto startTime = high_resolution_clock::now();
 
-			// check hashmap
+			// check hashmap, a fast tier blob only satisfies another fast tier request
 			auto& cache = ShaderCache::Instance();
-			if (shaderBlob = cache.GetCompletedShader(shaderClass, shader, descriptor); shaderBlob) {
+			auto key = SShaderCache::GetShaderString(shaderClass, shader, descriptor, true);
+			if (shaderBlob = cache.GetCompletedShader(key); shaderBlob && (tier == CompilationTier::Fast || !cache.IsFastTierShader(key))) {
 				// already compiled before
 				logger::debug("Shader already compiled; using cache: {}", SShaderCache::GetShaderString(shaderClass, shader, descriptor));
 				cache.IncCacheHitTasks();
+				RecordTelemetry(shaderClass, shader, descriptor, tier, CompilationTelemetry::Source::Memory, shaderBlob, GetInstructionCount(*shaderBlob), startTime);
 				return shaderBlob;
 			}
 			const auto type = shader.shaderType.get();
 
-			// check diskcache
+			shaderBlob = nullptr;
+
+			// check diskcache, which only ever holds optimized shaders
 			auto diskPath = GetDiskPath(shader.fxpFilename, descriptor, shaderClass);
 
-			if (!shaderBlob && useDiskCache && std::filesystem::exists(diskPath)) {
+			if (useDiskCache && std::filesystem::exists(diskPath)) {
 				shaderBlob = nullptr;
 				if (FAILED(D3DReadFileToBlob(diskPath.c_str(), &shaderBlob))) {
 					logger::error("Failed to load {} shader {}::{}", magic_enum::enum_name(shaderClass), magic_enum::enum_name(type), descriptor);
@@ -979,6 +1076,7 @@ namespace SIE
 					});
 					logger::debug("Loaded shader from {}", str);
 					cache.AddCompletedShader(shaderClass, shader, descriptor, shaderBlob);
+					RecordTelemetry(shaderClass, shader, descriptor, tier, CompilationTelemetry::Source::Disk, shaderBlob, GetInstructionCount(*shaderBlob), startTime);
 					return shaderBlob;
 				}
 			}
@@ -1010,7 +1108,7 @@ namespace SIE
 			// compile shaders
 			const std::wstring path = GetShaderPath(shader.fxpFilename);
 			ID3DBlob* errorBlob = nullptr;
-			const uint32_t flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+			const uint32_t flags = tier == CompilationTier::Fast ? D3DCOMPILE_SKIP_OPTIMIZATION : D3DCOMPILE_OPTIMIZATION_LEVEL3;
 			const HRESULT compileResult = D3DCompileFromFile(path.c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, "main",
 				GetShaderProfile(shaderClass), flags, 0, &shaderBlob, &errorBlob);
 
@@ -1028,10 +1126,16 @@ namespace SIE
 					shaderBlob->Release();
 				}
 
-				cache.AddCompletedShader(shaderClass, shader, descriptor, nullptr);
+				// a failed tier-up keeps the working fast tier shader
+				if (tier == CompilationTier::Fast || !cache.GetCompletedShader(shaderClass, shader, descriptor))
+					cache.AddCompletedShader(shaderClass, shader, descriptor, nullptr);
+				RecordTelemetry(shaderClass, shader, descriptor, tier, CompilationTelemetry::Source::Compile, nullptr, 0, startTime);
 				return nullptr;
 			}
-			logger::debug("Compiled shader {}:{}:{:X}", magic_enum::enum_name(type), magic_enum::enum_name(shaderClass), descriptor);
+			logger::debug("Compiled {} tier shader {}:{}:{:X}", magic_enum::enum_name(tier), magic_enum::enum_name(type), magic_enum::enum_name(shaderClass), descriptor);
+
+			// reflection statistics are gone once stripped
+			const auto instructionCount = GetInstructionCount(*shaderBlob);
 
 			// strip debug info
 			ID3DBlob* strippedShaderBlob = nullptr;
@@ -1045,8 +1149,8 @@ namespace SIE
 			std::swap(shaderBlob, strippedShaderBlob);
 			strippedShaderBlob->Release();
 
-			// save shader to disk
-			if (useDiskCache) {
+			// save shader to disk, fast tier shaders are never persisted so the disk cache only holds final shaders
+			if (useDiskCache && tier == CompilationTier::Optimized) {
 				auto directoryPath = std::format("Data/ShaderCache/{}", shader.fxpFilename);
 				if (!std::filesystem::is_directory(directoryPath)) {
 					try {
@@ -1071,7 +1175,8 @@ namespace SIE
 					logger::debug("Saved shader to {}", str);
 				}
 			}
-			cache.AddCompletedShader(shaderClass, shader, descriptor, shaderBlob);
+			cache.AddCompletedShader(shaderClass, shader, descriptor, shaderBlob, tier);
+			RecordTelemetry(shaderClass, shader, descriptor, tier, CompilationTelemetry::Source::Compile, shaderBlob, instructionCount, startTime);
 			return shaderBlob;
 		}
 
@@ -1213,7 +1318,7 @@ namespace SIE
 		}
 
 		if (IsAsync()) {
-			compilationSet.Add({ ShaderClass::Vertex, shader, descriptor });
+			compilationSet.Add({ ShaderClass::Vertex, shader, descriptor, isTieredCompilation ? CompilationTier::Fast : CompilationTier::Optimized });
 		} else {
 			return MakeAndAddVertexShader(shader, descriptor);
 		}
@@ -1240,7 +1345,7 @@ namespace SIE
 		}
 
 		if (IsAsync()) {
-			compilationSet.Add({ ShaderClass::Pixel, shader, descriptor });
+			compilationSet.Add({ ShaderClass::Pixel, shader, descriptor, isTieredCompilation ? CompilationTier::Fast : CompilationTier::Optimized });
 		} else {
 			return MakeAndAddPixelShader(shader, descriptor);
 		}
@@ -1267,22 +1372,485 @@ namespace SIE
 			}
 			shaders.clear();
 		}
+		for (auto& retired : retiredVertexShaders)
+			retired.shader->shader->Release();
+		retiredVertexShaders.clear();
+		for (auto& retired : retiredPixelShaders)
+			retired.shader->shader->Release();
+		retiredPixelShaders.clear();
 
 		compilationSet.Clear();
 		std::unique_lock lock{ mapMutex };
 		shaderMap.clear();
+		fastTierShaders.clear();
+		lock.unlock();
+
+		std::scoped_lock telemetryLock{ telemetryMutex };
+		telemetry.clear();
+	}
+
+	void ShaderCache::ReleaseRetiredShaders()
+	{
+		auto frame = ++presentCount;
+		auto release = [frame](auto& a_retired) {
+			std::erase_if(a_retired, [frame](auto& retired) {
+				if (frame - retired.frame < RetiredShaderFrames)
+					return false;
+				retired.shader->shader->Release();
+				return true;
+			});
+		};
+
+		{
+			std::lock_guard lockGuard(vertexShadersMutex);
+			release(retiredVertexShaders);
+		}
+		{
+			std::lock_guard lockGuard(pixelShadersMutex);
+			release(retiredPixelShaders);
+		}
+	}
+
+	void ShaderCache::InvalidateShaders(const std::unordered_set<std::string>& a_shaders, const std::vector<ComputeShaderDesc>& a_computeShaders)
+	{
+		if (!a_shaders.empty()) {
+			// a_shaders holds lowercase shader file names, which is what every shaderMap key starts with
+			auto isAffected = [&](const std::string& a_key) {
+				auto name = a_key.substr(0, a_key.find(':'));
+				std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+				return a_shaders.contains(name);
+			};
+			{
+				std::unique_lock lock{ mapMutex };
+				std::erase_if(shaderMap, [&](const auto& item) { return isAffected(item.first); });
+				std::erase_if(fastTierShaders, isAffected);
+			}
+
+			if (isDiskCache) {
+				for (auto& name : a_shaders) {
+					try {
+						std::filesystem::remove_all(std::format("Data/ShaderCache/{}", name));
+					} catch (std::filesystem::filesystem_error const& ex) {
+						logger::error("Failed to delete disk cache for {}: {}", name, ex.what());
+					}
+				}
+			}
+
+			// the current shaders stay bound until their replacements are compiled
+			if (IsAsync()) {
+				auto requeued = compilationSet.Requeue(a_shaders, isTieredCompilation ? CompilationTier::Fast : CompilationTier::Optimized);
+				logger::info("Hot reloading {} shader permutations", requeued);
+			} else {
+				logger::warn("Hot reload needs async compilation, use Clear Shader Cache to pick up the changes");
+			}
+		}
+
+		if (!a_computeShaders.empty()) {
+			{
+				std::unique_lock lock{ mapMutex };
+				for (auto& desc : a_computeShaders)
+					shaderMap.erase(desc.GetKey());
+			}
+
+			if (isDiskCache) {
+				for (auto& desc : a_computeShaders) {
+					std::error_code ec;
+					if (!std::filesystem::remove(GetComputeShaderDiskPath(desc), ec) && ec)
+						logger::error("Failed to delete disk cache for {}: {}", desc.GetKey(), ec.message());
+				}
+			}
+
+			// compute shaders are small and few, so they are rebuilt here and features pick them up from the cache
+			logger::info("Hot reloading {} compute shaders", a_computeShaders.size());
+			CompileComputeShaders(a_computeShaders);
+			computeShadersReloaded = true;
+		}
+	}
+
+	void ShaderCache::AddTelemetry(size_t a_taskId, CompilationTelemetry a_telemetry, bool a_overwrite)
+	{
+		std::scoped_lock lock{ telemetryMutex };
+		if (a_overwrite)
+			telemetry.insert_or_assign(a_taskId, std::move(a_telemetry));
+		else
+			telemetry.try_emplace(a_taskId, std::move(a_telemetry));
+	}
+
+	void ShaderCache::SetTelemetryQueueTime(size_t a_taskId, double a_queueMs)
+	{
+		std::scoped_lock lock{ telemetryMutex };
+		if (auto it = telemetry.find(a_taskId); it != telemetry.end())
+			it->second.queueMs = a_queueMs;
+	}
+
+	void ShaderCache::WriteTelemetry()
+	{
+		auto path = logger::log_directory();
+		if (!path)
+			return;
+		*path /= std::format("{}Compile.csv", Plugin::NAME);
+
+		rapidcsv::Document document("", rapidcsv::LabelParams(0, -1));
+		const std::array columns = { "Class", "Type", "Technique", "Descriptor", "Tier", "Source", "Failed",
+			"Wall ms", "Queue ms", "Bytecode Size", "Instructions", "Defines" };
+		for (size_t i = 0; i < columns.size(); i++)
+			document.SetColumnName(i, columns[i]);
+
+		{
+			std::scoped_lock lock{ telemetryMutex };
+			size_t row = 0;
+			for (auto& [id, entry] : telemetry) {
+				document.SetCell<std::string>(0, row, std::string(magic_enum::enum_name(entry.shaderClass)));
+				document.SetCell<std::string>(1, row, std::string(magic_enum::enum_name(entry.type)));
+				document.SetCell<std::string>(2, row, entry.technique);
+				document.SetCell<std::string>(3, row, std::format("{:X}", entry.descriptor));
+				document.SetCell<std::string>(4, row, std::string(magic_enum::enum_name(entry.tier)));
+				document.SetCell<std::string>(5, row, std::string(magic_enum::enum_name(entry.source)));
+				document.SetCell<int>(6, row, entry.failed);
+				document.SetCell<double>(7, row, entry.wallMs);
+				document.SetCell<double>(8, row, entry.queueMs);
+				document.SetCell<size_t>(9, row, entry.bytecodeSize);
+				document.SetCell<uint32_t>(10, row, entry.instructionCount);
+				document.SetCell<std::string>(11, row, entry.defines);
+				row++;
+			}
+		}
+
+		rapidcsv::Document manifest("", rapidcsv::LabelParams(0, -1));
+		manifest.SetColumnName(0, "Type");
+		manifest.SetColumnName(1, "Class");
+		manifest.SetColumnName(2, "Descriptor");
+		manifest.SetColumnName(3, "Lookup");
+		{
+			std::scoped_lock lock{ telemetryMutex };
+			size_t row = 0;
+			for (auto& [type, shaderClass, descriptor, lookup] : descriptorManifest) {
+				manifest.SetCell<std::string>(0, row, std::string(magic_enum::enum_name(type)));
+				manifest.SetCell<std::string>(1, row, std::string(magic_enum::enum_name(shaderClass)));
+				manifest.SetCell<std::string>(2, row, std::format("{:X}", descriptor));
+				manifest.SetCell<std::string>(3, row, std::format("{:X}", lookup));
+				row++;
+			}
+		}
+
+		auto manifestPath = path->parent_path() / std::format("{}Descriptors.csv", Plugin::NAME);
+		std::scoped_lock fileLock{ telemetryFileMutex };
+		try {
+			document.Save(path->string());
+			manifest.Save(manifestPath.string());
+			logger::info("Saved compile telemetry to {}", path->string());
+		} catch (const std::exception& ex) {
+			logger::error("Failed to save compile telemetry: {}", ex.what());
+		}
+	}
+
+	void ShaderCache::StartCompileSession()
+	{
+		isSessionWritten = false;
 	}
 
-	bool ShaderCache::AddCompletedShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, ID3DBlob* a_blob)
+	void ShaderCache::FinishCompileSession()
+	{
+		// every compile thread can see the queue drain, WaitTake clears the flag when the next session starts
+		if (isSessionWritten.exchange(true))
+			return;
+		WriteTelemetry();
+		SaveCostModel();
+	}
+
+	void ShaderCache::RecordDescriptor(const RE::BSShader& a_shader, ShaderClass a_shaderClass, uint32_t a_descriptor, uint32_t a_lookup)
+	{
+		std::scoped_lock lock{ telemetryMutex };
+		descriptorManifest.emplace(a_shader.shaderType.get(), a_shaderClass, a_descriptor, a_lookup);
+	}
+
+	void ShaderCache::WritePermutationReport()
+	{
+		WriteTelemetry();
+		auto path = logger::log_directory();
+		if (!path)
+			return;
+
+		try {
+			auto manifest = PermutationAnalyzer::LoadManifest(*path / std::format("{}Descriptors.csv", Plugin::NAME),
+				*path / std::format("{}Compile.csv", Plugin::NAME));
+			auto candidates = PermutationAnalyzer::Analyze(manifest, "Lighting", SShaderCache::GetDescriptorFlags<LightingShaderFlags>());
+			auto waterCandidates = PermutationAnalyzer::Analyze(manifest, "Water", SShaderCache::GetDescriptorFlags<WaterShaderFlags>());
+			candidates.insert(candidates.end(), waterCandidates.begin(), waterCandidates.end());
+
+			auto reportPath = *path / std::format("{}Permutations.csv", Plugin::NAME);
+			PermutationAnalyzer::WriteReport(candidates, reportPath);
+			logger::info("Saved permutation report to {}", reportPath.string());
+		} catch (const std::exception& ex) {
+			logger::error("Failed to analyze permutations: {}", ex.what());
+		}
+	}
+
+	void ShaderCache::RecordUsage(ShaderClass a_shaderClass, const RE::BSShader& a_shader, uint32_t a_descriptor)
+	{
+		if (!isRecordingUsage.load(std::memory_order_relaxed))
+			return;
+		usageTable.TryInsert(ShaderCompilationTask::GetPermutationId(a_shaderClass, a_shader.shaderType.get(), a_descriptor), TaskStateTable::State::Done);
+	}
+
+	void ShaderCache::FinishUsageRecording()
+	{
+		if (usageRecorder.joinable())
+			return;
+
+		// keep recording for a while after the load so the shaders of the loaded cell are requested as well
+		usageRecorder = std::jthread([this](std::stop_token stoken) {
+			std::mutex mutex;
+			std::condition_variable_any condition;
+			std::unique_lock lock(mutex);
+			condition.wait_for(lock, stoken, 30s, []() { return false; });
+			if (stoken.stop_requested())
+				return;
+			isRecordingUsage = false;
+			WriteUsageProfile();
+		});
+	}
+
+	void ShaderCache::WriteUsageProfile()
+	{
+		rapidcsv::Document document("", rapidcsv::LabelParams(0, -1));
+		document.SetColumnName(0, "Type");
+		document.SetColumnName(1, "Class");
+		document.SetColumnName(2, "Descriptor");
+		size_t row = 0;
+		usageTable.ForEach([&](size_t a_id, TaskStateTable::State) {
+			document.SetCell<std::string>(0, row, std::string(magic_enum::enum_name(static_cast<RE::BSShader::Type>((a_id >> 32) & 0xF))));
+			document.SetCell<std::string>(1, row, std::string(magic_enum::enum_name(static_cast<ShaderClass>((a_id >> 60) & 0x3))));
+			document.SetCell<std::string>(2, row, std::format("{:X}", static_cast<uint32_t>(a_id)));
+			row++;
+		});
+
+		try {
+			document.Save(usageProfilePath);
+			logger::info("Saved shader usage profile with {} permutations", row);
+		} catch (const std::exception& ex) {
+			logger::error("Failed to save shader usage profile: {}", ex.what());
+		}
+	}
+
+	std::unordered_set<size_t> ShaderCache::LoadUsageProfile()
+	{
+		std::unordered_set<size_t> result;
+		if (!std::filesystem::exists(usageProfilePath))
+			return result;
+
+		try {
+			rapidcsv::Document document(usageProfilePath, rapidcsv::LabelParams(0, -1));
+			auto types = document.GetColumn<std::string>("Type");
+			auto classes = document.GetColumn<std::string>("Class");
+			auto descriptors = document.GetColumn<std::string>("Descriptor");
+			for (size_t i = 0; i < types.size(); i++) {
+				auto type = magic_enum::enum_cast<RE::BSShader::Type>(types[i]);
+				auto shaderClass = magic_enum::enum_cast<ShaderClass>(classes[i]);
+				if (type && shaderClass)
+					result.insert(ShaderCompilationTask::GetPermutationId(*shaderClass, *type, (uint32_t)std::stoul(descriptors[i], nullptr, 16)));
+			}
+		} catch (const std::exception& ex) {
+			logger::error("Failed to load shader usage profile: {}", ex.what());
+			result.clear();
+		}
+		return result;
+	}
+
+	void ShaderCache::WaitForReadySet()
+	{
+		if (!IsCompiling())
+			return;
+
+		auto required = LoadUsageProfile();
+		if (required.empty()) {
+			logger::info("No shader usage profile recorded yet, waiting for all shaders");
+		} else {
+			auto queued = compilationSet.Prioritize(required);
+			logger::info("Waiting for the shaders used by the main menu and last loaded game, {} of {} still queued", queued, required.size());
+		}
+
+		compilationSet.WaitForReady(required, [this]() { return backgroundCompilation; });
+
+		// stays on for the rest of the session, so later compiles only get the background thread count
+		if (IsCompiling() && !backgroundCompilation) {
+			backgroundCompilation = true;
+			logger::info("Required shaders ready, compiling the remaining {} in the background", GetTotalTasks() - GetCompletedTasks() - GetFailedTasks());
+		}
+	}
+
+	void ShaderCache::ContinueInBackground()
+	{
+		backgroundCompilation = true;
+		compilationSet.NotifyReady();
+	}
+
+	void ShaderCache::RecordCompileCost(const CompilationTelemetry& a_telemetry)
+	{
+		costModel.Record(SShaderCache::GetCostKey(a_telemetry.shaderClass, a_telemetry.type, a_telemetry.tier, a_telemetry.technique, a_telemetry.defines), a_telemetry.wallMs);
+	}
+
+	double ShaderCache::EstimateCompileMs(const ShaderCompilationTask& a_task)
+	{
+		auto type = a_task.GetShader().shaderType.get();
+		std::array<D3D_SHADER_MACRO, 64> defines{};
+		SShaderCache::GetShaderDefines(type, a_task.GetDescriptor(), &defines[0]);
+		return costModel.Estimate(SShaderCache::GetCostKey(a_task.GetShaderClass(), type, a_task.GetTier(),
+			SShaderCache::GetTechniqueName(type, a_task.GetDescriptor()), SShaderCache::MergeDefinesString(defines, true)));
+	}
+
+	void ShaderCache::SaveCostModel()
+	{
+		std::scoped_lock fileLock{ telemetryFileMutex };
+		try {
+			costModel.Save(costModelPath);
+			logger::info("Saved compile cost model");
+		} catch (const std::exception& ex) {
+			logger::error("Failed to save compile cost model: {}", ex.what());
+		}
+	}
+
+	std::vector<CompilationTelemetrySummary> ShaderCache::GetTelemetrySummary()
+	{
+		std::map<std::pair<std::string, std::string>, CompilationTelemetrySummary> groups;
+		{
+			std::scoped_lock lock{ telemetryMutex };
+			for (auto& [id, entry] : telemetry) {
+				auto type = std::string(magic_enum::enum_name(entry.type));
+				auto& summary = groups[{ type, entry.technique }];
+				summary.type = type;
+				summary.technique = entry.technique;
+				summary.permutations++;
+				if (entry.failed)
+					summary.failed++;
+				if (entry.source == CompilationTelemetry::Source::Compile) {
+					summary.compiled++;
+					summary.totalMs += entry.wallMs;
+					summary.maxMs = std::max(summary.maxMs, entry.wallMs);
+				}
+				summary.averageInstructions += entry.instructionCount;
+			}
+		}
+
+		std::vector<CompilationTelemetrySummary> result;
+		result.reserve(groups.size());
+		for (auto& [key, summary] : groups) {
+			summary.averageInstructions /= summary.permutations;
+			result.push_back(summary);
+		}
+		std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.totalMs > b.totalMs; });
+		return result;
+	}
+
+	void ShaderCache::WatchShaderSources(std::stop_token stoken)
+	{
+		const std::filesystem::path shaderRoot = L"Data/Shaders";
+		HANDLE changeHandle = INVALID_HANDLE_VALUE;
+		std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+
+		// returns the sources that were added, edited or deleted since the last scan
+		auto scanSources = [&]() {
+			std::vector<std::filesystem::path> changed;
+			std::unordered_map<std::string, std::filesystem::file_time_type> currentTimes;
+			std::error_code ec;
+			for (std::filesystem::recursive_directory_iterator it(shaderRoot, ec), end; !ec && it != end; it.increment(ec)) {
+				if (!it->is_regular_file(ec) || !ShaderIncludeGraph::IsShaderSource(it->path()))
+					continue;
+				auto path = it->path().generic_string();
+				auto writeTime = it->last_write_time(ec);
+				if (auto previous = writeTimes.find(path); previous == writeTimes.end() || previous->second != writeTime)
+					changed.push_back(it->path());
+				currentTimes.insert_or_assign(path, writeTime);
+			}
+			for (auto& [path, writeTime] : writeTimes) {
+				if (!currentTimes.contains(path))
+					changed.push_back(path);
+			}
+			writeTimes = std::move(currentTimes);
+			return changed;
+		};
+
+		while (!stoken.stop_requested()) {
+			if (!isEnabled || !State::GetSingleton()->IsDeveloperMode()) {
+				if (changeHandle != INVALID_HANDLE_VALUE) {
+					FindCloseChangeNotification(changeHandle);
+					changeHandle = INVALID_HANDLE_VALUE;
+					logger::info("Stopped watching shader sources");
+				}
+				std::this_thread::sleep_for(1s);
+				continue;
+			}
+
+			if (changeHandle == INVALID_HANDLE_VALUE) {
+				changeHandle = FindFirstChangeNotificationW(shaderRoot.c_str(), TRUE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+				if (changeHandle == INVALID_HANDLE_VALUE) {
+					logger::debug("Unable to watch {} for shader changes", shaderRoot.string());
+					std::this_thread::sleep_for(5s);
+					continue;
+				}
+				includeGraph.Build(shaderRoot);
+				scanSources();
+				logger::info("Watching {} {} shader sources for changes", writeTimes.size(), shaderRoot.string());
+				continue;
+			}
+
+			if (WaitForSingleObject(changeHandle, 250) != WAIT_OBJECT_0)
+				continue;
+			// editors often save in several steps, give them a moment to finish
+			std::this_thread::sleep_for(100ms);
+			FindNextChangeNotification(changeHandle);
+
+			auto changed = scanSources();
+			for (auto& file : changed)
+				includeGraph.Update(file);
+			std::unordered_set<std::string> affected;
+			std::unordered_set<std::string> affectedFiles;
+			for (auto& file : changed) {
+				auto shaders = includeGraph.GetAffectedShaders(file);
+				logger::info("Shader source {} changed, affecting {} shader files", file.string(), shaders.size());
+				affected.merge(shaders);
+				affectedFiles.merge(includeGraph.GetAffectedFiles(file));
+			}
+
+			// feature compute shaders sit below the root and are identified by their path rather than a BSShader
+			std::vector<ComputeShaderDesc> affectedComputeShaders;
+			for (auto* feature : Feature::GetFeatureList()) {
+				if (!feature->loaded)
+					continue;
+				for (auto& desc : feature->GetComputeShaderDescs()) {
+					if (affectedFiles.contains(includeGraph.GetKey(desc.path)))
+						affectedComputeShaders.push_back(desc);
+				}
+			}
+
+			if (!affected.empty() || !affectedComputeShaders.empty())
+				InvalidateShaders(affected, affectedComputeShaders);
+		}
+
+		if (changeHandle != INVALID_HANDLE_VALUE)
+			FindCloseChangeNotification(changeHandle);
+	}
+
+	bool ShaderCache::AddCompletedShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, ID3DBlob* a_blob, CompilationTier a_tier)
 	{
 		auto key = SIE::SShaderCache::GetShaderString(shaderClass, shader, descriptor, true);
 		auto status = a_blob ? ShaderCompilationTask::Status::Completed : ShaderCompilationTask::Status::Failed;
 		std::unique_lock lock{ mapMutex };
 		logger::debug("Adding {} shader to map: {}", magic_enum ::enum_name(status), key);
 		shaderMap.insert_or_assign(key, std::pair(a_blob, status));
+		if (a_blob && a_tier == CompilationTier::Fast)
+			fastTierShaders.insert(key);
+		else
+			fastTierShaders.erase(key);
 		return (bool)a_blob;
 	}
 
+	bool ShaderCache::IsFastTierShader(const std::string& a_key)
+	{
+		std::scoped_lock lock{ mapMutex };
+		return fastTierShaders.contains(a_key);
+	}
+
 	ID3DBlob* ShaderCache::GetCompletedShader(const std::string a_key)
 	{
 		std::scoped_lock lock{ mapMutex };
@@ -1356,6 +1924,16 @@ namespace SIE
 		isDump = value;
 	}
 
+	bool ShaderCache::IsTieredCompilation() const
+	{
+		return isTieredCompilation;
+	}
+
+	void ShaderCache::SetTieredCompilation(bool value)
+	{
+		isTieredCompilation = value;
+	}
+
 	bool ShaderCache::IsDiskCache() const
 	{
 		return isDiskCache;
@@ -1414,63 +1992,228 @@ namespace SIE
 	ShaderCache::ShaderCache()
 	{
 		logger::debug("ShaderCache initialized with {} compiler threads", (int)compilationThreadCount);
-		compilationPool.push_task(&ShaderCache::ManageCompilationSet, this, ssource.get_token());
+		try {
+			costModel.Load(costModelPath);
+		} catch (const std::exception& ex) {
+			logger::error("Failed to load compile cost model, using defaults: {}", ex.what());
+		}
+		compilationDispatcher = std::jthread([this](std::stop_token stoken) { ManageCompilationSet(stoken); });
+		sourceWatcher = std::jthread([this](std::stop_token stoken) { WatchShaderSources(stoken); });
+	}
+
+	std::vector<std::pair<std::string, std::string>> ComputeShaderDesc::GetMacros() const
+	{
+		auto macros = defines;
+		if (REL::Module::IsVR())
+			macros.push_back({ "VR", "" });
+		auto shaderDefines = State::GetSingleton()->GetDefines();
+		macros.insert(macros.end(), shaderDefines->begin(), shaderDefines->end());
+		macros.push_back({ "COMPUTESHADER", "" });
+		macros.push_back({ "WINPC", "" });
+		macros.push_back({ "DX11", "" });
+		return macros;
+	}
+
+	uint32_t ComputeShaderDesc::GetCompileFlags() const
+	{
+		if (State::GetSingleton()->IsDeveloperMode())
+			return D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_DEBUG;
+		return D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_OPTIMIZATION_LEVEL3;
+	}
+
+	std::string ComputeShaderDesc::GetKey() const
+	{
+		std::string result;
+		std::transform(path.begin(), path.end(), std::back_inserter(result), [](wchar_t c) {
+			return (char)c;
+		});
+		result += fmt::format(":{}:{}:{}:{:X}", magic_enum::enum_name(ShaderClass::Compute), program, profile, GetCompileFlags());
+		for (auto& [name, value] : GetMacros())
+			result += fmt::format(":{}={}", name, value);
+		return result;
+	}
+
+	std::wstring ShaderCache::GetComputeShaderDiskPath(const ComputeShaderDesc& a_desc)
+	{
+		return std::format(L"Data/ShaderCache/Compute/{:X}.cso", std::hash<std::string>{}(a_desc.GetKey()));
+	}
+
+	ID3DBlob* ShaderCache::CompileComputeShader(const ComputeShaderDesc& a_desc)
+	{
+		auto key = a_desc.GetKey();
+
+		// check hashmap
+		if (auto shaderBlob = GetCompletedShader(key)) {
+			logger::debug("Shader already compiled; using cache: {}", key);
+			return shaderBlob;
+		}
+
+		// check diskcache
+		auto diskPath = GetComputeShaderDiskPath(a_desc);
+
+		ID3DBlob* shaderBlob = nullptr;
+		if (isDiskCache && std::filesystem::exists(diskPath)) {
+			if (FAILED(D3DReadFileToBlob(diskPath.c_str(), &shaderBlob))) {
+				logger::error("Failed to load compute shader {}", key);
+				if (shaderBlob != nullptr) {
+					shaderBlob->Release();
+					shaderBlob = nullptr;
+				}
+			} else {
+				logger::debug("Loaded shader from disk: {}", key);
+				std::unique_lock lock{ mapMutex };
+				shaderMap.insert_or_assign(key, std::pair(shaderBlob, ShaderCompilationTask::Status::Completed));
+				return shaderBlob;
+			}
+		}
+
+		// prepare preprocessor defines, the same ones the key was built from
+		auto macros = a_desc.GetMacros();
+		std::vector<D3D_SHADER_MACRO> defines;
+		for (auto& [name, value] : macros)
+			defines.push_back({ name.c_str(), value.c_str() });
+		defines.push_back({ nullptr, nullptr });
+
+		// compile shaders
+		ID3DBlob* errorBlob = nullptr;
+		const uint32_t flags = a_desc.GetCompileFlags();
+		const HRESULT compileResult = D3DCompileFromFile(a_desc.path.c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, a_desc.program.c_str(),
+			a_desc.profile.c_str(), flags, 0, &shaderBlob, &errorBlob);
+
+		if (FAILED(compileResult)) {
+			logger::error("Failed to compile compute shader {}: {}", key, errorBlob ? static_cast<char*>(errorBlob->GetBufferPointer()) : "Unknown error");
+			if (errorBlob != nullptr)
+				errorBlob->Release();
+			if (shaderBlob != nullptr)
+				shaderBlob->Release();
+
+			std::unique_lock lock{ mapMutex };
+			shaderMap.insert_or_assign(key, std::pair(nullptr, ShaderCompilationTask::Status::Failed));
+			return nullptr;
+		}
+		logger::debug("Compiled shader {}", key);
+
+		// save shader to disk
+		if (isDiskCache) {
+			if (!std::filesystem::is_directory("Data/ShaderCache/Compute")) {
+				try {
+					std::filesystem::create_directories("Data/ShaderCache/Compute");
+				} catch (std::filesystem::filesystem_error const& ex) {
+					logger::error("Failed to create folder: {}", ex.what());
+				}
+			}
+
+			if (FAILED(D3DWriteBlobToFile(shaderBlob, diskPath.c_str(), true)))
+				logger::error("Failed to save compute shader {}", key);
+			else
+				logger::debug("Saved shader to disk: {}", key);
+		}
+
+		std::unique_lock lock{ mapMutex };
+		shaderMap.insert_or_assign(key, std::pair(shaderBlob, ShaderCompilationTask::Status::Completed));
+		return shaderBlob;
+	}
+
+	void ShaderCache::CompileComputeShaders(const std::vector<ComputeShaderDesc>& a_descs)
+	{
+		auto start = high_resolution_clock::now();
+
+		// D3DCompile is thread safe and every shader is independent, so compile them all at once
+		JobSystem::GetSingleton()->ForEach(
+			a_descs.begin(), a_descs.end(), [&](const ComputeShaderDesc& a_desc) {
+				CompileComputeShader(a_desc);
+			},
+			JobPriority::Normal);
+
+		logger::info("Compiled {} compute shaders in {} ms", a_descs.size(), duration_cast<milliseconds>(high_resolution_clock::now() - start).count());
+	}
+
+	ID3D11ComputeShader* ShaderCache::GetComputeShader(const ComputeShaderDesc& a_desc)
+	{
+		auto shaderBlob = CompileComputeShader(a_desc);
+		if (!shaderBlob)
+			return nullptr;
+
+		auto device = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().forwarder;
+		ID3D11ComputeShader* computeShader = nullptr;
+		DX::ThrowIfFailed(device->CreateComputeShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), nullptr, &computeShader));
+		return computeShader;
 	}
 
 	RE::BSGraphics::VertexShader* ShaderCache::MakeAndAddVertexShader(const RE::BSShader& shader,
-		uint32_t descriptor)
+		uint32_t descriptor, CompilationTier tier)
 	{
 		if (const auto shaderBlob =
-				SShaderCache::CompileShader(ShaderClass::Vertex, shader, descriptor, isDiskCache)) {
+				SShaderCache::CompileShader(ShaderClass::Vertex, shader, descriptor, isDiskCache, tier)) {
 			static const auto device = REL::Relocation<ID3D11Device**>(RE::Offset::D3D11Device);
 
 			auto newShader = SShaderCache::CreateVertexShader(*shaderBlob, shader.shaderType.get(),
 				descriptor);
 
-			std::lock_guard lockGuard(vertexShadersMutex);
-
-			const auto result = (*device)->CreateVertexShader(shaderBlob->GetBufferPointer(),
-				newShader->byteCodeSize, nullptr, &newShader->shader);
-			if (FAILED(result)) {
-				logger::error("Failed to create vertex shader {}::{}",
-					magic_enum::enum_name(shader.shaderType.get()), descriptor);
-				if (newShader->shader != nullptr) {
-					newShader->shader->Release();
+			RE::BSGraphics::VertexShader* result = nullptr;
+			{
+				std::lock_guard lockGuard(vertexShadersMutex);
+
+				const auto createResult = (*device)->CreateVertexShader(shaderBlob->GetBufferPointer(),
+					newShader->byteCodeSize, nullptr, &newShader->shader);
+				if (FAILED(createResult)) {
+					logger::error("Failed to create vertex shader {}::{}",
+						magic_enum::enum_name(shader.shaderType.get()), descriptor);
+					if (newShader->shader != nullptr) {
+						newShader->shader->Release();
+					}
+					return nullptr;
 				}
-			} else {
-				return vertexShaders[static_cast<size_t>(shader.shaderType.get())]
-				    .insert_or_assign(descriptor, std::move(newShader))
-				    .first->second.get();
+
+				auto& typeCache = vertexShaders[static_cast<size_t>(shader.shaderType.get())];
+				if (auto it = typeCache.find(descriptor); it != typeCache.end())
+					retiredVertexShaders.push_back({ std::move(it->second), presentCount });
+				result = typeCache.insert_or_assign(descriptor, std::move(newShader)).first->second.get();
 			}
+
+			if (tier == CompilationTier::Fast && IsFastTierShader(SShaderCache::GetShaderString(ShaderClass::Vertex, shader, descriptor, true)))
+				compilationSet.Add({ ShaderClass::Vertex, shader, descriptor, CompilationTier::Optimized });
+
+			return result;
 		}
 		return nullptr;
 	}
 
 	RE::BSGraphics::PixelShader* ShaderCache::MakeAndAddPixelShader(const RE::BSShader& shader,
-		uint32_t descriptor)
+		uint32_t descriptor, CompilationTier tier)
 	{
 		if (const auto shaderBlob =
-				SShaderCache::CompileShader(ShaderClass::Pixel, shader, descriptor, isDiskCache)) {
+				SShaderCache::CompileShader(ShaderClass::Pixel, shader, descriptor, isDiskCache, tier)) {
 			static const auto device = REL::Relocation<ID3D11Device**>(RE::Offset::D3D11Device);
 
 			auto newShader = SShaderCache::CreatePixelShader(*shaderBlob, shader.shaderType.get(),
 				descriptor);
 
-			std::lock_guard lockGuard(pixelShadersMutex);
-			const auto result = (*device)->CreatePixelShader(shaderBlob->GetBufferPointer(),
-				shaderBlob->GetBufferSize(), nullptr, &newShader->shader);
-			if (FAILED(result)) {
-				logger::error("Failed to create pixel shader {}::{}",
-					magic_enum::enum_name(shader.shaderType.get()),
-					descriptor);
-				if (newShader->shader != nullptr) {
-					newShader->shader->Release();
+			RE::BSGraphics::PixelShader* result = nullptr;
+			{
+				std::lock_guard lockGuard(pixelShadersMutex);
+				const auto createResult = (*device)->CreatePixelShader(shaderBlob->GetBufferPointer(),
+					shaderBlob->GetBufferSize(), nullptr, &newShader->shader);
+				if (FAILED(createResult)) {
+					logger::error("Failed to create pixel shader {}::{}",
+						magic_enum::enum_name(shader.shaderType.get()),
+						descriptor);
+					if (newShader->shader != nullptr) {
+						newShader->shader->Release();
+					}
+					return nullptr;
 				}
-			} else {
-				return pixelShaders[static_cast<size_t>(shader.shaderType.get())]
-				    .insert_or_assign(descriptor, std::move(newShader))
-				    .first->second.get();
+
+				auto& typeCache = pixelShaders[static_cast<size_t>(shader.shaderType.get())];
+				if (auto it = typeCache.find(descriptor); it != typeCache.end())
+					retiredPixelShaders.push_back({ std::move(it->second), presentCount });
+				result = typeCache.insert_or_assign(descriptor, std::move(newShader)).first->second.get();
 			}
+
+			if (tier == CompilationTier::Fast && IsFastTierShader(SShaderCache::GetShaderString(ShaderClass::Pixel, shader, descriptor, true)))
+				compilationSet.Add({ ShaderClass::Pixel, shader, descriptor, CompilationTier::Optimized });
+
+			return result;
 		}
 		return nullptr;
 	}
@@ -1507,6 +2250,13 @@ namespace SIE
 		hideError = !hideError;
 	}
 
+	int32_t ShaderCache::GetCompilationJobLimit() const
+	{
+		// trickle the work so compiles leave at least one JobSystem worker to frame jobs, unless there is only one
+		auto workers = std::max(static_cast<int32_t>(JobSystem::GetSingleton()->GetWorkerCount()) - 1, 1);
+		return std::clamp(!backgroundCompilation ? compilationThreadCount : backgroundCompilationThreadCount, 1, workers);
+	}
+
 	void ShaderCache::ManageCompilationSet(std::stop_token stoken)
 	{
 		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
@@ -1514,37 +2264,58 @@ namespace SIE
 			const auto& task = compilationSet.WaitTake(stoken);
 			if (!task.has_value())
 				break;  // exit because thread told to end
-			compilationPool.push_task(&ShaderCache::ProcessCompilationSet, this, stoken, task.value());
+			JobSystem::GetSingleton()->Submit([this, task = task.value()]() { ProcessCompilationSet(task); }, JobPriority::Background);
 		}
 	}
 
-	void ShaderCache::ProcessCompilationSet(std::stop_token stoken, SIE::ShaderCompilationTask task)
+	void ShaderCache::ProcessCompilationSet(SIE::ShaderCompilationTask task)
 	{
-		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+		auto queueMs = task.GetQueueMs();
 		task.Perform();
+		SetTelemetryQueueTime(task.GetId(), queueMs);
+		{
+			// WaitTake checks the job count under this mutex, a decrement outside it could land between that check and the wait
+			// and the notify in Complete would be lost
+			std::scoped_lock lock{ compilationSet.compilationMutex };
+			compilationJobs--;
+		}
 		compilationSet.Complete(task);
 	}
 
 	ShaderCompilationTask::ShaderCompilationTask(ShaderClass aShaderClass,
 		const RE::BSShader& aShader,
-		uint32_t aDescriptor) :
+		uint32_t aDescriptor, CompilationTier aTier) :
 		shaderClass(aShaderClass),
-		shader(aShader), descriptor(aDescriptor)
+		shader(aShader), descriptor(aDescriptor), tier(aTier)
 	{}
 
 	void ShaderCompilationTask::Perform() const
 	{
 		if (shaderClass == ShaderClass::Vertex) {
-			ShaderCache::Instance().MakeAndAddVertexShader(shader, descriptor);
+			ShaderCache::Instance().MakeAndAddVertexShader(shader, descriptor, tier);
 		} else if (shaderClass == ShaderClass::Pixel) {
-			ShaderCache::Instance().MakeAndAddPixelShader(shader, descriptor);
+			ShaderCache::Instance().MakeAndAddPixelShader(shader, descriptor, tier);
 		}
 	}
 
+	size_t ShaderCompilationTask::GetPermutationId(ShaderClass a_shaderClass, RE::BSShader::Type a_type, uint32_t a_descriptor)
+	{
+		return a_descriptor + (static_cast<size_t>(a_type) << 32) + (static_cast<size_t>(a_shaderClass) << 60);
+	}
+
+	size_t ShaderCompilationTask::GetId(size_t a_permutationId, CompilationTier a_tier)
+	{
+		return a_permutationId + (static_cast<size_t>(a_tier) << 62);
+	}
+
+	size_t ShaderCompilationTask::GetPermutationId() const
+	{
+		return GetPermutationId(shaderClass, shader.shaderType.get(), descriptor);
+	}
+
 	size_t ShaderCompilationTask::GetId() const
 	{
-		return descriptor + (static_cast<size_t>(shader.shaderType.underlying()) << 32) +
-		       (static_cast<size_t>(shaderClass) << 60);
+		return GetId(GetPermutationId(), tier);
 	}
 
 	std::string ShaderCompilationTask::GetString() const
@@ -1563,41 +2334,86 @@ namespace SIE
 		auto& shaderCache = ShaderCache::Instance();
 		if (!conditionVariable.wait(
 				lock, stoken,
-				[this, &shaderCache]() { return !availableTasks.empty() &&
-			                                    // check against all tasks in queue to trickle the work. It cannot be the active tasks count because the thread pool itself is maximum.
-			                                    (int)shaderCache.compilationPool.get_tasks_total() <=
-			                                        (!shaderCache.backgroundCompilation ? shaderCache.compilationThreadCount : shaderCache.backgroundCompilationThreadCount); })) {
+				[this, &shaderCache]() { return (!availableTasks.empty() || !priorityTasks.empty() || !availableTierUpTasks.empty()) &&
+			                                    shaderCache.compilationJobs < shaderCache.GetCompilationJobLimit(); })) {
 			/*Woke up because of a stop request. */
 			return std::nullopt;
 		}
-		if (!ShaderCache::Instance().IsCompiling()) {  // we just got woken up because there's a task, start clock
+		// optimized tier-ups only run once nothing else is waiting and are not counted towards compile progress
+		bool tierUp = priorityTasks.empty() && availableTasks.empty();
+		if (!tierUp && !ShaderCache::Instance().IsCompiling()) {  // we just got woken up because there's a task, start clock
 			lastCalculation = lastReset = high_resolution_clock::now();
+			shaderCache.StartCompileSession();
 		}
-		auto node = availableTasks.extract(availableTasks.begin());
-		auto& task = node.value();
-		tasksInProgress.insert(std::move(node));
+		std::optional<ShaderCompilationTask> task;
+		if (!priorityTasks.empty()) {
+			task.emplace(priorityTasks.front());
+			priorityTasks.pop_front();
+		} else if (!availableTasks.empty()) {
+			task.emplace(availableTasks.extract(availableTasks.begin()).mapped());
+		} else {
+			task.emplace(availableTierUpTasks.front());
+			availableTierUpTasks.pop_front();
+		}
+		taskStates.Transition(task->GetId(), TaskStateTable::State::Queued, TaskStateTable::State::InFlight);
+		shaderCache.compilationJobs++;
 		return task;
 	}
 
 	void CompilationSet::Add(const ShaderCompilationTask& task)
 	{
-		std::unique_lock lock(compilationMutex);
-		auto inProgressIt = tasksInProgress.find(task);
-		auto processedIt = processedTasks.find(task);
-		if (inProgressIt == tasksInProgress.end() && processedIt == processedTasks.end() && !ShaderCache::Instance().GetCompletedShader(task)) {
-			auto [availableIt, wasAdded] = availableTasks.insert(task);
-			lock.unlock();
-			if (wasAdded) {
-				conditionVariable.notify_one();
-				totalTasks++;
+		// already queued, compiling or done, this is the common case and needs no lock
+		auto id = task.GetId();
+		if (taskStates.Get(id) != TaskStateTable::State::None)
+			return;
+
+		auto& cache = ShaderCache::Instance();
+		shaders[static_cast<size_t>(task.GetShader().shaderType.get())].store(&task.GetShader(), std::memory_order_relaxed);
+		bool tierUp = task.GetTier() == CompilationTier::Optimized && cache.IsFastTierShader(task.GetString());
+		if (!tierUp && cache.GetCompletedShader(task)) {
+			taskStates.TryInsert(id, TaskStateTable::State::Done);
+			return;
+		}
+		if (!taskStates.TryInsert(id, TaskStateTable::State::Queued, tierUp))
+			return;
+
+		if (tierUp) {
+			{
+				std::scoped_lock lock(compilationMutex);
+				availableTierUpTasks.push_back(task);
 			}
+			conditionVariable.notify_one();
+			tierUpTasks++;
+			return;
+		}
+
+		auto queued = task;
+		queued.SetEstimatedMs(cache.EstimateCompileMs(task));
+		estimatedRemainingMs += queued.GetEstimatedMs();
+		{
+			std::scoped_lock lock(compilationMutex);
+			availableTasks.emplace(queued.GetEstimatedMs(), queued);
 		}
+		conditionVariable.notify_one();
+		totalTasks++;
 	}
 
 	void CompilationSet::Complete(const ShaderCompilationTask& task)
 	{
 		auto& cache = ShaderCache::Instance();
 		auto key = task.GetString();
+		auto id = task.GetId();
+		bool tierUp = taskStates.IsTierUp(id);
+		taskStates.Transition(id, TaskStateTable::State::InFlight, TaskStateTable::State::Done);
+		if (tierUp) {
+			logger::debug("Optimized tier-up finished: {}", key);
+			completedTierUpTasks++;
+			conditionVariable.notify_one();
+			return;
+		}
+
+		estimatedRemainingMs -= task.GetEstimatedMs();
+		estimatedCompletedMs += task.GetEstimatedMs();
 		auto shaderBlob = cache.GetCompletedShader(task);
 		if (shaderBlob) {
 			logger::debug("Compiling Task succeeded: {}", key);
@@ -1609,22 +2425,120 @@ namespace SIE
 		auto now = high_resolution_clock::now();
 		totalMs += duration_cast<milliseconds>(now - lastCalculation).count();
 		lastCalculation = now;
-		std::scoped_lock lock(compilationMutex);
-		processedTasks.insert(task);
-		tasksInProgress.erase(task);
 		conditionVariable.notify_one();
+		NotifyReady();
+
+		if (!cache.IsCompiling()) {
+			cache.FinishCompileSession();
+		}
+	}
+
+	uint64_t CompilationSet::Requeue(const std::unordered_set<std::string>& a_shaders, CompilationTier a_tier)
+	{
+		std::vector<size_t> doneIds;
+		taskStates.ForEach([&](size_t a_id, TaskStateTable::State a_state) {
+			if (a_state == TaskStateTable::State::Done)
+				doneIds.push_back(a_id);
+		});
+
+		uint64_t requeued = 0;
+		for (auto id : doneIds) {
+			auto shader = shaders[(id >> 32) & 0xF].load(std::memory_order_relaxed);
+			if (!shader)
+				continue;
+			std::string name = shader->fxpFilename;
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+			if (!a_shaders.contains(name) || !taskStates.Transition(id, TaskStateTable::State::Done, TaskStateTable::State::None))
+				continue;
+
+			// fast and optimized entries of the same permutation collapse into one task
+			ShaderCompilationTask task(static_cast<ShaderClass>((id >> 60) & 0x3), *shader, static_cast<uint32_t>(id), a_tier);
+			if (!taskStates.TryInsert(task.GetId(), TaskStateTable::State::Queued))
+				continue;
+			task.SetEstimatedMs(ShaderCache::Instance().EstimateCompileMs(task));
+			estimatedRemainingMs += task.GetEstimatedMs();
+			{
+				std::scoped_lock lock(compilationMutex);
+				priorityTasks.push_back(task);
+			}
+			totalTasks++;
+			requeued++;
+		}
+		conditionVariable.notify_all();
+		return requeued;
+	}
+
+	size_t CompilationSet::Prioritize(const std::unordered_set<size_t>& a_permutationIds)
+	{
+		std::scoped_lock lock(compilationMutex);
+		size_t moved = 0;
+		for (auto it = availableTasks.begin(); it != availableTasks.end();) {
+			if (a_permutationIds.contains(it->second.GetPermutationId())) {
+				priorityTasks.push_back(it->second);
+				it = availableTasks.erase(it);
+				moved++;
+			} else {
+				++it;
+			}
+		}
+		return moved;
+	}
+
+	bool CompilationSet::IsPending(size_t a_permutationId) const
+	{
+		auto isPending = [this](size_t a_id) {
+			auto state = taskStates.Get(a_id);
+			return state == TaskStateTable::State::Queued || state == TaskStateTable::State::InFlight;
+		};
+		// a fast tier shader is usable already, its optimized tier-up does not need to be waited for
+		auto optimizedId = ShaderCompilationTask::GetId(a_permutationId, CompilationTier::Optimized);
+		return isPending(ShaderCompilationTask::GetId(a_permutationId, CompilationTier::Fast)) ||
+		       (isPending(optimizedId) && !taskStates.IsTierUp(optimizedId));
+	}
+
+	void CompilationSet::WaitForReady(const std::unordered_set<size_t>& a_permutationIds, const std::function<bool()>& a_skip)
+	{
+		auto& cache = ShaderCache::Instance();
+		readyWaiting = true;
+		{
+			std::unique_lock lock(compilationMutex);
+			readyCondition.wait(lock, [&]() {
+				if (a_skip())
+					return true;
+				if (a_permutationIds.empty())
+					return !cache.IsCompiling();
+				return std::ranges::none_of(a_permutationIds, [this](size_t a_id) { return IsPending(a_id); });
+			});
+		}
+		readyWaiting = false;
+	}
+
+	void CompilationSet::NotifyReady()
+	{
+		if (!readyWaiting)
+			return;
+		// the waiter checks its predicate under this lock, so it either sees the new state or is already waiting
+		{
+			std::scoped_lock lock(compilationMutex);
+		}
+		readyCondition.notify_all();
 	}
 
 	void CompilationSet::Clear()
 	{
 		std::scoped_lock lock(compilationMutex);
 		availableTasks.clear();
-		tasksInProgress.clear();
-		processedTasks.clear();
+		priorityTasks.clear();
+		availableTierUpTasks.clear();
+		taskStates.Clear();
 		totalTasks = 0;
+		tierUpTasks = 0;
+		completedTierUpTasks = 0;
 		completedTasks = 0;
 		failedTasks = 0;
 		cacheHitTasks = 0;
+		estimatedRemainingMs = 0;
+		estimatedCompletedMs = 0;
 		lastReset = high_resolution_clock::now();
 		lastCalculation = high_resolution_clock::now();
 		totalMs = (double)duration_cast<std::chrono::milliseconds>(lastReset - lastReset).count();
@@ -1645,9 +2559,8 @@ namespace SIE
 
 	double CompilationSet::GetEta()
 	{
-		auto rate = completedTasks / totalMs;
-		auto remaining = totalTasks - completedTasks - failedTasks;
-		return std::max(remaining / rate, 0.0);
+		// the cost model says how much work is left, how fast it gets done is measured from the work finished so far
+		return CompilationCostModel::GetEta(estimatedRemainingMs, estimatedCompletedMs, totalMs, ShaderCache::Instance().GetCompilationJobLimit());
 	}
 
 	std::string CompilationSet::GetStatsString(bool a_timeOnly)
@@ -1656,12 +2569,15 @@ namespace SIE
 			return fmt::format("{}/{}",
 				GetHumanTime(totalMs),
 				GetHumanTime(GetEta() + totalMs));
-		return fmt::format("{}/{} (successful/total)\tfailed: {}\tcachehits: {}\nElapsed/Estimated Time: {}/{}",
+		auto stats = fmt::format("{}/{} (successful/total)\tfailed: {}\tcachehits: {}\nElapsed/Estimated Time: {}/{}",
 			(std::uint64_t)completedTasks,
 			(std::uint64_t)totalTasks,
 			(std::uint64_t)failedTasks,
 			(std::uint64_t)cacheHitTasks,
 			GetHumanTime(totalMs),
 			GetHumanTime(GetEta() + totalMs));
+		if (tierUpTasks)
+			stats += fmt::format("\nOptimized: {}/{}", (std::uint64_t)completedTierUpTasks, (std::uint64_t)tierUpTasks);
+		return stats;
 	}
 }
\ No newline at end of file
@@ -2,12 +2,17 @@
 
 #include <RE/B/BSShader.h>
 
-#include "BS_thread_pool.hpp"
 #include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "ShaderTools/CompilationCostModel.h"
+#include "ShaderTools/ShaderIncludeGraph.h"
+#include "ShaderTools/TaskStateTable.h"
+
 static constexpr REL::Version SHADER_CACHE_VERSION = { 0, 0, 0, 13 };
 
 using namespace std::chrono;
@@ -22,6 +27,13 @@ namespace SIE
 		Total,
 	};
 
+	// Tiered compilation first builds an unoptimized shader so it can be used at once, then replaces it with an optimized one
+	enum class CompilationTier
+	{
+		Fast,
+		Optimized,
+	};
+
 	class ShaderCompilationTask
 	{
 	public:
@@ -32,11 +44,23 @@ namespace SIE
 			Completed
 		};
 		ShaderCompilationTask(ShaderClass shaderClass, const RE::BSShader& shader,
-			uint32_t descriptor);
+			uint32_t descriptor, CompilationTier tier = CompilationTier::Optimized);
 		void Perform() const;
 
+		// Identifies the permutation regardless of tier, used by the usage profile
+		static size_t GetPermutationId(ShaderClass a_shaderClass, RE::BSShader::Type a_type, uint32_t a_descriptor);
+		static size_t GetId(size_t a_permutationId, CompilationTier a_tier);
+		size_t GetPermutationId() const;
 		size_t GetId() const;
 		std::string GetString() const;
+		CompilationTier GetTier() const { return tier; }
+		ShaderClass GetShaderClass() const { return shaderClass; }
+		const RE::BSShader& GetShader() const { return shader; }
+		uint32_t GetDescriptor() const { return descriptor; }
+		double GetEstimatedMs() const { return estimatedMs; }
+		void SetEstimatedMs(double a_ms) { estimatedMs = a_ms; }
+		double GetQueueMs() const { return duration<double, std::milli>(high_resolution_clock::now() - queuedTime).count(); }
+		ShaderCompilationTask WithTier(CompilationTier a_tier) const { return { shaderClass, shader, descriptor, a_tier }; }
 
 		bool operator==(const ShaderCompilationTask& other) const;
 
@@ -44,26 +68,77 @@ namespace SIE
 		ShaderClass shaderClass;
 		const RE::BSShader& shader;
 		uint32_t descriptor;
+		CompilationTier tier;
+		double estimatedMs = 0;  // from the cost model, set when queued
+		high_resolution_clock::time_point queuedTime = high_resolution_clock::now();
 	};
 }
 
-template <>
-struct std::hash<SIE::ShaderCompilationTask>
+namespace SIE
 {
-	std::size_t operator()(const SIE::ShaderCompilationTask& task) const noexcept
+	// Feature compute shaders are not tied to a BSShader, so they are identified by source file, entry point and defines
+	struct ComputeShaderDesc
 	{
-		return task.GetId();
-	}
-};
+		std::wstring path;
+		std::vector<std::pair<std::string, std::string>> defines{};
+		std::string program = "main";
+		std::string profile = "cs_5_0";
+
+		// Every macro the shader is compiled with, the plugin and feature defines included
+		std::vector<std::pair<std::string, std::string>> GetMacros() const;
+		uint32_t GetCompileFlags() const;
+		// Built from the final macros and compile flags, so a blob cached on disk is never reused after either changes
+		std::string GetKey() const;
+	};
+
+	// What producing a single permutation cost, written to a CSV at the end of each compile session
+	struct CompilationTelemetry
+	{
+		enum class Source
+		{
+			Memory,
+			Disk,
+			Compile,
+		};
+
+		ShaderClass shaderClass = ShaderClass::Vertex;
+		RE::BSShader::Type type{};
+		uint32_t descriptor = 0;
+		CompilationTier tier = CompilationTier::Optimized;
+		std::string technique;
+		std::string defines;
+		Source source = Source::Compile;
+		bool failed = false;
+		double wallMs = 0;
+		double queueMs = 0;  // only set for async tasks
+		size_t bytecodeSize = 0;
+		uint32_t instructionCount = 0;  // 0 when the blob had no reflection statistics
+	};
+
+	struct CompilationTelemetrySummary
+	{
+		std::string type;
+		std::string technique;
+		uint32_t permutations = 0;
+		uint32_t compiled = 0;
+		uint32_t failed = 0;
+		double totalMs = 0;
+		double maxMs = 0;
+		double averageInstructions = 0;
+	};
 
-namespace SIE
-{
 	class CompilationSet
 	{
 	public:
 		std::optional<ShaderCompilationTask> WaitTake(std::stop_token stoken);
 		void Add(const ShaderCompilationTask& task);
 		void Complete(const ShaderCompilationTask& task);
+		uint64_t Requeue(const std::unordered_set<std::string>& a_shaders, CompilationTier a_tier);
+		// Moves queued tasks of the given permutations in front of the rest, returns how many were moved
+		size_t Prioritize(const std::unordered_set<size_t>& a_permutationIds);
+		// Blocks until none of the given permutations is queued or compiling, or a_skip returns true. An empty set waits for the whole queue.
+		void WaitForReady(const std::unordered_set<size_t>& a_permutationIds, const std::function<bool()>& a_skip);
+		void NotifyReady();
 		void Clear();
 		std::string GetHumanTime(double a_totalms);
 		double GetEta();
@@ -72,13 +147,24 @@ namespace SIE
 		std::atomic<uint64_t> totalTasks = 0;
 		std::atomic<uint64_t> failedTasks = 0;
 		std::atomic<uint64_t> cacheHitTasks = 0;  // number of compiles of a previously seen shader combo
+		std::atomic<uint64_t> tierUpTasks = 0;    // optimized recompiles of fast tier shaders, not part of totalTasks
+		std::atomic<uint64_t> completedTierUpTasks = 0;
+		std::atomic<double> estimatedRemainingMs = 0;  // cost model estimate of queued and in flight tasks
+		std::atomic<double> estimatedCompletedMs = 0;
 		std::mutex compilationMutex;
 
 	private:
-		std::unordered_set<ShaderCompilationTask> availableTasks;
-		std::unordered_set<ShaderCompilationTask> tasksInProgress;
-		std::unordered_set<ShaderCompilationTask> processedTasks;  // completed or failed
+		bool IsPending(size_t a_permutationId) const;
+
+		// queued, in flight and done states live in taskStates, the queues below only hand tasks to the compiler threads
+		TaskStateTable taskStates;
+		std::array<std::atomic<const RE::BSShader*>, static_cast<size_t>(RE::BSShader::Type::Total)> shaders{};  // to rebuild tasks from ids
+		std::multimap<double, ShaderCompilationTask, std::greater<>> availableTasks;  // longest estimated compile first so no expensive permutation starts last
+		std::deque<ShaderCompilationTask> priorityTasks;         // hot reloaded permutations, taken before availableTasks
+		std::deque<ShaderCompilationTask> availableTierUpTasks;  // only taken once availableTasks is empty
 		std::condition_variable_any conditionVariable;
+		std::condition_variable_any readyCondition;  // wakes WaitForReady, notified only while someone waits
+		std::atomic<bool> readyWaiting = false;
 		std::chrono::steady_clock::time_point lastReset = high_resolution_clock::now();
 		std::chrono::steady_clock::time_point lastCalculation = high_resolution_clock::now();
 		double totalMs = (double)duration_cast<std::chrono::milliseconds>(lastReset - lastReset).count();
@@ -119,6 +205,8 @@ namespace SIE
 		void SetAsync(bool value);
 		bool IsDump() const;
 		void SetDump(bool value);
+		bool IsTieredCompilation() const;
+		void SetTieredCompilation(bool value);
 
 		bool IsDiskCache() const;
 		void SetDiskCache(bool value);
@@ -126,8 +214,29 @@ namespace SIE
 		void ValidateDiskCache();
 		void WriteDiskCacheInfo();
 		void Clear();
+		void ReleaseRetiredShaders();
+		void InvalidateShaders(const std::unordered_set<std::string>& a_shaders, const std::vector<ComputeShaderDesc>& a_computeShaders = {});
+
+		void AddTelemetry(size_t a_taskId, CompilationTelemetry a_telemetry, bool a_overwrite);
+		void SetTelemetryQueueTime(size_t a_taskId, double a_queueMs);
+		void WriteTelemetry();
+		// A session runs from the first task taken off an empty queue until the queue drains, its end writes telemetry and the cost model
+		void StartCompileSession();
+		void FinishCompileSession();
+		void RecordDescriptor(const RE::BSShader& a_shader, ShaderClass a_shaderClass, uint32_t a_descriptor, uint32_t a_lookup);
+		void WritePermutationReport();
 
-		bool AddCompletedShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, ID3DBlob* a_blob);
+		void RecordUsage(ShaderClass a_shaderClass, const RE::BSShader& a_shader, uint32_t a_descriptor);
+		void FinishUsageRecording();
+		void WaitForReadySet();
+		void ContinueInBackground();
+		std::vector<CompilationTelemetrySummary> GetTelemetrySummary();
+		void RecordCompileCost(const CompilationTelemetry& a_telemetry);
+		double EstimateCompileMs(const ShaderCompilationTask& a_task);
+		void SaveCostModel();
+
+		bool AddCompletedShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor, ID3DBlob* a_blob, CompilationTier a_tier = CompilationTier::Optimized);
+		bool IsFastTierShader(const std::string& a_key);
 		ID3DBlob* GetCompletedShader(const std::string a_key);
 		ID3DBlob* GetCompletedShader(const SIE::ShaderCompilationTask& a_task);
 		ID3DBlob* GetCompletedShader(ShaderClass shaderClass, const RE::BSShader& shader, uint32_t descriptor);
@@ -138,23 +247,30 @@ namespace SIE
 		RE::BSGraphics::PixelShader* GetPixelShader(const RE::BSShader& shader,
 			uint32_t descriptor);
 
+		static std::wstring GetComputeShaderDiskPath(const ComputeShaderDesc& a_desc);
+		ID3DBlob* CompileComputeShader(const ComputeShaderDesc& a_desc);
+		void CompileComputeShaders(const std::vector<ComputeShaderDesc>& a_descs);
+		ID3D11ComputeShader* GetComputeShader(const ComputeShaderDesc& a_desc);
+
 		RE::BSGraphics::VertexShader* MakeAndAddVertexShader(const RE::BSShader& shader,
-			uint32_t descriptor);
+			uint32_t descriptor, CompilationTier tier = CompilationTier::Optimized);
 		RE::BSGraphics::PixelShader* MakeAndAddPixelShader(const RE::BSShader& shader,
-			uint32_t descriptor);
+			uint32_t descriptor, CompilationTier tier = CompilationTier::Optimized);
 
 		uint64_t GetCachedHitTasks();
 		uint64_t GetCompletedTasks();
 		uint64_t GetFailedTasks();
 		uint64_t GetTotalTasks();
 		void IncCacheHitTasks();
+		int32_t GetCompilationJobLimit() const;
 		void ToggleErrorMessages();
 		bool IsHideErrors();
 
 		int32_t compilationThreadCount = std::max(static_cast<int32_t>(std::thread::hardware_concurrency()) - 1, 1);
 		int32_t backgroundCompilationThreadCount = std::max(static_cast<int32_t>(std::thread::hardware_concurrency()) / 2, 1);
-		BS::thread_pool compilationPool{};
+		std::atomic<int32_t> compilationJobs = 0;  // compile jobs handed to the JobSystem and not finished yet, changed under compilationSet.compilationMutex
 		bool backgroundCompilation = false;
+		std::atomic<bool> computeShadersReloaded = false;  // set by hot reload, features recreate their compute shaders on the next Present
 		bool menuLoaded = false;
 
 		enum class LightingShaderTechniques
@@ -231,7 +347,10 @@ namespace SIE
 	private:
 		ShaderCache();
 		void ManageCompilationSet(std::stop_token stoken);
-		void ProcessCompilationSet(std::stop_token stoken, SIE::ShaderCompilationTask task);
+		void ProcessCompilationSet(SIE::ShaderCompilationTask task);
+		void WatchShaderSources(std::stop_token stoken);
+		std::unordered_set<size_t> LoadUsageProfile();
+		void WriteUsageProfile();
 
 		~ShaderCache();
 
@@ -241,18 +360,52 @@ namespace SIE
 		std::array<std::map<uint32_t, std::unique_ptr<RE::BSGraphics::PixelShader>>,
 			static_cast<size_t>(RE::BSShader::Type::Total)>
 			pixelShaders;
+		// shaders replaced by a tier-up may still be referenced by the frames in flight, so they are only released once
+		// RetiredShaderFrames more frames have been presented
+		static constexpr uint64_t RetiredShaderFrames = 3;
+
+		template <class T>
+		struct RetiredShader
+		{
+			std::unique_ptr<T> shader;
+			uint64_t frame;
+		};
+
+		std::vector<RetiredShader<RE::BSGraphics::VertexShader>> retiredVertexShaders;
+		std::vector<RetiredShader<RE::BSGraphics::PixelShader>> retiredPixelShaders;
+		std::atomic<uint64_t> presentCount = 0;
 
 		bool isEnabled = false;
 		bool isDiskCache = false;
 		bool isAsync = true;
 		bool isDump = false;
 		bool hideError = false;
+		bool isTieredCompilation = false;
 
-		std::stop_source ssource;
 		std::mutex vertexShadersMutex;
 		std::mutex pixelShadersMutex;
 		CompilationSet compilationSet;
 		std::unordered_map<std::string, std::pair<ID3DBlob*, ShaderCompilationTask::Status>> shaderMap{};
+		std::unordered_set<std::string> fastTierShaders{};  // keys in shaderMap that still hold a fast tier blob
 		std::mutex mapMutex;
+
+		std::unordered_map<size_t, CompilationTelemetry> telemetry{};  // keyed by ShaderCompilationTask::GetId
+		std::set<std::tuple<RE::BSShader::Type, ShaderClass, uint32_t, uint32_t>> descriptorManifest{};  // descriptors the game loaded and what they were looked up as
+		std::mutex telemetryMutex;
+		std::mutex telemetryFileMutex;               // the end of overlapping sessions and Analyze Permutations can all write the CSVs
+		std::atomic<bool> isSessionWritten = false;  // telemetry and cost model are written once per compile session
+
+		// permutations requested from startup until shortly after the first game load, gating at kDataLoaded only waits for these
+		const std::string usageProfilePath = "Data\\SKSE\\Plugins\\CommunityShadersUsage.csv";
+		TaskStateTable usageTable;
+
+		const std::string costModelPath = "Data\\SKSE\\Plugins\\CommunityShadersCostModel.csv";
+		CompilationCostModel costModel;
+		std::atomic<bool> isRecordingUsage = true;
+		std::jthread usageRecorder;
+
+		ShaderIncludeGraph includeGraph;  // only touched by sourceWatcher
+		std::jthread sourceWatcher;
+		std::jthread compilationDispatcher;  // feeds compile jobs to the JobSystem, it only waits so it does not occupy a worker
 	};
 }
@@ -62,6 +62,22 @@ namespace REX
 	static_assert(offsetof(PixelShader, m_ConstantUnion.m_PerMaterial) == 0x20);
 	static_assert(offsetof(PixelShader, m_ConstantOffsets) == 0x40);
 
+	// Constants of one group being written for a draw, between the map and the flush in Setup*()
+	struct PixelShaderConstantGroup
+	{
+		D3D11_MAPPED_SUBRESOURCE m_Map;
+		ID3D11Buffer* m_Buffer;
+		bool m_Unified;
+		std::uint32_t m_UnifiedByteOffset;
+		PixelShader* m_Shader;
+
+		template <class T>
+		T* Param(std::uint32_t a_index) const
+		{
+			return reinterpret_cast<T*>(static_cast<std::byte*>(m_Map.pData) + m_Shader->m_ConstantOffsets[a_index] * 4);
+		}
+	};
+
 	class BSShader :
 		public RE::NiRefObject,          // 00
 		public RE::NiBoneMatrixSetterI,  // 10
@@ -0,0 +1,87 @@
+#include "CompilationCostModel.h"
+
+#include <algorithm>
+#include <mutex>
+
+void CompilationCostModel::Record(const Key& a_key, double a_ms)
+{
+	std::unique_lock lock(mutex);
+	Entry entry{ a_ms, 1 };
+	if (auto it = entries.find(a_key); it != entries.end()) {
+		entry.samples = std::min(it->second.samples + 1, 1000u);
+		auto weight = std::max(1.0 / entry.samples, 0.25);
+		entry.ms = it->second.ms + (a_ms - it->second.ms) * weight;
+	}
+	Set(a_key, entry);
+}
+
+double CompilationCostModel::Estimate(const Key& a_key) const
+{
+	std::shared_lock lock(mutex);
+	if (auto it = entries.find(a_key); it != entries.end())
+		return it->second.ms;
+	if (auto it = techniqueAverages.find(GetTechniqueKey(a_key)); it != techniqueAverages.end())
+		return it->second.totalMs / it->second.count;
+	if (auto it = typeAverages.find(GetTypeKey(a_key)); it != typeAverages.end())
+		return it->second.totalMs / it->second.count;
+	return GetHeuristic(a_key);
+}
+
+double CompilationCostModel::GetEta(double a_remainingMs, double a_completedMs, double a_elapsedMs, int a_workers)
+{
+	auto remaining = std::max(a_remainingMs, 0.0);
+	if (a_completedMs > 0 && a_elapsedMs > 0)
+		return remaining * a_elapsedMs / a_completedMs;
+	return remaining / std::max(a_workers, 1);
+}
+
+bool CompilationCostModel::IsEmpty() const
+{
+	std::shared_lock lock(mutex);
+	return entries.empty();
+}
+
+CompilationCostModel::TechniqueKey CompilationCostModel::GetTechniqueKey(const Key& a_key)
+{
+	auto& [type, shaderClass, technique, defines, tier] = a_key;
+	return { type, shaderClass, technique, tier };
+}
+
+CompilationCostModel::TypeKey CompilationCostModel::GetTypeKey(const Key& a_key)
+{
+	auto& [type, shaderClass, technique, defines, tier] = a_key;
+	return { type, shaderClass, tier };
+}
+
+double CompilationCostModel::GetHeuristic(const Key& a_key)
+{
+	// rough relative costs, only used until a session has compiled something of this type
+	auto& [type, shaderClass, technique, defines, tier] = a_key;
+	double ms = shaderClass == "Pixel" ? 400.0 : 150.0;
+	if (type == "Lighting")
+		ms *= 2.0;
+	if (technique.find("Parallax") != std::string::npos)
+		ms *= 2.0;
+	ms *= 1.0 + 0.1 * std::count(defines.begin(), defines.end(), ' ');
+	if (tier == "Fast")
+		ms *= 0.3;
+	return ms;
+}
+
+void CompilationCostModel::Set(const Key& a_key, Entry a_entry)
+{
+	double previousMs = 0;
+	size_t added = 1;
+	if (auto it = entries.find(a_key); it != entries.end()) {
+		previousMs = it->second.ms;
+		added = 0;
+	}
+	entries[a_key] = a_entry;
+
+	auto& technique = techniqueAverages[GetTechniqueKey(a_key)];
+	technique.totalMs += a_entry.ms - previousMs;
+	technique.count += added;
+	auto& type = typeAverages[GetTypeKey(a_key)];
+	type.totalMs += a_entry.ms - previousMs;
+	type.count += added;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+
+// Expected compile time of a permutation, learned from the compile telemetry of previous sessions.
+// Permutations never compiled before fall back to the average of their technique, then of their type, then to a heuristic.
+class CompilationCostModel
+{
+public:
+	using Key = std::tuple<std::string, std::string, std::string, std::string, std::string>;  // type, class, technique, defines, tier
+
+	// CSV persistence lives in CompilationCostModelCsv.cpp so the model itself only needs the standard library
+	void Load(const std::filesystem::path& a_path);
+	void Save(const std::filesystem::path& a_path) const;
+
+	// Moving average so the model follows changes to the shader sources and compiler settings
+	void Record(const Key& a_key, double a_ms);
+	double Estimate(const Key& a_key) const;
+	bool IsEmpty() const;
+
+	// Time left to compile a_remainingMs of estimated work. Once some has finished, the elapsed time per estimated ms so far
+	// corrects both the model's scale and the parallelism, before that the estimate is spread over a_workers threads.
+	static double GetEta(double a_remainingMs, double a_completedMs, double a_elapsedMs, int a_workers);
+
+private:
+	struct Entry
+	{
+		double ms = 0;
+		uint32_t samples = 0;
+	};
+
+	struct Average
+	{
+		double totalMs = 0;
+		size_t count = 0;
+	};
+
+	using TechniqueKey = std::tuple<std::string, std::string, std::string, std::string>;  // type, class, technique, tier
+	using TypeKey = std::tuple<std::string, std::string, std::string>;                     // type, class, tier
+
+	static TechniqueKey GetTechniqueKey(const Key& a_key);
+	static TypeKey GetTypeKey(const Key& a_key);
+	static double GetHeuristic(const Key& a_key);
+	void Set(const Key& a_key, Entry a_entry);
+
+	std::map<Key, Entry> entries;
+	std::map<TechniqueKey, Average> techniqueAverages;
+	std::map<TypeKey, Average> typeAverages;
+	mutable std::shared_mutex mutex;
+};
@@ -0,0 +1,49 @@
+#include "CompilationCostModel.h"
+
+#include <mutex>
+
+#include <rapidcsv.h>
+
+void CompilationCostModel::Load(const std::filesystem::path& a_path)
+{
+	std::unique_lock lock(mutex);
+	entries.clear();
+	techniqueAverages.clear();
+	typeAverages.clear();
+	if (!std::filesystem::exists(a_path))
+		return;
+
+	rapidcsv::Document document(a_path.string(), rapidcsv::LabelParams(0, -1));
+	auto types = document.GetColumn<std::string>("Type");
+	auto classes = document.GetColumn<std::string>("Class");
+	auto techniques = document.GetColumn<std::string>("Technique");
+	auto defines = document.GetColumn<std::string>("Defines");
+	auto tiers = document.GetColumn<std::string>("Tier");
+	auto ms = document.GetColumn<double>("Ms");
+	auto samples = document.GetColumn<uint32_t>("Samples");
+	for (size_t i = 0; i < types.size(); i++)
+		Set({ types[i], classes[i], techniques[i], defines[i], tiers[i] }, { ms[i], samples[i] });
+}
+
+void CompilationCostModel::Save(const std::filesystem::path& a_path) const
+{
+	rapidcsv::Document document("", rapidcsv::LabelParams(0, -1));
+	const std::vector<std::string> columns = { "Type", "Class", "Technique", "Defines", "Tier", "Ms", "Samples" };
+	for (size_t i = 0; i < columns.size(); i++)
+		document.SetColumnName(i, columns[i]);
+
+	std::shared_lock lock(mutex);
+	size_t row = 0;
+	for (auto& [key, entry] : entries) {
+		auto& [type, shaderClass, technique, defines, tier] = key;
+		document.SetCell<std::string>(0, row, type);
+		document.SetCell<std::string>(1, row, shaderClass);
+		document.SetCell<std::string>(2, row, technique);
+		document.SetCell<std::string>(3, row, defines);
+		document.SetCell<std::string>(4, row, tier);
+		document.SetCell<double>(5, row, entry.ms);
+		document.SetCell<uint32_t>(6, row, entry.samples);
+		row++;
+	}
+	document.Save(a_path.string());
+}
@@ -0,0 +1,127 @@
+#include "PermutationAnalyzer.h"
+
+#include <algorithm>
+#include <bit>
+#include <set>
+
+namespace PermutationAnalyzer
+{
+	Candidate Evaluate(const Manifest& a_manifest, const std::string& a_type, uint32_t a_mask, double a_branchOverhead)
+	{
+		// permutations that were never compiled in the recorded session fall back to their class average
+		std::map<std::string, std::pair<PermutationCost, size_t>> averages;
+		for (auto& [key, cost] : a_manifest.costs) {
+			if (std::get<0>(key) != a_type)
+				continue;
+			auto& [total, count] = averages[std::get<1>(key)];
+			total.compileMs += cost.compileMs;
+			total.bytecodeSize += cost.bytecodeSize;
+			count++;
+		}
+
+		struct Group
+		{
+			PermutationCost cost;
+			uint32_t first = 0;
+			uint32_t varied = 0;
+		};
+		std::map<std::pair<std::string, uint32_t>, Group> groups;
+		std::set<std::pair<std::string, uint32_t>> seen;
+
+		for (auto& entry : a_manifest.descriptors) {
+			if (entry.type != a_type || !seen.insert({ entry.shaderClass, entry.lookup }).second)
+				continue;
+
+			PermutationCost cost;
+			if (auto it = a_manifest.costs.find({ entry.type, entry.shaderClass, entry.lookup }); it != a_manifest.costs.end()) {
+				cost = it->second;
+			} else if (auto averageIt = averages.find(entry.shaderClass); averageIt != averages.end()) {
+				auto& [total, count] = averageIt->second;
+				cost = { total.compileMs / count, total.bytecodeSize / count };
+			}
+
+			auto [it, added] = groups.try_emplace({ entry.shaderClass, entry.lookup & ~a_mask }, Group{ cost, entry.lookup, 0 });
+			if (!added) {
+				auto& group = it->second;
+				group.varied |= (entry.lookup ^ group.first) & a_mask;
+				group.cost.compileMs = std::max(group.cost.compileMs, cost.compileMs);
+				group.cost.bytecodeSize = std::max(group.cost.bytecodeSize, cost.bytecodeSize);
+			}
+		}
+
+		Candidate result{ a_type, {}, a_mask, groups.size() };
+		for (auto& [key, group] : groups) {
+			auto branchFactor = 1.0 + a_branchOverhead * std::popcount(group.varied);
+			result.compileMs += group.cost.compileMs * branchFactor;
+			result.bytecodeSize += group.cost.bytecodeSize * branchFactor;
+		}
+		return result;
+	}
+
+	std::vector<Candidate> Analyze(const Manifest& a_manifest, const std::string& a_type, const std::vector<Flag>& a_flags, double a_branchOverhead)
+	{
+		std::vector<Candidate> result{ Evaluate(a_manifest, a_type, 0, a_branchOverhead) };
+		result.back().flags = "Current";
+
+		// flags already stripped, or never set, cannot collapse anything further
+		uint32_t anyBits = 0;
+		uint32_t allBits = ~0u;
+		for (auto& entry : a_manifest.descriptors) {
+			if (entry.type != a_type)
+				continue;
+			anyBits |= entry.lookup;
+			allBits &= entry.lookup;
+		}
+		const uint32_t varyingBits = anyBits & ~allBits;
+
+		std::vector<Flag> remaining;
+		for (auto& flag : a_flags) {
+			if (!(flag.mask & varyingBits))
+				continue;
+			auto candidate = Evaluate(a_manifest, a_type, flag.mask, a_branchOverhead);
+			candidate.flags = flag.name;
+			result.push_back(candidate);
+			remaining.push_back(flag);
+		}
+
+		uint32_t mask = 0;
+		std::string names;
+		for (size_t step = 0; !remaining.empty(); step++) {
+			auto best = remaining.begin();
+			auto bestCandidate = Evaluate(a_manifest, a_type, mask | best->mask, a_branchOverhead);
+			for (auto it = std::next(remaining.begin()); it != remaining.end(); ++it) {
+				auto candidate = Evaluate(a_manifest, a_type, mask | it->mask, a_branchOverhead);
+				if (candidate.compileMs < bestCandidate.compileMs) {
+					best = it;
+					bestCandidate = candidate;
+				}
+			}
+			mask |= best->mask;
+			names += names.empty() ? best->name : "+" + best->name;
+			remaining.erase(best);
+
+			// the first greedy step is already listed as a single flag
+			if (step > 0) {
+				bestCandidate.flags = names;
+				result.push_back(bestCandidate);
+			}
+		}
+		return result;
+	}
+
+	std::vector<Flag> GetBitFlags(const Manifest& a_manifest, const std::string& a_type)
+	{
+		uint32_t anyBits = 0;
+		for (auto& entry : a_manifest.descriptors) {
+			if (entry.type == a_type)
+				anyBits |= entry.lookup;
+		}
+
+		std::vector<Flag> flags;
+		for (uint32_t bit = 0; bit < 32; bit++) {
+			if (anyBits & (1u << bit))
+				flags.push_back({ "Bit" + std::to_string(bit), 1u << bit });
+		}
+		return flags;
+	}
+}
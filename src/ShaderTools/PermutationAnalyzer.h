@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Estimates what moving further descriptor bits to runtime branches (like State::ModifyShaderLookup does) would save.
+// Works purely on the descriptor manifest and compile telemetry CSVs, so it also runs outside the game, see tests/PermutationAnalyzerTool.cpp.
+// The CSV reading and writing lives in PermutationAnalyzerCsv.cpp, the analysis itself only needs the standard library.
+namespace PermutationAnalyzer
+{
+	struct DescriptorEntry
+	{
+		std::string type;
+		std::string shaderClass;
+		uint32_t descriptor = 0;  // as requested by the game
+		uint32_t lookup = 0;      // after State::ModifyShaderLookup
+	};
+
+	struct PermutationCost
+	{
+		double compileMs = 0;
+		double bytecodeSize = 0;
+	};
+
+	struct Flag
+	{
+		std::string name;
+		uint32_t mask = 0;
+	};
+
+	struct Candidate
+	{
+		std::string type;
+		std::string flags;  // flags stripped on top of the current lookup, "+" separated
+		uint32_t mask = 0;
+		size_t permutations = 0;
+		double compileMs = 0;
+		double bytecodeSize = 0;
+	};
+
+	struct Manifest
+	{
+		std::vector<DescriptorEntry> descriptors;
+		std::map<std::tuple<std::string, std::string, uint32_t>, PermutationCost> costs;  // (type, class, lookup)
+	};
+
+	Manifest LoadManifest(const std::filesystem::path& a_descriptors, const std::filesystem::path& a_telemetry);
+
+	// Collapsed permutations are assumed to cost as much as their most expensive member, plus a_branchOverhead for every stripped bit that varied
+	Candidate Evaluate(const Manifest& a_manifest, const std::string& a_type, uint32_t a_mask, double a_branchOverhead);
+
+	// Returns the current state, every single flag on its own, then flags greedily accumulated by compile time saved
+	std::vector<Candidate> Analyze(const Manifest& a_manifest, const std::string& a_type, const std::vector<Flag>& a_flags, double a_branchOverhead = 0.1);
+
+	// One flag per descriptor bit set for a_type, named by its bit, for when the flag enums are not at hand
+	std::vector<Flag> GetBitFlags(const Manifest& a_manifest, const std::string& a_type);
+
+	void WriteReport(const std::vector<Candidate>& a_candidates, const std::filesystem::path& a_path);
+}
@@ -0,0 +1,68 @@
+#include "PermutationAnalyzer.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <rapidcsv.h>
+
+namespace PermutationAnalyzer
+{
+	Manifest LoadManifest(const std::filesystem::path& a_descriptors, const std::filesystem::path& a_telemetry)
+	{
+		Manifest manifest;
+
+		rapidcsv::Document descriptors(a_descriptors.string(), rapidcsv::LabelParams(0, -1));
+		auto types = descriptors.GetColumn<std::string>("Type");
+		auto classes = descriptors.GetColumn<std::string>("Class");
+		auto descriptorValues = descriptors.GetColumn<std::string>("Descriptor");
+		auto lookupValues = descriptors.GetColumn<std::string>("Lookup");
+		for (size_t i = 0; i < types.size(); i++) {
+			manifest.descriptors.push_back({ types[i], classes[i],
+				(uint32_t)std::stoul(descriptorValues[i], nullptr, 16),
+				(uint32_t)std::stoul(lookupValues[i], nullptr, 16) });
+		}
+
+		if (!std::filesystem::exists(a_telemetry))
+			return manifest;
+
+		// only optimized compiles reflect what a cold compile costs, memory and disk hits say nothing about it
+		rapidcsv::Document telemetry(a_telemetry.string(), rapidcsv::LabelParams(0, -1));
+		auto telemetryTypes = telemetry.GetColumn<std::string>("Type");
+		auto telemetryClasses = telemetry.GetColumn<std::string>("Class");
+		auto telemetryDescriptors = telemetry.GetColumn<std::string>("Descriptor");
+		auto tiers = telemetry.GetColumn<std::string>("Tier");
+		auto sources = telemetry.GetColumn<std::string>("Source");
+		auto failed = telemetry.GetColumn<int>("Failed");
+		auto wallMs = telemetry.GetColumn<double>("Wall ms");
+		auto bytecodeSizes = telemetry.GetColumn<double>("Bytecode Size");
+		for (size_t i = 0; i < telemetryTypes.size(); i++) {
+			if (sources[i] != "Compile" || tiers[i] != "Optimized" || failed[i])
+				continue;
+			auto& cost = manifest.costs[{ telemetryTypes[i], telemetryClasses[i], (uint32_t)std::stoul(telemetryDescriptors[i], nullptr, 16) }];
+			cost.compileMs = std::max(cost.compileMs, wallMs[i]);
+			cost.bytecodeSize = std::max(cost.bytecodeSize, bytecodeSizes[i]);
+		}
+		return manifest;
+	}
+
+	void WriteReport(const std::vector<Candidate>& a_candidates, const std::filesystem::path& a_path)
+	{
+		rapidcsv::Document document("", rapidcsv::LabelParams(0, -1));
+		const std::vector<std::string> columns = { "Type", "Stripped Flags", "Mask", "Permutations", "Estimated Compile ms", "Estimated Bytecode Size" };
+		for (size_t i = 0; i < columns.size(); i++)
+			document.SetColumnName(i, columns[i]);
+
+		for (size_t row = 0; row < a_candidates.size(); row++) {
+			auto& candidate = a_candidates[row];
+			document.SetCell<std::string>(0, row, candidate.type);
+			document.SetCell<std::string>(1, row, candidate.flags);
+			std::ostringstream mask;
+			mask << std::uppercase << std::hex << candidate.mask;
+			document.SetCell<std::string>(2, row, mask.str());
+			document.SetCell<size_t>(3, row, candidate.permutations);
+			document.SetCell<double>(4, row, candidate.compileMs);
+			document.SetCell<double>(5, row, candidate.bytecodeSize);
+		}
+		document.Save(a_path.string());
+	}
+}
@@ -0,0 +1,119 @@
+#include "ShaderIncludeGraph.h"
+
+#include <algorithm>
+#include <fstream>
+#include <regex>
+
+namespace SIE
+{
+	void ShaderIncludeGraph::Build(const std::filesystem::path& a_root)
+	{
+		root = a_root.lexically_normal();
+		includes.clear();
+		includedBy.clear();
+
+		std::error_code ec;
+		for (std::filesystem::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+			if (it->is_regular_file(ec) && IsShaderSource(it->path()))
+				Update(it->path());
+		}
+	}
+
+	void ShaderIncludeGraph::Update(const std::filesystem::path& a_file)
+	{
+		auto key = GetKey(a_file);
+		RemoveEdges(key);
+
+		auto& fileIncludes = includes[key];
+		for (auto& include : ParseIncludes(a_file)) {
+			auto includeKey = ResolveInclude(key, include);
+			fileIncludes.insert(includeKey);
+			includedBy[includeKey].insert(key);
+		}
+	}
+
+	std::unordered_set<std::string> ShaderIncludeGraph::GetAffectedFiles(const std::filesystem::path& a_file) const
+	{
+		std::unordered_set<std::string> visited;
+		std::vector<std::string> pending{ GetKey(a_file) };
+
+		while (!pending.empty()) {
+			auto key = std::move(pending.back());
+			pending.pop_back();
+			if (!visited.insert(key).second)
+				continue;
+
+			if (auto it = includedBy.find(key); it != includedBy.end())
+				pending.insert(pending.end(), it->second.begin(), it->second.end());
+		}
+		return visited;
+	}
+
+	std::unordered_set<std::string> ShaderIncludeGraph::GetAffectedShaders(const std::filesystem::path& a_file) const
+	{
+		std::unordered_set<std::string> result;
+		for (auto& key : GetAffectedFiles(a_file)) {
+			// top level shaders sit directly in the root and are the ones named by BSShader::fxpFilename
+			if (key.find('/') == std::string::npos && key.ends_with(".hlsl"))
+				result.insert(key.substr(0, key.size() - 5));
+		}
+		return result;
+	}
+
+	bool ShaderIncludeGraph::IsShaderSource(const std::filesystem::path& a_file)
+	{
+		auto extension = a_file.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		return extension == ".hlsl" || extension == ".hlsli";
+	}
+
+	std::vector<std::string> ShaderIncludeGraph::ParseIncludes(const std::filesystem::path& a_file)
+	{
+		// conditional includes are still recorded, a spurious dependency only costs an extra recompile
+		static const std::regex includeRegex(R"(^\s*#\s*include\s*[<"]([^>"]+)[>"])");
+
+		std::vector<std::string> result;
+		std::ifstream file(a_file);
+		std::string line;
+		std::smatch match;
+		while (std::getline(file, line)) {
+			if (std::regex_search(line, match, includeRegex))
+				result.push_back(match[1].str());
+		}
+		return result;
+	}
+
+	std::string ShaderIncludeGraph::GetKey(const std::filesystem::path& a_file) const
+	{
+		auto generic = a_file.generic_string();
+		std::replace(generic.begin(), generic.end(), '\\', '/');
+		auto path = std::filesystem::path(generic).lexically_normal();
+		if (!root.empty() && path.is_absolute() == root.is_absolute())
+			path = path.lexically_relative(root);
+		auto key = path.generic_string();
+		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+		return key;
+	}
+
+	std::string ShaderIncludeGraph::ResolveInclude(const std::string& a_includerKey, const std::string& a_include) const
+	{
+		// D3D_COMPILE_STANDARD_FILE_INCLUDE looks next to the including file first, fall back to the shader root
+		auto relative = (std::filesystem::path(a_includerKey).parent_path() / a_include).lexically_normal();
+		std::error_code ec;
+		if (std::filesystem::exists(root / relative, ec) || !std::filesystem::exists(root / a_include, ec))
+			return GetKey(root / relative);
+		return GetKey(root / a_include);
+	}
+
+	void ShaderIncludeGraph::RemoveEdges(const std::string& a_key)
+	{
+		auto it = includes.find(a_key);
+		if (it == includes.end())
+			return;
+		for (auto& includeKey : it->second) {
+			if (auto includedByIt = includedBy.find(includeKey); includedByIt != includedBy.end())
+				includedByIt->second.erase(a_key);
+		}
+		includes.erase(it);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace SIE
+{
+	// Tracks which shader sources include which, so an edited file can be mapped back to the top level shaders that read it.
+	// Only depends on the standard library and plain files so it can be exercised against any directory of shader sources.
+	class ShaderIncludeGraph
+	{
+	public:
+		// Parses every .hlsl/.hlsli below a_root, replacing any previous graph
+		void Build(const std::filesystem::path& a_root);
+		// Re-parses a single file after it was created, edited or deleted
+		void Update(const std::filesystem::path& a_file);
+		// Returns the keys of a_file and of every file that includes it directly or indirectly
+		std::unordered_set<std::string> GetAffectedFiles(const std::filesystem::path& a_file) const;
+		// Returns the lowercase names of the top level shaders (e.g. "lighting" for Lighting.hlsl) that include a_file directly or indirectly
+		std::unordered_set<std::string> GetAffectedShaders(const std::filesystem::path& a_file) const;
+		// Lowercase path relative to the root with forward slashes, so a compute shader path such as
+		// Data\Shaders\LightLimitFix\ClusterCullingCS.hlsl maps to the same key as the file found by Build
+		std::string GetKey(const std::filesystem::path& a_file) const;
+
+		static bool IsShaderSource(const std::filesystem::path& a_file);
+		static std::vector<std::string> ParseIncludes(const std::filesystem::path& a_file);
+
+	private:
+		std::string ResolveInclude(const std::string& a_includerKey, const std::string& a_include) const;
+		void RemoveEdges(const std::string& a_key);
+
+		std::filesystem::path root;
+		std::unordered_map<std::string, std::unordered_set<std::string>> includes;    // file -> files it includes
+		std::unordered_map<std::string, std::unordered_set<std::string>> includedBy;  // file -> files including it
+	};
+}
@@ -0,0 +1,116 @@
+#include "TaskStateTable.h"
+
+#include <vector>
+
+namespace SIE
+{
+	std::atomic<uint64_t>* TaskStateTable::Find(size_t a_id) const
+	{
+		auto index = static_cast<size_t>((a_id * 0x9E3779B97F4A7C15ull) >> 32) & (Capacity - 1);
+		for (size_t probe = 0; probe < MaxProbe; probe++, index = (index + 1) & (Capacity - 1)) {
+			auto& slot = slots[index];
+			auto word = slot.load(std::memory_order_acquire);
+			if (!word || (word & KeyMask) == a_id)
+				return &slot;
+		}
+		return nullptr;
+	}
+
+	TaskStateTable::State TaskStateTable::Get(size_t a_id) const
+	{
+		if (auto slot = Find(a_id)) {
+			auto word = slot->load(std::memory_order_acquire);
+			return (word & KeyMask) == a_id ? GetState(word) : State::None;
+		}
+		std::scoped_lock lock{ overflowMutex };
+		auto it = overflow.find(a_id);
+		return it != overflow.end() ? GetState(it->second) : State::None;
+	}
+
+	bool TaskStateTable::IsTierUp(size_t a_id) const
+	{
+		if (auto slot = Find(a_id)) {
+			auto word = slot->load(std::memory_order_acquire);
+			return (word & KeyMask) == a_id && (word & TierUpBit);
+		}
+		std::scoped_lock lock{ overflowMutex };
+		auto it = overflow.find(a_id);
+		return it != overflow.end() && (it->second & TierUpBit);
+	}
+
+	bool TaskStateTable::TryInsert(size_t a_id, State a_state, bool a_tierUp)
+	{
+		const uint64_t desired = a_id | UsedBit | (static_cast<uint64_t>(a_state) << StateShift) | (a_tierUp ? TierUpBit : 0);
+		while (auto slot = Find(a_id)) {
+			auto word = slot->load(std::memory_order_acquire);
+			if (word && (word & StateMask))
+				return false;
+			// either an empty slot or this id after it was reset, another thread may race us to it and Find then returns its slot or the next one
+			if (slot->compare_exchange_weak(word, desired, std::memory_order_acq_rel))
+				return true;
+		}
+
+		std::scoped_lock lock{ overflowMutex };
+		auto [it, inserted] = overflow.try_emplace(a_id, desired);
+		if (!inserted) {
+			if (it->second & StateMask)
+				return false;
+			it->second = desired;
+		}
+		return true;
+	}
+
+	bool TaskStateTable::Transition(size_t a_id, State a_from, State a_to)
+	{
+		if (auto slot = Find(a_id)) {
+			auto word = slot->load(std::memory_order_acquire);
+			do {
+				if ((word & KeyMask) != a_id || GetState(word) != a_from)
+					return false;
+			} while (!slot->compare_exchange_weak(word, (word & ~StateMask) | (static_cast<uint64_t>(a_to) << StateShift), std::memory_order_acq_rel));
+			return true;
+		}
+
+		std::scoped_lock lock{ overflowMutex };
+		auto it = overflow.find(a_id);
+		if (it == overflow.end() || GetState(it->second) != a_from)
+			return false;
+		it->second = (it->second & ~StateMask) | (static_cast<uint64_t>(a_to) << StateShift);
+		return true;
+	}
+
+	void TaskStateTable::ForEach(const std::function<void(size_t, State)>& a_func) const
+	{
+		for (size_t i = 0; i < Capacity; i++) {
+			auto word = slots[i].load(std::memory_order_acquire);
+			if (word & StateMask)
+				a_func(word & KeyMask, GetState(word));
+		}
+
+		// a_func may call back into the table, so it runs on a copy
+		std::vector<uint64_t> overflowWords;
+		{
+			std::scoped_lock lock{ overflowMutex };
+			for (auto& [id, word] : overflow)
+				overflowWords.push_back(word);
+		}
+		for (auto word : overflowWords) {
+			if (word & StateMask)
+				a_func(word & KeyMask, GetState(word));
+		}
+	}
+
+	void TaskStateTable::Clear()
+	{
+		for (size_t i = 0; i < Capacity; i++)
+			slots[i].store(0, std::memory_order_relaxed);
+		std::scoped_lock lock{ overflowMutex };
+		overflow.clear();
+	}
+
+	size_t TaskStateTable::GetOverflowCount() const
+	{
+		std::scoped_lock lock{ overflowMutex };
+		return overflow.size();
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace SIE
+{
+	// Lock-free state of every task id seen so far. Open addressing with linear probing keeps memory proportional to the descriptors in use,
+	// entries are only ever reset to None so probe chains stay intact until Clear. Probing stops after MaxProbe slots, ids whose window is
+	// already full go to a locked overflow map instead, so a crowded table degrades to a lock rather than to scanning every slot.
+	// Only depends on the standard library so it can be tested and benchmarked outside the game.
+	class TaskStateTable
+	{
+	public:
+		enum class State : uint8_t
+		{
+			None,
+			Queued,
+			InFlight,
+			Done,
+		};
+
+		static constexpr size_t Capacity = 1 << 17;  // power of two
+		static constexpr size_t MaxProbe = 64;
+
+		State Get(size_t a_id) const;
+		bool IsTierUp(size_t a_id) const;
+		// Moves a new or reset id into a_state, false if it already has a state
+		bool TryInsert(size_t a_id, State a_state, bool a_tierUp = false);
+		bool Transition(size_t a_id, State a_from, State a_to);
+		// Calls a_func(id, state) for every id with a state, concurrent changes may or may not be seen
+		void ForEach(const std::function<void(size_t, State)>& a_func) const;
+		void Clear();
+		size_t GetOverflowCount() const;
+
+	private:
+		// task ids leave bits 36 to 59 unused, the state and markers live there. The used bit keeps the slot of a reset id 0 from looking empty.
+		static constexpr int StateShift = 56;
+		static constexpr uint64_t StateMask = 0x3ull << StateShift;
+		static constexpr uint64_t TierUpBit = 1ull << 58;
+		static constexpr uint64_t UsedBit = 1ull << 59;
+		static constexpr uint64_t KeyMask = ~(StateMask | TierUpBit | UsedBit);
+
+		static State GetState(uint64_t a_word) { return static_cast<State>((a_word & StateMask) >> StateShift); }
+
+		// The slot holding a_id or the empty slot it would go in, nullptr when its probe window is full of other ids.
+		// Slots never go back to empty before Clear, so an id that overflowed once always overflows.
+		std::atomic<uint64_t>* Find(size_t a_id) const;
+
+		std::unique_ptr<std::atomic<uint64_t>[]> slots = std::make_unique<std::atomic<uint64_t>[]>(Capacity);
+
+		std::unordered_map<size_t, uint64_t> overflow;  // id to the same word as a slot would hold
+		mutable std::mutex overflowMutex;
+	};
+}
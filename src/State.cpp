@@ -21,6 +21,10 @@ void State::Draw()
 
 				auto context = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().context;
 
+				// only permutations actually drawn count towards the ready set, LoadShaders requests every one the game ships
+				shaderCache.RecordUsage(SIE::ShaderClass::Vertex, *currentShader, currentVertexDescriptor);
+				shaderCache.RecordUsage(SIE::ShaderClass::Pixel, *currentShader, currentPixelDescriptor);
+
 				if (auto vertexShader = shaderCache.GetVertexShader(*currentShader, currentVertexDescriptor)) {
 					context->VSSetShader(vertexShader->shader, NULL, NULL);
 				}
@@ -107,6 +111,16 @@ void State::Reset()
 
 void State::Setup()
 {
+	// Compile every feature compute shader up front and in parallel, so SetupResources and first use hit the cache
+	std::vector<SIE::ComputeShaderDesc> computeShaders;
+	for (auto* feature : Feature::GetFeatureList()) {
+		if (feature->loaded) {
+			auto descs = feature->GetComputeShaderDescs();
+			computeShaders.insert(computeShaders.end(), descs.begin(), descs.end());
+		}
+	}
+	SIE::ShaderCache::Instance().CompileComputeShaders(computeShaders);
+
 	for (auto* feature : Feature::GetFeatureList())
 		if (feature->loaded)
 			feature->SetupResources();
@@ -169,6 +183,9 @@ void State::Load(bool a_test)
 
 		if (general["Enable Async"].is_boolean())
 			shaderCache.SetAsync(general["Enable Async"]);
+
+		if (general["Enable Tiered Compilation"].is_boolean())
+			shaderCache.SetTieredCompilation(general["Enable Tiered Compilation"]);
 	}
 
 	if (settings["Replace Original Shaders"].is_object()) {
@@ -216,6 +233,7 @@ void State::Save(bool a_test)
 	general["Enable Shaders"] = shaderCache.IsEnabled();
 	general["Enable Disk Cache"] = shaderCache.IsDiskCache();
 	general["Enable Async"] = shaderCache.IsAsync();
+	general["Enable Tiered Compilation"] = shaderCache.IsTieredCompilation();
 
 	settings["General"] = general;
 
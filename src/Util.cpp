@@ -1,4 +1,5 @@
 #include "Util.h"
+#include "ShaderCache.h"
 #include "State.h"
 
 #include <d3dcompiler.h>
@@ -111,6 +112,14 @@ namespace Util
 
 	ID3D11DeviceChild* CompileShader(const wchar_t* FilePath, const std::vector<std::pair<const char*, const char*>>& Defines, const char* ProgramType, const char* Program)
 	{
+		// Compute shaders are cached in memory and on disk by the shader cache
+		if (!_strnicmp(ProgramType, "cs_", 3)) {
+			SIE::ComputeShaderDesc desc{ FilePath, {}, Program, ProgramType };
+			for (auto& [name, value] : Defines)
+				desc.defines.push_back({ name, value });
+			return SIE::ShaderCache::Instance().GetComputeShader(desc);
+		}
+
 		auto device = RE::BSGraphics::Renderer::GetSingleton()->GetRuntimeData().forwarder;
 
 		// Build defines (aka convert vector->D3DCONSTANT array)
@@ -117,9 +117,7 @@ void MessageHandler(SKSE::MessagingInterface::Message* message)
 
 				auto& shaderCache = SIE::ShaderCache::Instance();
 				shaderCache.menuLoaded = true;
-				while (shaderCache.IsCompiling() && !shaderCache.backgroundCompilation) {
-					std::this_thread::sleep_for(100ms);
-				}
+				shaderCache.WaitForReadySet();
 
 				if (shaderCache.IsDiskCache()) {
 					shaderCache.WriteDiskCacheInfo();
@@ -132,6 +130,14 @@ void MessageHandler(SKSE::MessagingInterface::Message* message)
 				}
 			}
 
+			break;
+		}
+	case SKSE::MessagingInterface::kPostLoadGame:
+	case SKSE::MessagingInterface::kNewGame:
+		{
+			if (errors.empty())
+				SIE::ShaderCache::Instance().FinishUsageRecording();
+
 			break;
 		}
 	}
@@ -0,0 +1,150 @@
+#include <Features/LightLimitFIx/ClusterLightCulling.h>
+
+#include <random>
+#include <vector>
+
+#include "Test.h"
+
+using namespace ClusterLightCulling;
+
+static std::vector<ClusterAABB> MakeClusters(std::uint32_t a_x, std::uint32_t a_y, std::uint32_t a_z)
+{
+	// a regular grid of 100 unit cells, ordered like ClusterBuildingCS
+	std::vector<ClusterAABB> clusters;
+	for (std::uint32_t z = 0; z < a_z; z++) {
+		for (std::uint32_t y = 0; y < a_y; y++) {
+			for (std::uint32_t x = 0; x < a_x; x++)
+				clusters.push_back({ { x * 100.0f, y * 100.0f, z * 100.0f }, { (x + 1) * 100.0f, (y + 1) * 100.0f, (z + 1) * 100.0f } });
+		}
+	}
+	return clusters;
+}
+
+static std::vector<Light> MakeLights(std::uint32_t a_count, float a_extent, std::uint32_t a_seed)
+{
+	std::mt19937 random(a_seed);
+	std::uniform_real_distribution<float> position(-50, a_extent + 50);
+	std::uniform_real_distribution<float> radius(20, 300);
+	std::vector<Light> lights;
+	for (std::uint32_t i = 0; i < a_count; i++)
+		lights.push_back({ { position(random), position(random), position(random) }, radius(random) });
+	// released slots are zeroed and must never be listed
+	lights[a_count / 2].radius = 0;
+	return lights;
+}
+
+struct Result
+{
+	std::vector<LightGrid> grid;
+	std::vector<std::uint32_t> lightList;
+	std::uint32_t total;
+};
+
+static Result Cull(const std::vector<ClusterAABB>& a_clusters, const std::vector<Light>& a_lights, std::uint32_t a_capacity)
+{
+	Result result{ std::vector<LightGrid>(a_clusters.size()), std::vector<std::uint32_t>(a_capacity, ~0u), 0 };
+	CountLights(a_clusters, a_lights, result.grid);
+	result.total = PrefixSum(result.grid, a_capacity);
+	FillLights(a_clusters, a_lights, result.grid, result.lightList);
+	return result;
+}
+
+// Every cluster's list must be exactly the lights that intersect it, in order, packed back to back
+static void CheckAgainstBruteForce(const std::vector<ClusterAABB>& a_clusters, const std::vector<Light>& a_lights, const Result& a_result)
+{
+	std::uint32_t expectedOffset = 0;
+	bool listMatches = true;
+	for (size_t c = 0; c < a_clusters.size(); c++) {
+		std::vector<std::uint32_t> expected;
+		for (std::uint32_t l = 0; l < a_lights.size(); l++) {
+			if (a_lights[l].radius > 0 && LightIntersectsCluster(a_lights[l], a_clusters[c]))
+				expected.push_back(l);
+		}
+		listMatches &= a_result.grid[c].offset == expectedOffset && a_result.grid[c].lightCount == expected.size();
+		for (size_t i = 0; i < expected.size() && listMatches; i++)
+			listMatches &= a_result.lightList[expectedOffset + i] == expected[i];
+		expectedOffset += (std::uint32_t)expected.size();
+	}
+	CHECK(listMatches);
+	CHECK(a_result.total == expectedOffset);
+}
+
+static void TestClamp()
+{
+	CHECK(ClampClusterSize(0) == 1);
+	CHECK(ClampClusterSize(16) == 16);
+	CHECK(ClampClusterSize(64) == 64);
+	CHECK(ClampClusterSize(1000) == 64);
+}
+
+static void TestSmallGrid()
+{
+	auto clusters = MakeClusters(4, 4, 4);
+	auto lights = MakeLights(50, 400, 1);
+	auto result = Cull(clusters, lights, 64 * 50);
+	CheckAgainstBruteForce(clusters, lights, result);
+}
+
+static void TestGridLargerThanPrefixGroup()
+{
+	// more clusters than prefix sum threads, and not a multiple of them, so each thread sums a run of several
+	auto clusters = MakeClusters(17, 13, 11);
+	CHECK(clusters.size() > PrefixSumGroupSize);
+	auto lights = MakeLights(120, 1700, 2);
+	auto result = Cull(clusters, lights, 200000);
+	CheckAgainstBruteForce(clusters, lights, result);
+
+	auto largest = MakeClusters(64, 64, 64);
+	auto fewLights = MakeLights(20, 6400, 3);
+	result = Cull(largest, fewLights, 1 << 20);
+	CheckAgainstBruteForce(largest, fewLights, result);
+}
+
+static void TestTruncation()
+{
+	auto clusters = MakeClusters(8, 8, 8);
+	auto lights = MakeLights(200, 800, 4);
+	auto full = Cull(clusters, lights, 1 << 20);
+	CHECK(full.total > 100);
+
+	// with a list too small the total is still reported, so the list can grow, and nothing is written past the end
+	std::uint32_t capacity = full.total / 3;
+	auto truncated = Cull(clusters, lights, capacity);
+	CHECK(truncated.total == full.total);
+	std::uint32_t written = 0;
+	for (size_t c = 0; c < clusters.size(); c++) {
+		auto& grid = truncated.grid[c];
+		CHECK(grid.offset == full.grid[c].offset);
+		CHECK(grid.lightCount <= full.grid[c].lightCount);
+		CHECK(grid.lightCount == 0 || grid.offset + grid.lightCount <= capacity);
+		// a truncated cluster keeps the first of its lights
+		for (std::uint32_t i = 0; i < grid.lightCount; i++)
+			CHECK(truncated.lightList[grid.offset + i] == full.lightList[grid.offset + i]);
+		written += grid.lightCount;
+	}
+	CHECK(written == capacity);
+
+	// growing as UpdateLightListCapacity does gets the complete list on the next frame
+	auto grown = Cull(clusters, lights, truncated.total + truncated.total / 2);
+	CheckAgainstBruteForce(clusters, lights, grown);
+}
+
+static void TestNoLights()
+{
+	auto clusters = MakeClusters(4, 4, 4);
+	std::vector<Light> lights(3);  // all released
+	auto result = Cull(clusters, lights, 1);
+	CHECK(result.total == 0);
+	for (auto& grid : result.grid)
+		CHECK(grid.lightCount == 0);
+}
+
+int main()
+{
+	TestClamp();
+	TestSmallGrid();
+	TestGridLargerThanPrefixGroup();
+	TestTruncation();
+	TestNoLights();
+	return Test::Finish();
+}
@@ -0,0 +1,154 @@
+// Simulates the positional error of grass colliders between refreshes, holding the last refreshed position as before
+// against extrapolating it, on ground-truth trajectories sampled at 60 fps.
+#include <Features/GrassCollision/ColliderExtrapolation.h>
+
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "Test.h"
+#include "Vector3.h"
+
+using Trajectory = std::function<Vector3(double)>;
+
+struct Error
+{
+	double mean = 0;
+	double max = 0;
+	std::uint32_t refreshes = 0;
+};
+
+constexpr double FrameTime = 1.0 / 60.0;
+constexpr double Duration = 6.0;
+
+// a_interval of 0 uses the adaptive interval with a_adaptiveDistance. The error is measured once the first velocity is known.
+static Error Simulate(const Trajectory& a_trajectory, std::uint32_t a_interval, bool a_extrapolate, float a_adaptiveDistance = 8.0f, double a_measureAfter = 1.0)
+{
+	Error error;
+	Vector3 centre, velocity;
+	double lastRefreshTime = 0;
+	std::uint32_t lastRefreshFrame = 0;
+	bool refreshed = false;
+	bool velocityMeasured = false;
+	std::uint32_t measured = 0;
+
+	auto frames = (std::uint32_t)(Duration / FrameTime);
+	for (std::uint32_t frame = 1; frame <= frames; frame++) {
+		double time = frame * FrameTime;
+		std::uint32_t interval = a_interval ? a_interval : ColliderExtrapolation::GetAdaptiveInterval(velocityMeasured, velocity.Length(), (float)FrameTime, a_adaptiveDistance);
+		bool refresh = !refreshed || (a_interval ? frame - lastRefreshFrame >= a_interval : frame - lastRefreshFrame > interval);
+		if (refresh) {
+			auto current = a_trajectory(time);
+			velocityMeasured = refreshed && ColliderExtrapolation::GetVelocity(centre, current, (float)(time - lastRefreshTime), velocity);
+			centre = current;
+			lastRefreshTime = time;
+			lastRefreshFrame = frame;
+			refreshed = true;
+			error.refreshes++;
+		}
+
+		auto estimate = a_extrapolate ? ColliderExtrapolation::Extrapolate(centre, velocity, (float)(time - lastRefreshTime)) : centre;
+		if (time > a_measureAfter) {
+			double distance = (estimate - a_trajectory(time)).Length();
+			error.mean += distance;
+			error.max = std::max(error.max, distance);
+			measured++;
+		}
+	}
+	error.mean /= measured;
+	return error;
+}
+
+static Vector3 Run(double a_time) { return { (float)(a_time * 400), 0, 0 }; }
+
+static Vector3 Circle(double a_time)
+{
+	// strafing around a target, 300 units/s on a 300 unit radius
+	return { (float)(std::cos(a_time) * 300), (float)(std::sin(a_time) * 300), 0 };
+}
+
+static Vector3 StartStop(double a_time)
+{
+	// walks for a second, stands for a second
+	double cycle = std::floor(a_time / 2);
+	double phase = std::min(a_time - cycle * 2, 1.0);
+	return { (float)((cycle + phase) * 250), 0, 0 };
+}
+
+static Vector3 Bobbing(double a_time)
+{
+	// walking with the up and down of the animation on top
+	return { (float)(a_time * 250), 0, (float)(std::sin(a_time * 12) * 5) };
+}
+
+static Vector3 Teleport(double a_time)
+{
+	return { (float)(a_time * 200 + (a_time > 2 ? 5000 : 0)), 0, 0 };
+}
+
+int main()
+{
+	struct Case
+	{
+		const char* name;
+		Trajectory trajectory;
+	};
+	std::vector<Case> cases = { { "run", Run }, { "circle", Circle }, { "start-stop", StartStop }, { "bobbing", Bobbing }, { "teleport", Teleport } };
+
+	std::printf("%-11s %9s %12s %12s %12s %12s\n", "trajectory", "interval", "hold mean", "hold max", "extrap mean", "extrap max");
+	for (auto& [name, trajectory] : cases) {
+		for (std::uint32_t interval : { 2u, 4u, 8u, 0u }) {
+			auto hold = Simulate(trajectory, interval, false);
+			auto extrapolated = Simulate(trajectory, interval, true);
+			std::printf("%-11s %9s %12.3f %12.3f %12.3f %12.3f\n", name, interval ? std::to_string(interval).c_str() : "adaptive", hold.mean, hold.max, extrapolated.mean, extrapolated.max);
+
+			if (trajectory.target<Vector3 (*)(double)>() && *trajectory.target<Vector3 (*)(double)>() == Teleport)
+				continue;
+			// extrapolating is never worse on average than holding the last position
+			CHECK(extrapolated.mean <= hold.mean + 1e-3);
+		}
+	}
+
+	// constant velocity is followed exactly
+	for (std::uint32_t interval : { 2u, 4u, 8u }) {
+		CHECK(Simulate(Run, interval, true).max < 0.1);
+		CHECK(Simulate(Run, interval, false).mean > 400 * FrameTime * (interval - 1) / 2 * 0.9);
+	}
+
+	// on a curve the error is a fraction of holding the position
+	CHECK(Simulate(Circle, 8, true).mean < Simulate(Circle, 8, false).mean * 0.25);
+
+	// after stopping, the overshoot is bounded by one refresh interval of travel
+	CHECK(Simulate(StartStop, 8, true).max <= 250 * FrameTime * 8 + 1);
+
+	// a teleport never produces a velocity, so the error only lasts until the next refresh, which is the next frame when adaptive
+	for (std::uint32_t interval : { 2u, 4u, 8u, 0u }) {
+		// at 200 units/s the adaptive interval is 2 frames, so the teleport is seen within 3
+		auto error = Simulate(Teleport, interval, true, 8.0f, 2.0 + FrameTime * ((interval ? interval : 3) + 1));
+		CHECK(error.max < 200 * FrameTime * std::max(interval, 2u) * 2 + 1);
+	}
+
+	// the adaptive interval refreshes a fast actor often and a slow one rarely, holding the error near the adaptive distance
+	auto adaptiveRun = Simulate(Run, 0, false, 8.0f);
+	CHECK(adaptiveRun.max <= 8.0f + 400 * FrameTime * 2);
+	// from the moment an actor is first seen, not after the maximum interval
+	CHECK(Simulate(Run, 0, false, 8.0f, 0.0).max <= 8.0f + 400 * FrameTime * 2);
+	// an actor that starts moving after standing still is only caught at the next refresh, up to the maximum interval
+	CHECK(Simulate(StartStop, 0, true, 8.0f).max <= 250 * FrameTime * ColliderExtrapolation::MaxAdaptiveInterval);
+	auto adaptiveStand = Simulate([](double) { return Vector3{ 10, 20, 30 }; }, 0, true, 8.0f);
+	CHECK(adaptiveStand.refreshes <= Duration / FrameTime / ColliderExtrapolation::MaxAdaptiveInterval + 2);
+	CHECK(adaptiveStand.max < 1e-3);
+
+	// extrapolation time is capped, a collider that stops being refreshed does not fly off
+	Vector3 far = ColliderExtrapolation::Extrapolate(Vector3{}, Vector3{ 1000, 0, 0 }, 10.0f);
+	CHECK_NEAR(far.x, 1000 * ColliderExtrapolation::MaxExtrapolationTime, 1e-3);
+	// and a jump faster than any actor is not a velocity
+	Vector3 velocity{ 1, 1, 1 };
+	CHECK(!ColliderExtrapolation::GetVelocity(Vector3{}, Vector3{ 100, 0, 0 }, 0.01f, velocity));
+	CHECK(velocity.Length() == 0);
+	CHECK(ColliderExtrapolation::GetVelocity(Vector3{}, Vector3{ 10, 0, 0 }, 0.01f, velocity));
+	CHECK_NEAR(velocity.x, 1000, 1e-2);
+	CHECK(!ColliderExtrapolation::GetVelocity(Vector3{}, Vector3{ 10, 0, 0 }, 0.0f, velocity));
+
+	return Test::Finish();
+}
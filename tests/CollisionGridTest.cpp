@@ -0,0 +1,141 @@
+#include <Features/GrassCollision/CollisionGrid.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "Vector3.h"
+
+struct Collider
+{
+	Vector3 centre[2];
+	float radius;
+};
+
+static std::vector<Collider> MakeColliders(std::uint32_t a_count, float a_extent, std::uint32_t a_seed)
+{
+	std::mt19937 random(a_seed);
+	std::uniform_real_distribution<float> position(-a_extent, a_extent);
+	std::uniform_real_distribution<float> radius(10, 120);
+	std::vector<Collider> colliders;
+	for (std::uint32_t i = 0; i < a_count; i++) {
+		Vector3 centre{ position(random), position(random), position(random) / 10 };
+		colliders.push_back({ { centre, centre + Vector3{ 3, 0, 0 } }, radius(random) });
+	}
+	return colliders;
+}
+
+// Every collider that can displace a vertex, at a 3D distance under its radius as in GrassCollision.hlsli,
+// must be in the vertex's cell, once, and the cell must not hold colliders that cannot reach it at all
+static void CheckAgainstBruteForce(const std::vector<Collider>& a_colliders, std::uint32_t a_gridSize, std::uint32_t a_seed)
+{
+	CollisionGrid::Grid grid;
+	CollisionGrid::Build(std::span<const Collider>(a_colliders), a_gridSize, grid);
+
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+	for (auto& collider : a_colliders) {
+		if (collider.radius <= 0)
+			continue;
+		minX = std::min(minX, collider.centre[0].x - collider.radius);
+		maxX = std::max(maxX, collider.centre[0].x + collider.radius);
+		minY = std::min(minY, collider.centre[0].y - collider.radius);
+		maxY = std::max(maxY, collider.centre[0].y + collider.radius);
+	}
+
+	std::mt19937 random(a_seed);
+	std::uniform_real_distribution<float> x(minX - 100, maxX + 100), y(minY - 100, maxY + 100), z(-200, 200);
+	std::uint32_t missing = 0, duplicates = 0, unreachable = 0;
+	for (int i = 0; i < 20000; i++) {
+		Vector3 vertex{ x(random), y(random), z(random) };
+		// also sample right around colliders, where misses would matter
+		if (i % 2 && !a_colliders.empty()) {
+			auto& collider = a_colliders[random() % a_colliders.size()];
+			vertex = collider.centre[0] + Vector3{ x(random) / (maxX - minX + 200) * collider.radius, y(random) / (maxY - minY + 200) * collider.radius, 0 };
+		}
+
+		auto candidates = CollisionGrid::GetColliders(grid, vertex.x, vertex.y);
+		std::vector<std::uint32_t> sorted(candidates.begin(), candidates.end());
+		std::sort(sorted.begin(), sorted.end());
+		duplicates += std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end();
+
+		for (std::uint32_t c = 0; c < a_colliders.size(); c++) {
+			auto& collider = a_colliders[c];
+			bool displaces = collider.radius > 0 && (vertex - collider.centre[0]).Length() < collider.radius;
+			bool listed = std::binary_search(sorted.begin(), sorted.end(), c);
+			missing += displaces && !listed;
+		}
+
+		for (auto c : sorted) {
+			auto& collider = a_colliders[c];
+			// the cell of the vertex must overlap the collider's XY bound
+			float cellMinX = grid.minX + std::floor((vertex.x - grid.minX) / grid.cellSize) * grid.cellSize;
+			float cellMinY = grid.minY + std::floor((vertex.y - grid.minY) / grid.cellSize) * grid.cellSize;
+			bool overlaps = collider.centre[0].x + collider.radius >= cellMinX - 1e-2f && collider.centre[0].x - collider.radius <= cellMinX + grid.cellSize + 1e-2f &&
+			                collider.centre[0].y + collider.radius >= cellMinY - 1e-2f && collider.centre[0].y - collider.radius <= cellMinY + grid.cellSize + 1e-2f;
+			unreachable += collider.radius <= 0 || !overlaps;
+		}
+	}
+	CHECK(missing == 0);
+	CHECK(duplicates == 0);
+	CHECK(unreachable == 0);
+
+	// every collider appears once per cell it covers and never more often than cells exist
+	std::vector<std::uint32_t> uses(a_colliders.size());
+	for (auto index : grid.indices)
+		uses[index]++;
+	for (std::uint32_t c = 0; c < a_colliders.size(); c++) {
+		if (a_colliders[c].radius > 0)
+			CHECK(uses[c] >= 1 && uses[c] <= a_gridSize * a_gridSize);
+		else
+			CHECK(uses[c] == 0);
+	}
+}
+
+static void TestEmpty()
+{
+	CollisionGrid::Grid grid;
+	std::vector<Collider> colliders(1);  // the zeroed placeholder UpdateCollisions uploads when there is nothing
+	CHECK(CollisionGrid::Build(std::span<const Collider>(colliders), 16, grid) == 1);
+	CHECK(grid.cellSize == 0);
+	CHECK(grid.indices.empty());
+	CHECK(grid.cells.size() == 256);
+	CHECK(CollisionGrid::GetColliders(grid, 0, 0).empty());
+}
+
+static void TestSingle()
+{
+	std::vector<Collider> colliders = { { { Vector3{ 100, 200, 0 }, Vector3{ 100, 200, 0 } }, 50 } };
+	CollisionGrid::Grid grid;
+	CHECK(CollisionGrid::Build(std::span<const Collider>(colliders), 16, grid) == 0);
+	// the grid covers only the collider, the cell size is floored at one unit
+	CHECK_NEAR(grid.minX, 50, 1e-4);
+	CHECK_NEAR(grid.minY, 150, 1e-4);
+	CHECK_NEAR(grid.cellSize, 100.0 / 16, 1e-4);
+	CHECK(CollisionGrid::GetColliders(grid, 100, 200).size() == 1);
+	CHECK(CollisionGrid::GetColliders(grid, 300, 200).empty());
+	CheckAgainstBruteForce(colliders, 16, 1);
+}
+
+static void TestRandom()
+{
+	CheckAgainstBruteForce(MakeColliders(8, 500, 2), 16, 3);
+	CheckAgainstBruteForce(MakeColliders(64, 2000, 4), 16, 5);
+	// one collider spanning most of the area, as a dragon or mammoth would
+	auto colliders = MakeColliders(40, 1500, 6);
+	colliders[7].radius = 1200;
+	CheckAgainstBruteForce(colliders, 16, 7);
+	// placeholder entries without a radius mixed in
+	colliders[3].radius = 0;
+	colliders[20].radius = 0;
+	CheckAgainstBruteForce(colliders, 16, 8);
+	CheckAgainstBruteForce(colliders, 1, 9);
+}
+
+int main()
+{
+	TestEmpty();
+	TestSingle();
+	TestRandom();
+	return Test::Finish();
+}
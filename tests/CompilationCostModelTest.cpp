@@ -0,0 +1,205 @@
+// Simulates a cold compile of a synthetic permutation population on a fixed number of compiler threads, with a cost model
+// learned from a noisy previous session. Compares the makespan of the previous unordered queue with longest estimate first,
+// and the accuracy of the previous completed task rate ETA with the cost model ETA, at points through the compile.
+#include <ShaderTools/CompilationCostModel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+
+struct Permutation
+{
+	CompilationCostModel::Key key;
+	double trueMs;   // what it costs this session
+	double modelMs;  // what the cost model expects
+};
+
+struct Population
+{
+	const char* name;
+	size_t techniques;
+	size_t permutations;
+	double sigma;         // spread of technique costs, parallax and friends sit in the long tail
+	double sessionSpeed;  // this session against the one the model learned from, the game loads alongside and machines differ
+};
+
+static std::vector<Permutation> Generate(const Population& a_population, std::mt19937_64& a_random, CompilationCostModel& o_model)
+{
+	std::lognormal_distribution<double> techniqueCost(std::log(250.0), a_population.sigma);
+	std::lognormal_distribution<double> permutationSpread(0.0, 0.3);
+	std::lognormal_distribution<double> sessionNoise(0.0, 0.2);
+	std::lognormal_distribution<double> jitter(0.0, 0.1);
+	std::uniform_real_distribution<double> unit(0, 1);
+
+	std::vector<double> techniqueMs(a_population.techniques);
+	for (auto& ms : techniqueMs)
+		ms = techniqueCost(a_random);
+
+	std::vector<Permutation> permutations;
+	for (size_t i = 0; i < a_population.permutations; i++) {
+		auto technique = i % a_population.techniques;
+		auto defines = (i / a_population.techniques) % 8;
+		CompilationCostModel::Key key{ technique % 3 ? "Lighting" : "Water", i % 2 ? "Pixel" : "Vertex", "T" + std::to_string(technique),
+			"D" + std::to_string(i), "Optimized" };
+		double baseMs = techniqueMs[technique] * permutationSpread(a_random) * (1.0 + 0.1 * defines) * (i % 2 ? 1.0 : 0.4);
+		// the previous session saw most permutations, the rest fall back to their technique average
+		if (unit(a_random) < 0.8)
+			o_model.Record(key, baseMs * sessionNoise(a_random));
+		permutations.push_back({ key, baseMs * a_population.sessionSpeed * jitter(a_random), 0 });
+	}
+	for (auto& permutation : permutations)
+		permutation.modelMs = o_model.Estimate(permutation.key);
+	return permutations;
+}
+
+struct Schedule
+{
+	double makespan = 0;
+	std::vector<double> finish;  // per task in queue order
+};
+
+// Greedy list scheduling, each thread takes the next queued task as soon as it is free, as the dispatcher does
+static Schedule Run(const std::vector<const Permutation*>& a_queue, int a_threads)
+{
+	std::priority_queue<double, std::vector<double>, std::greater<>> freeAt;
+	for (int i = 0; i < a_threads; i++)
+		freeAt.push(0);
+	Schedule schedule;
+	for (auto* permutation : a_queue) {
+		auto start = freeAt.top();
+		freeAt.pop();
+		auto finish = start + permutation->trueMs;
+		schedule.finish.push_back(finish);
+		schedule.makespan = std::max(schedule.makespan, finish);
+		freeAt.push(finish);
+	}
+	return schedule;
+}
+
+struct EtaError
+{
+	double rateError = 0;   // previous GetEta, completed tasks per elapsed ms
+	double modelError = 0;  // CompilationCostModel::GetEta
+};
+
+// Mean relative error of both ETAs against the real time left, sampled from 10% to 80% of the compile
+static EtaError MeasureEta(const std::vector<const Permutation*>& a_queue, const Schedule& a_schedule, int a_threads)
+{
+	EtaError error;
+	int samples = 0;
+	for (double fraction = 0.1; fraction < 0.85; fraction += 0.1) {
+		double elapsed = a_schedule.makespan * fraction;
+		double remainingMs = 0, completedMs = 0;
+		size_t completed = 0;
+		for (size_t i = 0; i < a_queue.size(); i++) {
+			if (a_schedule.finish[i] <= elapsed) {
+				completedMs += a_queue[i]->modelMs;
+				completed++;
+			} else {
+				remainingMs += a_queue[i]->modelMs;
+			}
+		}
+		if (!completed)
+			continue;
+		double actual = a_schedule.makespan - elapsed;
+		double rateEta = (a_queue.size() - completed) / (completed / elapsed);
+		double modelEta = CompilationCostModel::GetEta(remainingMs, completedMs, elapsed, a_threads);
+		error.rateError += std::abs(rateEta - actual) / actual;
+		error.modelError += std::abs(modelEta - actual) / actual;
+		samples++;
+	}
+	error.rateError /= samples;
+	error.modelError /= samples;
+	return error;
+}
+
+int main()
+{
+	// the model falls back from the permutation to its technique, then its type, then the heuristic
+	{
+		CompilationCostModel model;
+		CHECK(model.IsEmpty());
+		CompilationCostModel::Key known{ "Lighting", "Pixel", "Parallax", "A B", "Optimized" };
+		CompilationCostModel::Key sameTechnique{ "Lighting", "Pixel", "Parallax", "A B C", "Optimized" };
+		CompilationCostModel::Key sameType{ "Lighting", "Pixel", "Envmap", "A", "Optimized" };
+		CompilationCostModel::Key unknown{ "Sky", "Vertex", "Sky", "", "Fast" };
+		double heuristic = model.Estimate(unknown);
+		CHECK(heuristic > 0);
+		model.Record(known, 1000);
+		model.Record({ "Lighting", "Pixel", "Parallax", "A", "Optimized" }, 2000);
+		CHECK_NEAR(model.Estimate(known), 1000, 1e-9);
+		CHECK_NEAR(model.Estimate(sameTechnique), 1500, 1e-9);
+		CHECK_NEAR(model.Estimate(sameType), 1500, 1e-9);
+		CHECK_NEAR(model.Estimate(unknown), heuristic, 1e-9);
+		// a moving average, so it follows changes to the shaders
+		model.Record(known, 2000);
+		CHECK_NEAR(model.Estimate(known), 1500, 1e-9);
+		CHECK_NEAR(model.Estimate(sameTechnique), 1750, 1e-9);
+		for (int i = 0; i < 20; i++)
+			model.Record(known, 4000);
+		CHECK(model.Estimate(known) > 3900);
+	}
+
+	// before anything finished the estimate is spread over the threads, afterwards the measured throughput takes over
+	CHECK_NEAR(CompilationCostModel::GetEta(8000, 0, 0, 4), 2000, 1e-9);
+	CHECK_NEAR(CompilationCostModel::GetEta(8000, 2000, 1000, 4), 4000, 1e-9);
+	CHECK_NEAR(CompilationCostModel::GetEta(-5, 2000, 1000, 4), 0, 1e-9);
+
+	std::vector<Population> populations = {
+		{ "uniform", 200, 4000, 0.3, 1.0 },
+		{ "typical", 120, 6000, 1.0, 1.4 },
+		{ "long tail", 60, 3000, 1.6, 0.7 },
+	};
+	std::printf("%10s %8s %12s %12s %12s %12s %12s %12s\n", "costs", "threads", "bound s", "previous s", "longest s", "rate ETA", "model ETA", "rate ETA*");
+	for (auto& population : populations) {
+		for (int threads : { 4, 8, 16 }) {
+			std::mt19937_64 random(threads * 31 + population.techniques);
+			CompilationCostModel model;
+			auto permutations = Generate(population, random, model);
+
+			std::vector<const Permutation*> previous;
+			for (auto& permutation : permutations)
+				previous.push_back(&permutation);
+			// the previous queue was an unordered_set, so tasks came out in hash order
+			std::shuffle(previous.begin(), previous.end(), random);
+
+			// as availableTasks orders them
+			std::multimap<double, const Permutation*, std::greater<>> byEstimate;
+			for (auto& permutation : permutations)
+				byEstimate.emplace(permutation.modelMs, &permutation);
+			std::vector<const Permutation*> longestFirst;
+			for (auto& [ms, permutation] : byEstimate)
+				longestFirst.push_back(permutation);
+
+			double totalMs = 0, maxMs = 0;
+			for (auto& permutation : permutations) {
+				totalMs += permutation.trueMs;
+				maxMs = std::max(maxMs, permutation.trueMs);
+			}
+			double bound = std::max(totalMs / threads, maxMs);
+
+			auto previousSchedule = Run(previous, threads);
+			auto longestSchedule = Run(longestFirst, threads);
+			auto previousEta = MeasureEta(previous, previousSchedule, threads);
+			auto longestEta = MeasureEta(longestFirst, longestSchedule, threads);
+
+			// rate ETA* is the previous ETA under the previous order, what users saw before
+			std::printf("%10s %8d %12.1f %12.1f %12.1f %11.1f%% %11.1f%% %11.1f%%\n", population.name, threads, bound / 1000, previousSchedule.makespan / 1000,
+				longestSchedule.makespan / 1000, longestEta.rateError * 100, longestEta.modelError * 100, previousEta.rateError * 100);
+
+			CHECK(longestSchedule.makespan <= previousSchedule.makespan);
+			// estimates are noisy, so longest first is not optimal, but stays close to the lower bound
+			CHECK(longestSchedule.makespan <= bound * 1.1);
+			// counting tasks misjudges a queue that runs its most expensive work first
+			CHECK(longestEta.modelError < longestEta.rateError);
+			CHECK(longestEta.modelError < 0.15);
+		}
+	}
+	return Test::Finish();
+}
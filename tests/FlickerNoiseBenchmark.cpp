@@ -0,0 +1,157 @@
+// Compares building the four flicker noise generators for every light every frame, as before the cache, with looking
+// them up per geometry, over scenes of flickering particle lights that appear and disappear. Output must be bit identical.
+#include <Features/LightLimitFIx/FlickerNoise.h>
+
+#include <cstring>
+#include <functional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Test.h"
+
+struct Light
+{
+	const void* geometry;
+	float position[3];
+	float color[3];
+};
+
+struct Config
+{
+	float flickerSpeed = 1.5f;
+	float flickerMovement = 2.0f;
+	float flickerIntensity = 0.3f;
+};
+
+// The previous per light code
+static void FlickerUncached(Light& a_light, const Config& a_config, double a_timer)
+{
+	auto seed = (std::uint32_t)std::hash<const void*>{}(a_light.geometry);
+
+	siv::PerlinNoise perlin1{ seed };
+	siv::PerlinNoise perlin2{ seed + 1 };
+	siv::PerlinNoise perlin3{ seed + 2 };
+	siv::PerlinNoise perlin4{ seed + 3 };
+
+	auto scaledTimer = a_timer * a_config.flickerSpeed;
+
+	a_light.position[0] += (float)perlin1.noise1D(scaledTimer) * a_config.flickerMovement;
+	a_light.position[1] += (float)perlin2.noise1D(scaledTimer) * a_config.flickerMovement;
+	a_light.position[2] += (float)perlin3.noise1D(scaledTimer) * a_config.flickerMovement;
+	a_light.color[0] = std::max(0.0f, a_light.color[0] - ((float)perlin4.noise1D_01(scaledTimer) * a_config.flickerIntensity));
+	a_light.color[1] = std::max(0.0f, a_light.color[1] - ((float)perlin4.noise1D_01(scaledTimer) * a_config.flickerIntensity));
+	a_light.color[2] = std::max(0.0f, a_light.color[2] - ((float)perlin4.noise1D_01(scaledTimer) * a_config.flickerIntensity));
+}
+
+struct Cache
+{
+	std::unordered_map<const void*, FlickerNoise::Entry> entries;
+	std::uint64_t hits = 0;
+	std::uint64_t misses = 0;
+};
+
+static void FlickerCached(Cache& a_cache, Light& a_light, const Config& a_config, double a_timer, std::uint32_t a_frame)
+{
+	auto seed = (std::uint32_t)std::hash<const void*>{}(a_light.geometry);
+	auto& flickerNoise = FlickerNoise::Get(a_cache.entries, a_light.geometry, seed, a_frame, a_cache.hits, a_cache.misses);
+	auto flicker = FlickerNoise::Evaluate(flickerNoise, a_timer * a_config.flickerSpeed, a_config.flickerMovement, a_config.flickerIntensity);
+
+	a_light.position[0] += flicker.x;
+	a_light.position[1] += flicker.y;
+	a_light.position[2] += flicker.z;
+	a_light.color[0] = std::max(0.0f, a_light.color[0] - flicker.intensity);
+	a_light.color[1] = std::max(0.0f, a_light.color[1] - flicker.intensity);
+	a_light.color[2] = std::max(0.0f, a_light.color[2] - flicker.intensity);
+}
+
+struct Scene
+{
+	std::uint32_t lights;
+	float churn;  // fraction of geometries replaced each frame, e.g. sparks
+};
+
+static std::vector<std::vector<Light>> Record(const Scene& a_scene, std::uint32_t a_frames)
+{
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> position(-3000, 3000);
+	std::uniform_real_distribution<float> unit(0, 1);
+
+	// geometry pointers only serve as identities and seeds
+	std::uintptr_t nextGeometry = 0x10000;
+	auto makeLight = [&]() {
+		nextGeometry += 0x140;
+		return Light{ (const void*)nextGeometry, { position(random), position(random), position(random) }, { unit(random), unit(random), unit(random) } };
+	};
+
+	std::vector<Light> lights(a_scene.lights);
+	for (auto& light : lights) light = makeLight();
+
+	std::vector<std::vector<Light>> frames(a_frames);
+	for (auto& frame : frames) {
+		for (auto& light : lights) {
+			if (unit(random) < a_scene.churn)
+				light = makeLight();
+		}
+		frame = lights;
+	}
+	return frames;
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = Test::IsQuick(argc, argv);
+	std::uint32_t frameCount = quick ? 10 : 300;
+	std::vector<Scene> scenes = { { 50, 0 }, { 300, 0.01f }, { 1000, 0.05f } };
+	Config config;
+	constexpr double FrameTime = 1.0 / 60.0;
+
+	std::printf("%8s %8s %18s %18s %10s %10s\n", "lights", "churn", "uncached ms/frame", "cached ms/frame", "speedup", "hit rate");
+	for (auto& scene : scenes) {
+		auto frames = Record(scene, frameCount);
+		auto output = frames;
+
+		auto uncachedMs = Test::Time(quick ? 1 : 3, [&]() {
+			for (std::uint32_t frame = 0; frame < frameCount; frame++) {
+				output[frame] = frames[frame];
+				for (auto& light : output[frame])
+					FlickerUncached(light, config, frame * FrameTime);
+			}
+		});
+		auto expected = output;
+
+		Cache cache;
+		auto cachedMs = Test::Time(quick ? 1 : 3, [&]() {
+			cache = {};
+			for (std::uint32_t frame = 0; frame < frameCount; frame++) {
+				output[frame] = frames[frame];
+				for (auto& light : output[frame])
+					FlickerCached(cache, light, config, frame * FrameTime, frame + 1);
+				FlickerNoise::Trim(cache.entries, frame + 1);
+			}
+		});
+
+		bool identical = true;
+		for (std::uint32_t frame = 0; frame < frameCount; frame++)
+			identical &= !std::memcmp(output[frame].data(), expected[frame].data(), expected[frame].size() * sizeof(Light));
+		CHECK(identical);
+
+		double hitRate = 100.0 * cache.hits / (double)(cache.hits + cache.misses);
+		std::printf("%8u %8.2f %18.4f %18.4f %9.1fx %9.1f%%\n", scene.lights, scene.churn, uncachedMs / frameCount, cachedMs / frameCount, uncachedMs / cachedMs, hitRate);
+
+		// with few geometries replaced per frame the cache must pay for itself
+		if (!quick && scene.churn <= 0.01f)
+			CHECK(cachedMs < uncachedMs);
+	}
+
+	// entries are dropped once unused for longer than their lifetime, and kept until then
+	Cache cache;
+	Light light{ (const void*)0x1000, {}, {} };
+	FlickerCached(cache, light, config, 0.0, 1);
+	FlickerNoise::Trim(cache.entries, 1 + FlickerNoise::Lifetime);
+	CHECK(cache.entries.size() == 1);
+	FlickerNoise::Trim(cache.entries, 2 + FlickerNoise::Lifetime);
+	CHECK(cache.entries.empty());
+
+	return Test::Finish();
+}
@@ -0,0 +1,114 @@
+// Checks that an amortized image based lighting refresh runs every step once and in order, swaps the back buffer only after the
+// last mip level, and that a full refresh restarts and completes within one frame. Also checks what counts as a large lighting change.
+#include <Features/DynamicCubemaps/IBLSchedule.h>
+
+#include <vector>
+
+#include "Test.h"
+
+static constexpr std::uint32_t Steps = 10;  // MIPLEVELS in DynamicCubemaps.cpp
+
+int main()
+{
+	// every frame setting covers each step exactly once per refresh, and the swap follows the last step
+	for (std::uint32_t frames = 0; frames <= Steps + 2; frames++) {
+		IBLSchedule schedule;
+		schedule.fullRefresh = false;
+
+		std::uint32_t expectedFrames = (Steps + IBLSchedule::GetStepsPerFrame(Steps, frames) - 1) / IBLSchedule::GetStepsPerFrame(Steps, frames);
+		CHECK(expectedFrames <= std::clamp(frames, 1u, Steps));
+
+		for (int refresh = 0; refresh < 3; refresh++) {
+			std::vector<std::uint32_t> steps;
+			std::uint32_t frameCount = 0;
+			bool swapped = false;
+			while (!swapped && frameCount < 2 * Steps) {
+				swapped = schedule.Advance(Steps, frames, [&](std::uint32_t a_step) { steps.push_back(a_step); });
+				frameCount++;
+				if (!swapped)
+					CHECK(steps.empty() || steps.back() != Steps - 1);
+			}
+			CHECK(swapped);
+			CHECK(steps.back() == Steps - 1);
+			CHECK(frameCount == expectedFrames);
+			CHECK(steps.size() == Steps);
+			for (std::uint32_t i = 0; i < steps.size(); i++)
+				CHECK(steps[i] == i);
+		}
+		CHECK(schedule.refreshCount == 3);
+		CHECK(schedule.fullRefreshCount == 0);
+	}
+
+	// a full refresh in the middle of an amortized one restarts from the snapshot and finishes in the same frame
+	{
+		IBLSchedule schedule;
+		schedule.fullRefresh = false;
+		std::vector<std::uint32_t> steps;
+		auto record = [&](std::uint32_t a_step) { steps.push_back(a_step); };
+		CHECK(!schedule.Advance(Steps, 4, record));
+		CHECK(!schedule.Advance(Steps, 4, record));
+		CHECK(schedule.step == 6);
+
+		steps.clear();
+		schedule.fullRefresh = true;
+		CHECK(schedule.Advance(Steps, 4, record));
+		CHECK(steps.size() == Steps);
+		for (std::uint32_t i = 0; i < steps.size(); i++)
+			CHECK(steps[i] == i);
+		CHECK(!schedule.fullRefresh);
+		CHECK(schedule.step == 0);
+		CHECK(schedule.fullRefreshCount == 1);
+
+		// and amortizing resumes afterwards
+		steps.clear();
+		CHECK(!schedule.Advance(Steps, 4, record));
+		CHECK(steps.size() == 3);
+		CHECK(steps.front() == 0);
+	}
+
+	// a new schedule starts with a full refresh, so the first frame has complete lighting
+	{
+		IBLSchedule schedule;
+		std::uint32_t count = 0;
+		CHECK(schedule.Advance(Steps, Steps, [&](std::uint32_t) { count++; }));
+		CHECK(count == Steps);
+		CHECK(schedule.fullRefreshCount == 1);
+	}
+
+	// walking across exterior cell borders keeps amortizing, other worldspaces, interiors and weather refresh at once
+	{
+		int weather = 0, otherWeather = 0, tamriel = 0, solstheim = 0, interior = 0, otherInterior = 0;
+		IBLSchedule::LightingState outside{ &weather, &tamriel, nullptr, 12.0f };
+
+		auto state = outside;
+		state.hour = 12.1f;
+		CHECK(!IBLSchedule::IsLargeChange(outside, state, 0.5f));
+		CHECK(!IBLSchedule::IsLargeChange(outside, outside, 0.5f));
+
+		state = outside;
+		state.worldspace = &solstheim;
+		CHECK(IBLSchedule::IsLargeChange(outside, state, 0.5f));
+
+		IBLSchedule::LightingState inside{ &weather, nullptr, &interior, 12.0f };
+		CHECK(IBLSchedule::IsLargeChange(outside, inside, 0.5f));
+		CHECK(IBLSchedule::IsLargeChange(inside, outside, 0.5f));
+		state = inside;
+		state.interiorCell = &otherInterior;
+		CHECK(IBLSchedule::IsLargeChange(inside, state, 0.5f));
+
+		state = outside;
+		state.weather = &otherWeather;
+		CHECK(IBLSchedule::IsLargeChange(outside, state, 0.5f));
+
+		// waiting, including across midnight
+		state = outside;
+		state.hour = 15.0f;
+		CHECK(IBLSchedule::IsLargeChange(outside, state, 0.5f));
+		IBLSchedule::LightingState midnight = outside;
+		midnight.hour = 23.9f;
+		state.hour = 0.1f;
+		CHECK(!IBLSchedule::IsLargeChange(midnight, state, 0.5f));
+	}
+
+	return Test::Finish();
+}
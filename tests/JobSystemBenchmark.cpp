@@ -0,0 +1,69 @@
+// Measures the job system under the two loads it sees in game: many threads submitting small jobs at once (draw hooks queueing
+// compiles while features split their frame work), and ParallelFor over a frame's worth of items, against running them serially.
+#include <JobSystem.h>
+
+#include <cmath>
+#include <vector>
+
+#include "Test.h"
+
+// Roughly the cost of one collision or particle light cluster task
+static double Work(size_t a_index, int a_iterations)
+{
+	double value = static_cast<double>(a_index);
+	for (int i = 0; i < a_iterations; i++)
+		value = std::sqrt(value * 1.0001 + i);
+	return value;
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = Test::IsQuick(argc, argv);
+	size_t workerCount = std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1;
+	JobSystem jobs(workerCount);
+	std::printf("%zu workers\n\n", workerCount);
+
+	// contention: every submitter queues tiny jobs as fast as it can
+	size_t jobsPerThread = quick ? 5000 : 200000;
+	std::printf("%10s %12s %14s %10s\n", "submitters", "jobs", "Mjobs/s", "stolen");
+	for (int submitters : { 1, 2, 4, 8 }) {
+		std::atomic<size_t> executed = 0;
+		auto stolenBefore = jobs.GetStolenJobs();
+		size_t total = jobsPerThread * submitters;
+		auto ms = Test::Time(1, [&]() {
+			std::vector<std::thread> threads;
+			for (int t = 0; t < submitters; t++) {
+				threads.emplace_back([&]() {
+					for (size_t i = 0; i < jobsPerThread; i++)
+						jobs.Submit([&]() { executed++; }, i % 4 ? JobPriority::Normal : JobPriority::Background);
+				});
+			}
+			for (auto& thread : threads)
+				thread.join();
+			while (executed < total)
+				std::this_thread::yield();
+		});
+		std::printf("%10d %12zu %14.2f %10llu\n", submitters, total, total / ms / 1000.0, static_cast<unsigned long long>(jobs.GetStolenJobs() - stolenBefore));
+		CHECK(executed == total);
+	}
+
+	// throughput: ParallelFor against a serial loop, for cheap and expensive items
+	std::printf("\n%10s %12s %12s %14s %10s\n", "items", "iterations", "serial ms", "parallel ms", "speedup");
+	for (size_t items : { 64, 1024, 16384 }) {
+		for (int iterations : { 16, 1024 }) {
+			if (quick && items * iterations > 1 << 20)
+				continue;
+
+			std::vector<double> serial(items), parallel(items);
+			auto serialMs = Test::Time(3, [&]() {
+				for (size_t i = 0; i < items; i++)
+					serial[i] = Work(i, iterations);
+			});
+			auto parallelMs = Test::Time(3, [&]() { jobs.ParallelFor(items, [&](size_t a_index) { parallel[a_index] = Work(a_index, iterations); }); });
+			std::printf("%10zu %12d %12.3f %14.3f %9.2fx\n", items, iterations, serialMs, parallelMs, serialMs / parallelMs);
+			CHECK(serial == parallel);
+		}
+	}
+
+	return Test::Finish();
+}
@@ -0,0 +1,133 @@
+// Checks that frame-critical jobs overtake background jobs already queued, and stresses ParallelFor to make sure every index runs
+// exactly once, whether it is called from outside the pool, from several threads at once or from a job on a worker.
+#include <JobSystem.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include "Test.h"
+
+// Occupies every worker, queues background jobs behind them and a frame-critical job last, then releases the workers
+static void CheckPriority(size_t a_workerCount)
+{
+	JobSystem jobs(a_workerCount);
+
+	std::atomic<size_t> started = 0;
+	std::atomic<bool> release = false;
+	for (size_t i = 0; i < a_workerCount; i++) {
+		jobs.Submit([&]() {
+			started++;
+			while (!release)
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+		},
+			JobPriority::Background);
+	}
+	while (started < a_workerCount)
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+	constexpr size_t backgroundCount = 16;
+	std::mutex orderMutex;
+	std::vector<JobPriority> order;
+	std::atomic<size_t> finished = 0;
+	auto record = [&](JobPriority a_priority) {
+		return [&, a_priority]() {
+			// long enough that a worker which took a higher priority job records it before the others get through theirs
+			if (a_priority == JobPriority::Background)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			{
+				std::scoped_lock lock(orderMutex);
+				order.push_back(a_priority);
+			}
+			finished++;
+		};
+	};
+	for (size_t i = 0; i < backgroundCount; i++)
+		jobs.Submit(record(JobPriority::Background), JobPriority::Background);
+	jobs.Submit(record(JobPriority::Normal), JobPriority::Normal);
+	jobs.Submit(record(JobPriority::FrameCritical), JobPriority::FrameCritical);
+	release = true;
+
+	while (finished < backgroundCount + 2)
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+	// each released worker takes the highest priority job left, so both run within the first round of takes
+	size_t critical = 0, normal = 0;
+	for (size_t i = 0; i < order.size(); i++) {
+		if (order[i] == JobPriority::FrameCritical)
+			critical = i;
+		else if (order[i] == JobPriority::Normal)
+			normal = i;
+	}
+	CHECK(critical < a_workerCount);
+	CHECK(normal < a_workerCount + 1);
+	if (a_workerCount == 1) {
+		CHECK(critical == 0);
+		CHECK(normal == 1);
+	}
+}
+
+static bool RunsEveryIndexOnce(JobSystem& a_jobs, size_t a_count, size_t a_slowEvery)
+{
+	std::vector<std::atomic<int>> hits(a_count);
+	a_jobs.ParallelFor(a_count, [&](size_t a_index) {
+		// a few long items so the caller runs out of work while helpers are still busy
+		if (a_slowEvery && a_index % a_slowEvery == 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		hits[a_index]++;
+	});
+	for (auto& hit : hits) {
+		if (hit != 1)
+			return false;
+	}
+	return true;
+}
+
+int main()
+{
+	for (size_t workerCount : { 1, 3 })
+		CheckPriority(workerCount);
+
+	JobSystem jobs(3);
+	for (int round = 0; round < 20; round++) {
+		for (size_t count : { 1, 2, 3, 4, 7, 64, 1000, 20011 })
+			CHECK(RunsEveryIndexOnce(jobs, count, round % 4 == 0 ? 97 : 0));
+	}
+
+	// several threads splitting ranges over the same workers, as the render thread and compile jobs can
+	{
+		std::atomic<int> failed = 0;
+		std::vector<std::thread> callers;
+		for (int t = 0; t < 4; t++) {
+			callers.emplace_back([&, t]() {
+				for (int round = 0; round < 25; round++)
+					failed += !RunsEveryIndexOnce(jobs, 500 + t * 37 + round, round % 5 == 0 ? 13 : 0);
+			});
+		}
+		for (auto& caller : callers)
+			caller.join();
+		CHECK(failed == 0);
+	}
+
+	// a worker waiting on its own range while its helpers sit in its queue
+	{
+		std::atomic<int> nested = -1;
+		jobs.Submit([&]() { nested = RunsEveryIndexOnce(jobs, 3000, 101); }, JobPriority::Normal);
+		while (nested < 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		CHECK(nested == 1);
+	}
+
+	// a throwing item is logged and still counted, so the call returns
+	{
+		std::atomic<size_t> ran = 0;
+		jobs.ParallelFor(100, [&](size_t a_index) {
+			ran++;
+			if (a_index == 42)
+				throw std::runtime_error("expected failure of index 42");
+		});
+		CHECK(ran == 100);
+	}
+
+	return Test::Finish();
+}
@@ -0,0 +1,141 @@
+#include <Features/LightLimitFIx/LightBudget.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "Test.h"
+#include "Vector3.h"
+
+struct Candidate
+{
+	std::uint64_t key;
+	float importance;
+	float fade = -1;
+};
+
+using Fades = std::unordered_map<std::uint64_t, LightBudget::Fade>;
+
+static std::vector<Candidate> MakeCandidates(std::uint32_t a_count)
+{
+	// importance equals the key, so the highest keys are the most important
+	std::vector<Candidate> candidates;
+	for (std::uint32_t i = 1; i <= a_count; i++)
+		candidates.push_back({ i, (float)i });
+	return candidates;
+}
+
+static std::uint32_t Select(std::vector<Candidate>& a_candidates, Fades& a_fades, size_t a_budget, float a_fadeStep, std::uint32_t a_frame)
+{
+	return LightBudget::Select(a_candidates, a_fades, a_budget, a_fadeStep, a_frame, [](Candidate& a_candidate, float a_fade) {
+		a_candidate.fade = a_fade;
+	});
+}
+
+static float GetFade(const std::vector<Candidate>& a_candidates, std::uint64_t a_key)
+{
+	for (auto& candidate : a_candidates) {
+		if (candidate.key == a_key)
+			return candidate.fade;
+	}
+	return -1;
+}
+
+static void TestImportance()
+{
+	Vector3 eye{ 0, 0, 0 };
+	Vector3 white{ 1, 1, 1 };
+	// inside the light the coverage is full
+	CHECK_NEAR(LightBudget::GetImportance(Vector3{ 10, 0, 0 }, 100.0f, white, eye), 1.0, 1e-5);
+	// outside it falls off with the squared distance
+	CHECK_NEAR(LightBudget::GetImportance(Vector3{ 200, 0, 0 }, 100.0f, white, eye), 0.25, 1e-5);
+	CHECK_NEAR(LightBudget::GetImportance(Vector3{ 0, 400, 0 }, 100.0f, white, eye), 1.0 / 16, 1e-5);
+	// weighted by luminance
+	CHECK_NEAR(LightBudget::GetImportance(Vector3{ 10, 0, 0 }, 100.0f, Vector3{ 0, 1, 0 }, eye), 0.59, 1e-5);
+	CHECK_NEAR(LightBudget::GetImportance(Vector3{ 10, 0, 0 }, 100.0f, Vector3{ 0, 0, 0 }, eye), 0.0, 1e-5);
+	// a brighter light further away can beat a dim close one
+	CHECK(LightBudget::GetImportance(Vector3{ 150, 0, 0 }, 100.0f, Vector3{ 4, 4, 4 }, eye) > LightBudget::GetImportance(Vector3{ 50, 0, 0 }, 100.0f, Vector3{ 0.5f, 0.5f, 0.5f }, eye));
+}
+
+static void TestSelection()
+{
+	Fades fades;
+	auto candidates = MakeCandidates(10);
+	CHECK(Select(candidates, fades, 4, 0.5f, 1) == 0);
+	// new lights start at their target, rejected ones are dropped at once
+	CHECK(candidates.size() == 4);
+	for (auto& candidate : candidates) {
+		CHECK(candidate.key > 6);
+		CHECK(candidate.fade == 1.0f);
+	}
+}
+
+static void TestFadeOut()
+{
+	Fades fades;
+	auto candidates = MakeCandidates(4);
+	Select(candidates, fades, 4, 0.5f, 1);
+
+	// two new, more important lights push out keys 1 and 2, which fade out over two steps
+	candidates = MakeCandidates(6);
+	CHECK(Select(candidates, fades, 4, 0.5f, 2) == 2);
+	CHECK(candidates.size() == 6);
+	CHECK(GetFade(candidates, 1) == 0.5f);
+	CHECK(GetFade(candidates, 6) == 1.0f);
+
+	candidates = MakeCandidates(6);
+	CHECK(Select(candidates, fades, 4, 0.5f, 3) == 0);
+	CHECK(candidates.size() == 4);
+	CHECK(GetFade(candidates, 1) == -1);
+}
+
+static void TestNoPopUnderBudget()
+{
+	Fades fades;
+	auto candidates = MakeCandidates(4);
+	Select(candidates, fades, 4, 0.25f, 1);
+	candidates = MakeCandidates(6);
+	Select(candidates, fades, 4, 0.25f, 2);
+	candidates = MakeCandidates(6);
+	Select(candidates, fades, 4, 0.25f, 3);
+	CHECK(GetFade(candidates, 1) == 0.5f);
+
+	// the count drops back under the budget, key 1 fades back in rather than popping to full
+	candidates = MakeCandidates(4);
+	CHECK(Select(candidates, fades, 4, 0.25f, 4) == 0);
+	CHECK(candidates.size() == 4);
+	CHECK(GetFade(candidates, 1) == 0.75f);
+	candidates = MakeCandidates(4);
+	Select(candidates, fades, 4, 0.25f, 5);
+	CHECK(GetFade(candidates, 1) == 1.0f);
+
+	// also when the budget is turned off, which selects everything
+	candidates = MakeCandidates(8);
+	Select(candidates, fades, 4, 0.25f, 6);
+	CHECK(GetFade(candidates, 1) == 0.75f);
+	candidates = MakeCandidates(8);
+	Select(candidates, fades, candidates.size(), 0.25f, 7);
+	CHECK(GetFade(candidates, 1) == 1.0f);
+	CHECK(candidates.size() == 8);
+}
+
+static void TestStaleFades()
+{
+	Fades fades;
+	auto candidates = MakeCandidates(6);
+	Select(candidates, fades, 4, 0.5f, 1);
+	CHECK(fades.size() == 6);
+	// lights that are no longer candidates lose their fade
+	candidates = MakeCandidates(2);
+	Select(candidates, fades, 4, 0.5f, 2);
+	CHECK(fades.size() == 2);
+}
+
+int main()
+{
+	TestImportance();
+	TestSelection();
+	TestFadeOut();
+	TestNoPopUnderBudget();
+	TestStaleFades();
+	return Test::Finish();
+}
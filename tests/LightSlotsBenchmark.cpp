@@ -0,0 +1,140 @@
+// Compares uploading every light each frame, as before stable slots, with diffing the lights into stable slots and
+// uploading only the changed ranges, over a synthetic scene of static, flickering and short-lived particle lights.
+#include <Features/LightLimitFIx/LightSlots.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+
+struct Light
+{
+	float color[3];
+	float radius;
+	float position[3];
+	std::uint32_t firstPersonShadow;
+};
+
+struct Scene
+{
+	std::uint32_t staticLights;
+	std::uint32_t flickeringLights;
+	std::uint32_t particleLights;
+	float particleChurn;  // fraction of particle clusters replaced each frame
+};
+
+struct Frame
+{
+	std::vector<std::pair<std::uint64_t, Light>> lights;
+};
+
+static std::vector<Frame> Record(const Scene& a_scene, std::uint32_t a_frames)
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-3000, 3000);
+	std::uniform_real_distribution<float> unit(0, 1);
+
+	auto makeLight = [&]() {
+		return Light{ { unit(random), unit(random), unit(random) }, 100 + unit(random) * 400, { position(random), position(random), position(random) }, 0 };
+	};
+
+	std::vector<Light> statics(a_scene.staticLights), flickering(a_scene.flickeringLights), particles(a_scene.particleLights);
+	std::vector<std::uint64_t> particleKeys(a_scene.particleLights);
+	for (auto& light : statics) light = makeLight();
+	for (auto& light : flickering) light = makeLight();
+	std::uint64_t nextKey = 1 << 20;
+	for (std::uint32_t i = 0; i < a_scene.particleLights; i++) {
+		particles[i] = makeLight();
+		particleKeys[i] = nextKey++;
+	}
+
+	std::vector<Frame> frames(a_frames);
+	for (auto& frame : frames) {
+		for (std::uint32_t i = 0; i < a_scene.staticLights; i++)
+			frame.lights.push_back({ i + 1, statics[i] });
+		for (std::uint32_t i = 0; i < a_scene.flickeringLights; i++) {
+			auto light = flickering[i];
+			light.position[0] += unit(random) * 4;
+			light.color[0] *= unit(random);
+			frame.lights.push_back({ a_scene.staticLights + i + 1, light });
+		}
+		for (std::uint32_t i = 0; i < a_scene.particleLights; i++) {
+			if (unit(random) < a_scene.particleChurn) {
+				particles[i] = makeLight();
+				particleKeys[i] = nextKey++;
+			}
+			frame.lights.push_back({ particleKeys[i], particles[i] });
+		}
+		// the order lights are gathered in changes between frames
+		std::shuffle(frame.lights.begin(), frame.lights.end(), random);
+	}
+	return frames;
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = Test::IsQuick(argc, argv);
+	std::uint32_t frameCount = quick ? 30 : 600;
+	std::vector<Scene> scenes = { { 200, 20, 0, 0 }, { 1000, 100, 500, 0.05f }, { 4000, 400, 4000, 0.1f } };
+
+	std::printf("%8s %8s %8s %16s %16s %18s %18s\n", "static", "flicker", "particle", "full ms/frame", "slots ms/frame", "full lights/frame", "slots lights/frame");
+	for (auto& scene : scenes) {
+		auto frames = Record(scene, frameCount);
+		std::vector<Light> gpu(scene.staticLights + scene.flickeringLights + scene.particleLights * 2 + 1);
+
+		// Before: the light array is rebuilt and the whole of it uploaded every frame
+		std::vector<Light> rebuilt;
+		std::uint64_t fullUploaded = 0;
+		auto fullMs = Test::Time(quick ? 1 : 5, [&]() {
+			fullUploaded = 0;
+			for (auto& frame : frames) {
+				rebuilt.clear();
+				for (auto& [key, light] : frame.lights)
+					rebuilt.push_back(light);
+				std::memcpy(gpu.data(), rebuilt.data(), rebuilt.size() * sizeof(Light));
+				fullUploaded += rebuilt.size();
+			}
+		});
+
+		std::uint64_t slotsUploaded = 0;
+		std::uint32_t maxSlots = 0;
+		auto runSlots = [&](bool a_validate) {
+			LightSlots<Light> slots;
+			slotsUploaded = 0;
+			std::uint32_t lightFrame = 0;
+			for (auto& frame : frames) {
+				lightFrame++;
+				for (auto& [key, light] : frame.lights)
+					slots.Assign(key, light, lightFrame);
+				slots.ReleaseStale(lightFrame);
+				auto& data = slots.GetData();
+				if (data.size() > gpu.size())
+					gpu.resize(data.size());
+				slotsUploaded += slots.FlushDirty([&](std::uint32_t a_first, std::uint32_t a_count) {
+					std::memcpy(gpu.data() + a_first, data.data() + a_first, a_count * sizeof(Light));
+				});
+				slots.Trim();
+				maxSlots = std::max(maxSlots, slots.GetCount());
+
+				if (a_validate) {
+					// the uploaded buffer must hold exactly this frame's lights
+					std::uint32_t live = 0;
+					for (std::uint32_t i = 0; i < slots.GetCount(); i++)
+						live += gpu[i].radius > 0;
+					CHECK(live == frame.lights.size());
+				}
+			}
+		};
+		runSlots(true);
+		auto slotsMs = Test::Time(quick ? 1 : 5, [&]() { runSlots(false); });
+
+		std::printf("%8u %8u %8u %16.4f %16.4f %18.1f %18.1f\n", scene.staticLights, scene.flickeringLights, scene.particleLights,
+			fullMs / frameCount, slotsMs / frameCount, (double)fullUploaded / frameCount, (double)slotsUploaded / frameCount);
+
+		CHECK(slotsUploaded < fullUploaded);
+		// churn must not make the slot range grow without bound
+		CHECK(maxSlots <= frames[0].lights.size() * 2);
+	}
+	return Test::Finish();
+}
@@ -0,0 +1,84 @@
+#include <Features/LightLimitFIx/LightSlots.h>
+
+#include <vector>
+
+#include "Test.h"
+
+struct Light
+{
+	float position[3];
+	float radius;
+};
+
+static std::vector<std::pair<std::uint32_t, std::uint32_t>> Flush(LightSlots<Light>& a_slots)
+{
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges;
+	a_slots.FlushDirty([&](std::uint32_t a_first, std::uint32_t a_count) { ranges.push_back({ a_first, a_count }); });
+	return ranges;
+}
+
+static void TestStableSlots()
+{
+	LightSlots<Light> slots;
+	for (std::uint64_t key = 1; key <= 4; key++)
+		CHECK(slots.Assign(key, { { (float)key, 0, 0 }, 100 }, 1));
+	auto ranges = Flush(slots);
+	CHECK(ranges.size() == 1 && ranges[0].first == 0 && ranges[0].second == 4);
+
+	// unchanged lights are not uploaded again
+	for (std::uint64_t key = 1; key <= 4; key++)
+		CHECK(!slots.Assign(key, { { (float)key, 0, 0 }, 100 }, 2));
+	slots.ReleaseStale(2);
+	CHECK(Flush(slots).empty());
+
+	// a moved light uploads only its own slot
+	CHECK(slots.Assign(3, { { 30, 0, 0 }, 100 }, 3));
+	for (std::uint64_t key : { 1, 2, 4 })
+		slots.Assign(key, { { (float)key, 0, 0 }, 100 }, 3);
+	slots.ReleaseStale(3);
+	ranges = Flush(slots);
+	CHECK(ranges.size() == 1 && ranges[0].first == 2 && ranges[0].second == 1);
+	CHECK(slots.GetData()[2].position[0] == 30);
+}
+
+static void TestRelease()
+{
+	LightSlots<Light> slots;
+	for (std::uint64_t key = 1; key <= 4; key++)
+		slots.Assign(key, { { 1, 0, 0 }, 100 }, 1);
+	Flush(slots);
+
+	// lights that disappear are zeroed so culling skips them, then the range is trimmed
+	slots.Assign(1, { { 1, 0, 0 }, 100 }, 2);
+	slots.Assign(2, { { 1, 0, 0 }, 100 }, 2);
+	slots.ReleaseStale(2);
+	auto ranges = Flush(slots);
+	CHECK(ranges.size() == 1 && ranges[0].first == 2 && ranges[0].second == 2);
+	CHECK(slots.GetData()[3].radius == 0);
+	slots.Trim();
+	CHECK(slots.GetCount() == 2);
+
+	// freed slots in the middle are reused lowest first
+	slots.Assign(1, { { 1, 0, 0 }, 100 }, 3);
+	slots.Assign(2, { { 1, 0, 0 }, 100 }, 3);
+	slots.Assign(5, { { 1, 0, 0 }, 100 }, 3);
+	CHECK(slots.GetCount() == 3);
+}
+
+static void TestSharedKey()
+{
+	// two lights with the same key in one frame get separate slots
+	LightSlots<Light> slots;
+	slots.Assign(7, { { 1, 0, 0 }, 100 }, 1);
+	slots.Assign(7, { { 2, 0, 0 }, 100 }, 1);
+	CHECK(slots.GetCount() == 2);
+	CHECK(slots.GetData()[0].position[0] == 1 && slots.GetData()[1].position[0] == 2);
+}
+
+int main()
+{
+	TestStableSlots();
+	TestRelease();
+	TestSharedKey();
+	return Test::Finish();
+}
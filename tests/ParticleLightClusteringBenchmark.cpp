@@ -0,0 +1,137 @@
+// Compares the previous sequential running-average clustering of particle lights with the spatial hash,
+// on synthetic vertex clouds of 10k to 200k particles spread over a number of particle systems.
+#include <Features/LightLimitFIx/ParticleLightClustering.h>
+
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Test.h"
+#include "Vector3.h"
+
+struct Particle
+{
+	Vector3 position;
+	Vector3 color;
+	float radius;
+};
+
+struct Cluster
+{
+	std::uint64_t id = 0;
+	Vector3 color;
+	float radius = 0;
+	Vector3 position;
+	std::uint32_t count = 0;
+};
+
+using ParticleSystem = std::vector<Particle>;
+
+static std::vector<ParticleSystem> MakeScene(size_t a_particles, size_t a_systems)
+{
+	// each system is a plume around its own emitter, like fires and magic effects in a cell
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> emitter(-4000, 4000);
+	std::normal_distribution<float> spread(0, 60);
+	std::uniform_real_distribution<float> radius(8, 40);
+	std::vector<ParticleSystem> systems(a_systems);
+	for (auto& system : systems) {
+		Vector3 center{ emitter(random), emitter(random), emitter(random) / 8 };
+		for (size_t i = 0; i < a_particles / a_systems; i++)
+			system.push_back({ center + Vector3{ spread(random), spread(random), std::abs(spread(random)) * 3 }, { 1, 0.6f, 0.2f }, radius(random) });
+	}
+	return systems;
+}
+
+// The clustering before the spatial hash: a particle joins the running cluster if it is close to its average, otherwise the cluster is emitted
+static size_t ClusterSequential(const std::vector<ParticleSystem>& a_systems, float a_clusterRadius, std::vector<Cluster>& a_out)
+{
+	a_out.clear();
+	Cluster current;
+	for (auto& system : a_systems) {
+		for (auto& particle : system) {
+			if (current.count) {
+				auto averageRadius = current.radius / (float)current.count;
+				auto averagePosition = current.position * (1.0f / (float)current.count);
+				if (std::abs(averageRadius - particle.radius) + (particle.position - averagePosition).Length() > a_clusterRadius) {
+					current.radius = averageRadius;
+					current.position = averagePosition;
+					a_out.push_back(current);
+					current = {};
+				}
+			}
+			current.color += particle.color;
+			current.radius += particle.radius;
+			current.position += particle.position;
+			current.count++;
+		}
+	}
+	if (current.count)
+		a_out.push_back(current);
+	return a_out.size();
+}
+
+static void ClusterSystem(const ParticleSystem& a_system, float a_cellSize, std::vector<Cluster>& a_out)
+{
+	std::unordered_map<std::uint64_t, std::uint32_t> idToCluster;
+	a_out.reserve(std::min<size_t>(a_system.size(), 256));
+	for (auto& particle : a_system) {
+		Cluster cluster{ ParticleLightClustering::GetCellKey(particle.position.x, particle.position.y, particle.position.z, a_cellSize), particle.color, particle.radius, particle.position, 1 };
+		ParticleLightClustering::Accumulate(a_out, idToCluster, cluster);
+	}
+}
+
+static size_t ClusterSpatialHash(const std::vector<ParticleSystem>& a_systems, float a_cellSize, unsigned a_threads, std::vector<std::vector<Cluster>>& a_perSystem, std::vector<Cluster>& a_out)
+{
+	a_perSystem.assign(a_systems.size(), {});
+	if (a_threads <= 1) {
+		for (size_t i = 0; i < a_systems.size(); i++)
+			ClusterSystem(a_systems[i], a_cellSize, a_perSystem[i]);
+	} else {
+		std::vector<std::jthread> threads;
+		for (unsigned t = 0; t < a_threads; t++) {
+			threads.emplace_back([&, t]() {
+				for (size_t i = t; i < a_systems.size(); i += a_threads)
+					ClusterSystem(a_systems[i], a_cellSize, a_perSystem[i]);
+			});
+		}
+	}
+
+	a_out.clear();
+	std::unordered_map<std::uint64_t, std::uint32_t> idToCluster;
+	for (auto& clusters : a_perSystem) {
+		for (auto& cluster : clusters)
+			ParticleLightClustering::Accumulate(a_out, idToCluster, cluster);
+	}
+	ParticleLightClustering::Finalize(a_out);
+	return a_out.size();
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = Test::IsQuick(argc, argv);
+	std::vector<size_t> sizes = quick ? std::vector<size_t>{ 10000 } : std::vector<size_t>{ 10000, 50000, 100000, 200000 };
+	int runs = quick ? 1 : 10;
+	unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+	constexpr float clusterRadius = 32;
+
+	std::printf("%10s %8s %14s %14s %14s %12s %12s\n", "particles", "systems", "sequential ms", "hash 1T ms", "hash MT ms", "seq lights", "hash lights");
+	for (auto size : sizes) {
+		auto systems = MakeScene(size, 64);
+		std::vector<Cluster> sequential, hashed;
+		std::vector<std::vector<Cluster>> perSystem;
+
+		size_t sequentialLights = 0, hashedLights = 0, threadedLights = 0;
+		auto sequentialMs = Test::Time(runs, [&]() { sequentialLights = ClusterSequential(systems, clusterRadius, sequential); });
+		auto hashMs = Test::Time(runs, [&]() { hashedLights = ClusterSpatialHash(systems, clusterRadius, 1, perSystem, hashed); });
+		auto threadedMs = Test::Time(runs, [&]() { threadedLights = ClusterSpatialHash(systems, clusterRadius, threads, perSystem, hashed); });
+		std::printf("%10zu %8d %14.3f %14.3f %14.3f %12zu %12zu\n", size, 64, sequentialMs, hashMs, threadedMs, sequentialLights, hashedLights);
+
+		// threading must not change the result
+		CHECK(threadedLights == hashedLights);
+		// the hash merges neighbours the running average split because of the order they came in
+		CHECK(hashedLights <= sequentialLights);
+	}
+	return Test::Finish();
+}
@@ -0,0 +1,145 @@
+#include <Features/LightLimitFIx/ParticleLightClustering.h>
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Test.h"
+#include "Vector3.h"
+
+struct Cluster
+{
+	std::uint64_t id = 0;
+	Vector3 color;
+	float radius = 0;
+	Vector3 position;
+	std::uint32_t count = 0;
+};
+
+static Cluster MakeParticle(const Vector3& a_position, float a_radius, float a_cellSize)
+{
+	return { ParticleLightClustering::GetCellKey(a_position.x, a_position.y, a_position.z, a_cellSize), { 1, 0.5f, 0.25f }, a_radius, a_position, 1 };
+}
+
+static std::vector<Cluster> Build(const std::vector<Cluster>& a_particles)
+{
+	std::vector<Cluster> clusters;
+	std::unordered_map<std::uint64_t, std::uint32_t> idToCluster;
+	for (auto& particle : a_particles)
+		ParticleLightClustering::Accumulate(clusters, idToCluster, particle);
+	ParticleLightClustering::Finalize(clusters);
+	return clusters;
+}
+
+static void TestCellKey()
+{
+	using ParticleLightClustering::GetCellKey;
+	CHECK(GetCellKey(0, 0, 0, 32) == GetCellKey(31.9f, 31.9f, 31.9f, 32));
+	CHECK(GetCellKey(0, 0, 0, 32) != GetCellKey(32, 0, 0, 32));
+	CHECK(GetCellKey(0, 0, 0, 32) != GetCellKey(0, 32, 0, 32));
+	CHECK(GetCellKey(0, 0, 0, 32) != GetCellKey(0, 0, 32, 32));
+	// negative coordinates floor rather than truncate, so -1 and 1 are in different cells
+	CHECK(GetCellKey(-1, 0, 0, 32) != GetCellKey(1, 0, 0, 32));
+	CHECK(GetCellKey(-1, -1, -1, 32) == GetCellKey(-31, -31, -31, 32));
+}
+
+static void TestAverages()
+{
+	std::vector<Cluster> particles = {
+		MakeParticle({ 2, 2, 2 }, 10, 32),
+		MakeParticle({ 6, 4, 2 }, 20, 32),
+		MakeParticle({ 100, 100, 100 }, 5, 32),
+	};
+	auto clusters = Build(particles);
+	CHECK(clusters.size() == 2);
+
+	auto it = std::find_if(clusters.begin(), clusters.end(), [](auto& a) { return a.count == 2; });
+	CHECK(it != clusters.end());
+	if (it != clusters.end()) {
+		CHECK_NEAR(it->radius, 15, 1e-5);
+		CHECK_NEAR(it->position.x, 4, 1e-5);
+		CHECK_NEAR(it->position.y, 3, 1e-5);
+		CHECK_NEAR(it->position.z, 2, 1e-5);
+		// color is summed, a cluster of two lights is twice as bright
+		CHECK_NEAR(it->color.x, 2, 1e-5);
+	}
+}
+
+static void TestOrderIndependence()
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-2000, 2000);
+	std::uniform_real_distribution<float> radius(5, 50);
+	std::vector<Cluster> particles;
+	for (int i = 0; i < 5000; i++)
+		particles.push_back(MakeParticle({ position(random), position(random), position(random) / 10 }, radius(random), 128));
+
+	auto reference = Build(particles);
+	for (int i = 0; i < 5; i++) {
+		std::shuffle(particles.begin(), particles.end(), random);
+		auto clusters = Build(particles);
+		CHECK(clusters.size() == reference.size());
+		if (clusters.size() != reference.size())
+			continue;
+		for (size_t c = 0; c < clusters.size(); c++) {
+			CHECK(clusters[c].id == reference[c].id);
+			CHECK(clusters[c].count == reference[c].count);
+			CHECK_NEAR(clusters[c].position.x, reference[c].position.x, 1e-2);
+			CHECK_NEAR(clusters[c].radius, reference[c].radius, 1e-3);
+		}
+	}
+
+	// output is sorted by id so the light order is the same every frame
+	CHECK(std::is_sorted(reference.begin(), reference.end(), [](auto& a, auto& b) { return a.id < b.id; }));
+}
+
+static void TestMergeAcrossSystems()
+{
+	// the per-system clusters merged again must match clustering every particle at once
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> position(-500, 500);
+	std::vector<std::vector<Cluster>> systems(8);
+	std::vector<Cluster> all;
+	for (auto& system : systems) {
+		for (int i = 0; i < 500; i++) {
+			auto particle = MakeParticle({ position(random), position(random), position(random) }, 16, 64);
+			system.push_back(particle);
+			all.push_back(particle);
+		}
+	}
+
+	std::vector<std::vector<Cluster>> perSystem;
+	for (auto& system : systems) {
+		std::vector<Cluster> clusters;
+		std::unordered_map<std::uint64_t, std::uint32_t> idToCluster;
+		for (auto& particle : system)
+			ParticleLightClustering::Accumulate(clusters, idToCluster, particle);
+		perSystem.push_back(std::move(clusters));
+	}
+
+	std::vector<Cluster> merged;
+	std::unordered_map<std::uint64_t, std::uint32_t> idToCluster;
+	for (auto& clusters : perSystem) {
+		for (auto& cluster : clusters)
+			ParticleLightClustering::Accumulate(merged, idToCluster, cluster);
+	}
+	ParticleLightClustering::Finalize(merged);
+
+	auto reference = Build(all);
+	CHECK(merged.size() == reference.size());
+	for (size_t c = 0; c < std::min(merged.size(), reference.size()); c++) {
+		CHECK(merged[c].id == reference[c].id);
+		CHECK(merged[c].count == reference[c].count);
+		CHECK_NEAR(merged[c].position.y, reference[c].position.y, 1e-2);
+	}
+}
+
+int main()
+{
+	TestCellKey();
+	TestAverages();
+	TestOrderIndependence();
+	TestMergeAcrossSystems();
+	return Test::Finish();
+}
@@ -0,0 +1,56 @@
+// Loads the recorded manifest in data/PermutationAnalyzer, which holds the same permutations as PermutationAnalyzerTest plus telemetry
+// rows that must not count (fast tier, disk hits, failed compiles), and checks the report written from it.
+#include <ShaderTools/PermutationAnalyzer.h>
+
+#include <fstream>
+#include <string>
+
+#include "Test.h"
+
+using namespace PermutationAnalyzer;
+
+int main()
+{
+	const std::filesystem::path data = TEST_DATA_DIR "/PermutationAnalyzer";
+	auto manifest = LoadManifest(data / "Descriptors.csv", data / "Compile.csv");
+
+	CHECK(manifest.descriptors.size() == 8);
+	CHECK(manifest.descriptors[1].descriptor == 0x8001);
+	CHECK(manifest.descriptors[1].lookup == 0x1);
+	CHECK(manifest.costs.size() == 6);
+	CHECK(!manifest.costs.contains({ "Lighting", "Pixel", 0x601 }));
+	CHECK_NEAR(manifest.costs.at({ "Lighting", "Pixel", 0x201 }).compileMs, 200, 1e-9);
+	CHECK_NEAR(manifest.costs.at({ "Lighting", "Pixel", 0x201 }).bytecodeSize, 2000, 1e-9);
+
+	auto current = Evaluate(manifest, "Lighting", 0, 0.1);
+	CHECK(current.permutations == 6);
+	CHECK_NEAR(current.compileMs, 920, 1e-9);
+	auto both = Evaluate(manifest, "Lighting", 0x600, 0.1);
+	CHECK(both.permutations == 2);
+	CHECK_NEAR(both.compileMs, 300 * 1.2 + 70 * 1.1, 1e-9);
+
+	// a manifest recorded without telemetry still counts permutations
+	auto descriptorsOnly = LoadManifest(data / "Descriptors.csv", data / "Missing.csv");
+	CHECK(descriptorsOnly.costs.empty());
+	CHECK(Evaluate(descriptorsOnly, "Lighting", 0x200, 0.1).permutations == 3);
+
+	auto candidates = Analyze(manifest, "Lighting", GetBitFlags(manifest, "Lighting"));
+	auto reportPath = std::filesystem::temp_directory_path() / "PermutationAnalyzerCsvTest.csv";
+	WriteReport(candidates, reportPath);
+
+	std::ifstream report(reportPath);
+	std::string header;
+	std::getline(report, header);
+	CHECK(header == "Type,Stripped Flags,Mask,Permutations,Estimated Compile ms,Estimated Bytecode Size");
+	size_t rows = 0;
+	for (std::string line; std::getline(report, line);) {
+		if (!line.empty())
+			rows++;
+	}
+	CHECK(rows == candidates.size());
+	CHECK(rows == 4);
+	report.close();
+	std::filesystem::remove(reportPath);
+
+	return Test::Finish();
+}
@@ -0,0 +1,90 @@
+// Checks the permutation counts and cost estimates of the permutation analysis on a small synthetic manifest, where every number can
+// be worked out by hand: class average fallback for permutations without telemetry, collapsed groups costing their most expensive
+// member plus the branch overhead, and the greedy accumulation of flags.
+#include <ShaderTools/PermutationAnalyzer.h>
+
+#include "Test.h"
+
+using namespace PermutationAnalyzer;
+
+static Manifest MakeManifest()
+{
+	Manifest manifest;
+	// bit 0 is always set, bits 9 and 10 vary. 0x8001 is another descriptor with the same lookup, so the same permutation.
+	manifest.descriptors = {
+		{ "Lighting", "Pixel", 0x1, 0x1 },
+		{ "Lighting", "Pixel", 0x8001, 0x1 },
+		{ "Lighting", "Pixel", 0x201, 0x201 },
+		{ "Lighting", "Pixel", 0x401, 0x401 },
+		{ "Lighting", "Pixel", 0x601, 0x601 },
+		{ "Lighting", "Vertex", 0x1, 0x1 },
+		{ "Lighting", "Vertex", 0x201, 0x201 },
+		{ "Water", "Pixel", 0x3, 0x3 },
+	};
+	// 0x601 was never compiled, so it costs the pixel average of 200 ms and 2000 bytes
+	manifest.costs[{ "Lighting", "Pixel", 0x1 }] = { 100, 1000 };
+	manifest.costs[{ "Lighting", "Pixel", 0x201 }] = { 200, 2000 };
+	manifest.costs[{ "Lighting", "Pixel", 0x401 }] = { 300, 3000 };
+	manifest.costs[{ "Lighting", "Vertex", 0x1 }] = { 50, 500 };
+	manifest.costs[{ "Lighting", "Vertex", 0x201 }] = { 70, 700 };
+	manifest.costs[{ "Water", "Pixel", 0x3 }] = { 1000, 10000 };
+	return manifest;
+}
+
+int main()
+{
+	auto manifest = MakeManifest();
+
+	auto current = Evaluate(manifest, "Lighting", 0, 0.1);
+	CHECK(current.permutations == 6);
+	CHECK_NEAR(current.compileMs, 100 + 200 + 300 + 200 + 50 + 70, 1e-9);
+	CHECK_NEAR(current.bytecodeSize, 1000 + 2000 + 3000 + 2000 + 500 + 700, 1e-9);
+
+	// pixel pairs {0x1, 0x201} and {0x401, 0x601}, vertex {0x1, 0x201}, each varying one stripped bit
+	auto bit9 = Evaluate(manifest, "Lighting", 0x200, 0.1);
+	CHECK(bit9.permutations == 3);
+	CHECK_NEAR(bit9.compileMs, (200 + 300 + 70) * 1.1, 1e-9);
+	CHECK_NEAR(bit9.bytecodeSize, (2000 + 3000 + 700) * 1.1, 1e-9);
+
+	// bit 10 never varies for the vertex shaders, so they stay apart and pay no branch
+	auto bit10 = Evaluate(manifest, "Lighting", 0x400, 0.1);
+	CHECK(bit10.permutations == 4);
+	CHECK_NEAR(bit10.compileMs, (300 + 200) * 1.1 + 50 + 70, 1e-9);
+
+	// one pixel group varying two bits, one vertex group varying one
+	auto both = Evaluate(manifest, "Lighting", 0x600, 0.1);
+	CHECK(both.permutations == 2);
+	CHECK_NEAR(both.compileMs, 300 * 1.2 + 70 * 1.1, 1e-9);
+
+	// without branch overhead stripping a bit can only save
+	CHECK_NEAR(Evaluate(manifest, "Lighting", 0x600, 0).compileMs, 300 + 70, 1e-9);
+
+	// other types are not mixed in
+	auto water = Evaluate(manifest, "Water", 0, 0.1);
+	CHECK(water.permutations == 1);
+	CHECK_NEAR(water.compileMs, 1000, 1e-9);
+
+	auto flags = GetBitFlags(manifest, "Lighting");
+	CHECK(flags.size() == 3);
+	CHECK(flags[0].name == "Bit0" && flags[0].mask == 0x1);
+	CHECK(flags[1].name == "Bit9" && flags[1].mask == 0x200);
+	CHECK(flags[2].name == "Bit10" && flags[2].mask == 0x400);
+
+	// the current state, the flags that vary on their own, then the greedy accumulation after its first step.
+	// Bit 0 is set everywhere and bit 3 nowhere, so neither can collapse anything.
+	flags.push_back({ "Bit3", 0x8 });
+	auto candidates = Analyze(manifest, "Lighting", flags, 0.1);
+	CHECK(candidates.size() == 4);
+	CHECK(candidates[0].flags == "Current");
+	CHECK(candidates[0].permutations == current.permutations);
+	CHECK(candidates[1].flags == "Bit9");
+	CHECK_NEAR(candidates[1].compileMs, bit9.compileMs, 1e-9);
+	CHECK(candidates[2].flags == "Bit10");
+	CHECK_NEAR(candidates[2].compileMs, bit10.compileMs, 1e-9);
+	CHECK(candidates[3].flags == "Bit9+Bit10");
+	CHECK(candidates[3].mask == 0x600);
+	CHECK(candidates[3].permutations == 2);
+	CHECK_NEAR(candidates[3].compileMs, both.compileMs, 1e-9);
+
+	return Test::Finish();
+}
@@ -0,0 +1,43 @@
+// Runs the permutation analysis on a descriptor manifest and compile telemetry recorded in game, for every shader type in the manifest:
+//   PermutationAnalyzer CommunityShadersDescriptors.csv CommunityShadersCompile.csv Permutations.csv [branch overhead]
+// Flags are named by their descriptor bit, LightingShaderFlags and WaterShaderFlags in ShaderCache.h give their names.
+#include <ShaderTools/PermutationAnalyzer.h>
+
+#include <cstdio>
+#include <exception>
+#include <set>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	if (argc < 4) {
+		std::fprintf(stderr, "usage: %s <descriptors.csv> <compile.csv> <report.csv> [branch overhead]\n", argv[0]);
+		return 2;
+	}
+
+	try {
+		auto manifest = PermutationAnalyzer::LoadManifest(argv[1], argv[2]);
+		double branchOverhead = argc > 4 ? std::stod(argv[4]) : 0.1;
+
+		std::set<std::string> types;
+		for (auto& entry : manifest.descriptors)
+			types.insert(entry.type);
+
+		std::vector<PermutationAnalyzer::Candidate> candidates;
+		for (auto& type : types) {
+			auto typeCandidates = PermutationAnalyzer::Analyze(manifest, type, PermutationAnalyzer::GetBitFlags(manifest, type), branchOverhead);
+			candidates.insert(candidates.end(), typeCandidates.begin(), typeCandidates.end());
+		}
+		PermutationAnalyzer::WriteReport(candidates, argv[3]);
+
+		std::printf("%-12s %-40s %12s %14s %16s\n", "type", "stripped flags", "permutations", "compile ms", "bytecode size");
+		for (auto& candidate : candidates)
+			std::printf("%-12s %-40s %12zu %14.1f %16.0f\n", candidate.type.c_str(), candidate.flags.c_str(), candidate.permutations, candidate.compileMs, candidate.bytecodeSize);
+		std::printf("%zu descriptors, %zu compiled permutations, report written to %s\n", manifest.descriptors.size(), manifest.costs.size(), argv[3]);
+	} catch (const std::exception& ex) {
+		std::fprintf(stderr, "%s\n", ex.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,106 @@
+// Builds a synthetic Data/Shaders tree laid out like the deployed one and checks which shaders an edit reaches, for the
+// top level shaders named by BSShader and for feature compute shaders named by their ComputeShaderDesc path.
+#include <ShaderTools/ShaderIncludeGraph.h>
+
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "Test.h"
+
+namespace fs = std::filesystem;
+
+static void WriteSource(const fs::path& a_path, const std::string& a_contents)
+{
+	fs::create_directories(a_path.parent_path());
+	std::ofstream(a_path) << a_contents;
+}
+
+// The compute shaders the features ask for, as written in their GetComputeShaderDescs
+static const std::wstring ComputeShaders[] = {
+	L"Data\\Shaders\\LightLimitFix\\ClusterBuildingCS.hlsl",
+	L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl",
+	L"Data\\Shaders\\ScreenSpaceShadows\\RaymarchCS.hlsl",
+};
+
+static std::unordered_set<std::string> GetAffectedComputeShaders(const SIE::ShaderIncludeGraph& a_graph, const fs::path& a_file)
+{
+	auto files = a_graph.GetAffectedFiles(a_file);
+	std::unordered_set<std::string> result;
+	for (auto& path : ComputeShaders) {
+		auto key = a_graph.GetKey(path);
+		if (files.contains(key))
+			result.insert(key);
+	}
+	return result;
+}
+
+int main()
+{
+	auto root = fs::temp_directory_path() / ("ShaderIncludeGraphTest" + std::to_string(std::random_device{}()));
+	fs::create_directories(root);
+	auto previousPath = fs::current_path();
+	// shader paths are relative to the game directory, as in game
+	fs::current_path(root);
+
+	const fs::path shaders = "Data/Shaders";
+	WriteSource(shaders / "Lighting.hlsl", "#include \"Common/Color.hlsli\"\n#include \"LightLimitFix/LightLimitFix.hlsli\"\n");
+	WriteSource(shaders / "Water.hlsl", "#include \"Common/Color.hlsli\"\n");
+	WriteSource(shaders / "Sky.hlsl", "// #include is only recognised at the start of a line\n");
+	WriteSource(shaders / "Common/Color.hlsli", "#include \"Common/Math.hlsli\"\n");
+	WriteSource(shaders / "Common/Math.hlsli", "");
+	WriteSource(shaders / "Common/VR.hlsl", "");
+	WriteSource(shaders / "LightLimitFix/Common.hlsli", "  #  include \"Common/VR.hlsl\"\n");
+	WriteSource(shaders / "LightLimitFix/LightLimitFix.hlsli", "#include \"Common/VR.hlsl\"\n");
+	WriteSource(shaders / "LightLimitFix/ClusterBuildingCS.hlsl", "#include \"Common.hlsli\"\n");
+	WriteSource(shaders / "LightLimitFix/ClusterCullingCS.hlsl", "#include \"Common.hlsli\"\n#include <Common/Math.hlsli>\n");
+	WriteSource(shaders / "ScreenSpaceShadows/RaymarchCS.hlsl", "#include \"../Common/Math.hlsli\"\n");
+
+	SIE::ShaderIncludeGraph graph;
+	graph.Build(shaders);
+
+	// top level shaders, by the name every shaderMap key starts with
+	CHECK((graph.GetAffectedShaders(shaders / "Common/Math.hlsli") == std::unordered_set<std::string>{ "lighting", "water" }));
+	CHECK((graph.GetAffectedShaders(shaders / "LightLimitFix/LightLimitFix.hlsli") == std::unordered_set<std::string>{ "lighting" }));
+	CHECK((graph.GetAffectedShaders(shaders / "Sky.hlsl") == std::unordered_set<std::string>{ "sky" }));
+	// compute shaders are not top level shaders
+	CHECK(graph.GetAffectedShaders(shaders / "LightLimitFix/ClusterBuildingCS.hlsl").empty());
+
+	// a compute shader path with backslashes maps to the same key as the file found on disk
+	CHECK(graph.GetKey(L"Data\\Shaders\\LightLimitFix\\ClusterCullingCS.hlsl") == "lightlimitfix/clustercullingcs.hlsl");
+	CHECK(graph.GetKey(shaders / "LightLimitFix" / "ClusterCullingCS.hlsl") == "lightlimitfix/clustercullingcs.hlsl");
+
+	// includes next to the including file win over the root, and both are followed
+	CHECK((GetAffectedComputeShaders(graph, shaders / "LightLimitFix/Common.hlsli") == std::unordered_set<std::string>{ "lightlimitfix/clusterbuildingcs.hlsl", "lightlimitfix/clustercullingcs.hlsl" }));
+	CHECK((GetAffectedComputeShaders(graph, shaders / "Common/Math.hlsli") == std::unordered_set<std::string>{ "lightlimitfix/clustercullingcs.hlsl", "screenspaceshadows/raymarchcs.hlsl" }));
+	CHECK((GetAffectedComputeShaders(graph, shaders / "Common/VR.hlsl") == std::unordered_set<std::string>{ "lightlimitfix/clusterbuildingcs.hlsl", "lightlimitfix/clustercullingcs.hlsl" }));
+	CHECK((GetAffectedComputeShaders(graph, shaders / "ScreenSpaceShadows/RaymarchCS.hlsl") == std::unordered_set<std::string>{ "screenspaceshadows/raymarchcs.hlsl" }));
+	CHECK(GetAffectedComputeShaders(graph, shaders / "Common/Color.hlsli").empty());
+
+	// an edit that adds or drops an include moves the edges
+	WriteSource(shaders / "Water.hlsl", "");
+	graph.Update(shaders / "Water.hlsl");
+	WriteSource(shaders / "ScreenSpaceShadows/RaymarchCS.hlsl", "#include \"Common/Color.hlsli\"\n");
+	graph.Update(shaders / "ScreenSpaceShadows/RaymarchCS.hlsl");
+	CHECK((graph.GetAffectedShaders(shaders / "Common/Color.hlsli") == std::unordered_set<std::string>{ "lighting" }));
+	CHECK((GetAffectedComputeShaders(graph, shaders / "Common/Color.hlsli") == std::unordered_set<std::string>{ "screenspaceshadows/raymarchcs.hlsl" }));
+	CHECK((GetAffectedComputeShaders(graph, shaders / "Common/Math.hlsli") == std::unordered_set<std::string>{ "lightlimitfix/clustercullingcs.hlsl", "screenspaceshadows/raymarchcs.hlsl" }));
+
+	// a deleted file keeps its includers, so recreating it still reaches them
+	fs::remove(shaders / "LightLimitFix/Common.hlsli");
+	graph.Update(shaders / "LightLimitFix/Common.hlsli");
+	CHECK(GetAffectedComputeShaders(graph, shaders / "Common/VR.hlsl").empty());
+	CHECK((GetAffectedComputeShaders(graph, shaders / "LightLimitFix/Common.hlsli").size() == 2));
+
+	// include cycles terminate
+	WriteSource(shaders / "Common/Math.hlsli", "#include \"Common/Color.hlsli\"\n");
+	graph.Update(shaders / "Common/Math.hlsli");
+	CHECK((graph.GetAffectedShaders(shaders / "Common/Math.hlsli") == std::unordered_set<std::string>{ "lighting" }));
+
+	CHECK(SIE::ShaderIncludeGraph::IsShaderSource("Data/Shaders/Common/COLOR.HLSLI"));
+	CHECK(!SIE::ShaderIncludeGraph::IsShaderSource("Data/Shaders/Common/Color.hlsli.bak"));
+
+	fs::current_path(previousPath);
+	fs::remove_all(root);
+	return Test::Finish();
+}
@@ -0,0 +1,118 @@
+// Compares the lock-free task state table with a single mutex around an unordered_map, which is how CompilationSet
+// tracked task states before, under the Add pattern of many threads requesting mostly already known permutations.
+// Also measures a table crowded past its capacity, where ids overflow to the locked map.
+#include <ShaderTools/TaskStateTable.h>
+
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Test.h"
+
+using SIE::TaskStateTable;
+using State = TaskStateTable::State;
+
+struct LockedTable
+{
+	std::unordered_map<size_t, State> states;
+	std::mutex mutex;
+
+	State Get(size_t a_id)
+	{
+		std::scoped_lock lock{ mutex };
+		auto it = states.find(a_id);
+		return it != states.end() ? it->second : State::None;
+	}
+
+	bool TryInsert(size_t a_id, State a_state)
+	{
+		std::scoped_lock lock{ mutex };
+		return states.try_emplace(a_id, a_state).second;
+	}
+
+	bool Transition(size_t a_id, State a_from, State a_to)
+	{
+		std::scoped_lock lock{ mutex };
+		auto it = states.find(a_id);
+		if (it == states.end() || it->second != a_from)
+			return false;
+		it->second = a_to;
+		return true;
+	}
+};
+
+// Each thread walks the requests, queueing unknown ids and completing them, as the draw hooks and compile threads do
+template <class Table>
+static double Run(Table& a_table, const std::vector<size_t>& a_requests, int a_threads, size_t& o_completed)
+{
+	std::atomic<size_t> completed = 0;
+	auto ms = Test::Time(1, [&]() {
+		std::vector<std::thread> threads;
+		for (int t = 0; t < a_threads; t++) {
+			threads.emplace_back([&, t]() {
+				size_t local = 0;
+				for (size_t i = t; i < a_requests.size(); i += a_threads) {
+					auto id = a_requests[i];
+					if (a_table.Get(id) != State::None)
+						continue;
+					if (!a_table.TryInsert(id, State::Queued))
+						continue;
+					a_table.Transition(id, State::Queued, State::InFlight);
+					local += a_table.Transition(id, State::InFlight, State::Done);
+				}
+				completed += local;
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+	});
+	o_completed = completed;
+	return ms;
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = Test::IsQuick(argc, argv);
+	size_t requestCount = quick ? 200000 : 8000000;
+
+	// a few thousand permutations in use, requested over and over with a long tail
+	struct Scene
+	{
+		const char* name;
+		size_t ids;
+	};
+	std::vector<Scene> scenes = { { "typical", 20000 }, { "crowded", TaskStateTable::Capacity * 3 / 2 } };
+
+	std::printf("%8s %8s %8s %14s %14s %10s %10s\n", "scene", "ids", "threads", "locked Mreq/s", "table Mreq/s", "speedup", "overflow");
+	for (auto& scene : scenes) {
+		std::mt19937_64 random(9);
+		std::geometric_distribution<size_t> popularity(scene.ids > 100000 ? 0.00001 : 0.0005);
+		std::vector<size_t> requests(std::max(requestCount, scene.ids));
+		for (size_t i = 0; i < requests.size(); i++) {
+			// every id is requested at least once
+			size_t rank = i < scene.ids ? i : popularity(random) % scene.ids;
+			requests[i] = (rank + 1) * 0x10001;
+		}
+		std::shuffle(requests.begin(), requests.end(), random);
+
+		for (int threads : { 1, 2, 4, 8 }) {
+			LockedTable locked;
+			size_t lockedCompleted = 0;
+			auto lockedMs = Run(locked, requests, threads, lockedCompleted);
+
+			auto table = std::make_unique<TaskStateTable>();
+			size_t tableCompleted = 0;
+			auto tableMs = Run(*table, requests, threads, tableCompleted);
+
+			std::printf("%8s %8zu %8d %14.1f %14.1f %9.2fx %10zu\n", scene.name, scene.ids, threads,
+				requests.size() / lockedMs / 1000.0, requests.size() / tableMs / 1000.0, lockedMs / tableMs, table->GetOverflowCount());
+
+			// every id is compiled exactly once, however the threads interleave
+			CHECK(lockedCompleted == scene.ids);
+			CHECK(tableCompleted == scene.ids);
+		}
+	}
+	return Test::Finish();
+}
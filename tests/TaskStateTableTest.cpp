@@ -0,0 +1,120 @@
+// Checks the task state table transitions, that ids whose probe window is full fall back to the overflow map with the
+// same behaviour, and that concurrent inserts of the same id only succeed once.
+#include <ShaderTools/TaskStateTable.h>
+
+#include <thread>
+#include <vector>
+
+#include "Test.h"
+
+using SIE::TaskStateTable;
+using State = TaskStateTable::State;
+
+// Same hash as the table, to build ids that share a probe window
+static size_t GetIndex(size_t a_id)
+{
+	return static_cast<size_t>((a_id * 0x9E3779B97F4A7C15ull) >> 32) & (TaskStateTable::Capacity - 1);
+}
+
+static std::vector<size_t> GetCollidingIds(size_t a_index, size_t a_count)
+{
+	std::vector<size_t> ids;
+	for (size_t id = 1; ids.size() < a_count; id++) {
+		if (GetIndex(id) == a_index)
+			ids.push_back(id);
+	}
+	return ids;
+}
+
+int main()
+{
+	auto table = std::make_unique<TaskStateTable>();
+
+	// the lifecycle CompilationSet drives
+	CHECK(table->Get(42) == State::None);
+	CHECK(table->TryInsert(42, State::Queued));
+	CHECK(!table->TryInsert(42, State::Queued));
+	CHECK(!table->Transition(42, State::InFlight, State::Done));
+	CHECK(table->Transition(42, State::Queued, State::InFlight));
+	CHECK(table->Transition(42, State::InFlight, State::Done));
+	CHECK(table->Get(42) == State::Done);
+	CHECK(!table->IsTierUp(42));
+	// a hot reload resets it, and it can be queued again
+	CHECK(table->Transition(42, State::Done, State::None));
+	CHECK(table->Get(42) == State::None);
+	CHECK(table->TryInsert(42, State::Queued, true));
+	CHECK(table->IsTierUp(42));
+
+	// a reset id 0 must not look like an empty slot to the ids probing past it
+	auto zeroChain = GetCollidingIds(GetIndex(0), 3);
+	CHECK(table->TryInsert(0, State::Done));
+	for (auto id : zeroChain)
+		CHECK(table->TryInsert(id, State::Done));
+	CHECK(table->Transition(0, State::Done, State::None));
+	for (auto id : zeroChain) {
+		CHECK(table->Get(id) == State::Done);
+		CHECK(!table->TryInsert(id, State::Queued));
+	}
+
+	// more ids than a probe window holds overflow, and behave the same
+	table->Clear();
+	auto colliding = GetCollidingIds(1234, TaskStateTable::MaxProbe + 6);
+	for (auto id : colliding)
+		CHECK(table->TryInsert(id, State::Queued, id == colliding.back()));
+	CHECK(table->GetOverflowCount() == 6);
+	for (auto id : colliding) {
+		CHECK(!table->TryInsert(id, State::Queued));
+		CHECK(table->Get(id) == State::Queued);
+		CHECK(table->Transition(id, State::Queued, State::Done));
+	}
+	CHECK(table->IsTierUp(colliding.back()));
+	CHECK(!table->IsTierUp(colliding.front()));
+	CHECK(table->Transition(colliding.back(), State::Done, State::None));
+	CHECK(table->TryInsert(colliding.back(), State::Queued));
+	size_t visited = 0;
+	table->ForEach([&](size_t, State) { visited++; });
+	CHECK(visited == colliding.size());
+
+	// a table holding more ids than slots keeps every one of them
+	table->Clear();
+	CHECK(table->GetOverflowCount() == 0);
+	const size_t crowded = TaskStateTable::Capacity + TaskStateTable::Capacity / 2;
+	size_t inserted = 0;
+	for (size_t id = 1; id <= crowded; id++)
+		inserted += table->TryInsert(id << 4, State::Done);
+	CHECK(inserted == crowded);
+	size_t duplicates = 0;
+	for (size_t id = 1; id <= crowded; id++)
+		duplicates += table->TryInsert(id << 4, State::Queued);
+	CHECK(duplicates == 0);
+	CHECK(table->GetOverflowCount() >= crowded - TaskStateTable::Capacity);
+	visited = 0;
+	table->ForEach([&](size_t, State) { visited++; });
+	CHECK(visited == crowded);
+
+	// concurrent adds of the same ids, in and out of the overflow, succeed exactly once each
+	table->Clear();
+	std::vector<size_t> ids = GetCollidingIds(77, TaskStateTable::MaxProbe * 2);
+	for (size_t id = 1; id <= 50000; id++)
+		ids.push_back(id * 977);
+	std::atomic<size_t> successes = 0;
+	std::atomic<size_t> completions = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back([&]() {
+			for (auto id : ids) {
+				if (table->TryInsert(id, State::Queued)) {
+					successes++;
+					table->Transition(id, State::Queued, State::InFlight);
+				}
+				completions += table->Transition(id, State::InFlight, State::Done);
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	CHECK(successes == ids.size());
+	CHECK(completions == ids.size());
+
+	return Test::Finish();
+}
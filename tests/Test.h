@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace Test
+{
+	inline int failures = 0;
+
+	inline int Finish()
+	{
+		if (failures)
+			std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return failures ? 1 : 0;
+	}
+
+	inline bool IsQuick(int a_argc, char** a_argv)
+	{
+		for (int i = 1; i < a_argc; i++) {
+			if (!std::strcmp(a_argv[i], "--quick"))
+				return true;
+		}
+		return false;
+	}
+
+	// Best of a_runs, in milliseconds
+	template <class Func>
+	double Time(int a_runs, Func&& a_func)
+	{
+		double best = 1e30;
+		for (int i = 0; i < a_runs; i++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			a_func();
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+		return best;
+	}
+}
+
+#define CHECK(a_expression)                                                                         \
+	do {                                                                                            \
+		if (!(a_expression)) {                                                                      \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #a_expression); \
+			Test::failures++;                                                                       \
+		}                                                                                           \
+	} while (0)
+
+#define CHECK_NEAR(a_value, a_expected, a_tolerance)                                                                              \
+	do {                                                                                                                          \
+		double value_ = (a_value);                                                                                                \
+		double expected_ = (a_expected);                                                                                          \
+		if (std::abs(value_ - expected_) > (a_tolerance)) {                                                                       \
+			std::fprintf(stderr, "%s:%d: check failed: %s = %g, expected %g\n", __FILE__, __LINE__, #a_value, value_, expected_); \
+			Test::failures++;                                                                                                     \
+		}                                                                                                                         \
+	} while (0)
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cmath>
+
+// Stand-in for the DirectX vector types the plugin uses, enough for the code under test
+struct Vector3
+{
+	float x = 0, y = 0, z = 0;
+
+	Vector3& operator+=(const Vector3& a_other)
+	{
+		x += a_other.x;
+		y += a_other.y;
+		z += a_other.z;
+		return *this;
+	}
+	Vector3& operator/=(float a_value)
+	{
+		x /= a_value;
+		y /= a_value;
+		z /= a_value;
+		return *this;
+	}
+	Vector3 operator+(const Vector3& a_other) const { return { x + a_other.x, y + a_other.y, z + a_other.z }; }
+	Vector3 operator-(const Vector3& a_other) const { return { x - a_other.x, y - a_other.y, z - a_other.z }; }
+	Vector3 operator*(float a_value) const { return { x * a_value, y * a_value, z * a_value }; }
+	float Length() const { return std::sqrt(x * x + y * y + z * z); }
+};